@@ -6,7 +6,7 @@ layout( location = 0 ) in vec4 fragColor;
 layout( location = 1 ) in vec2 fragTexCoord;
 layout( location = 2 ) flat in int samplerId;
 
-layout( binding = 1 ) uniform sampler2D texSamplers[MAX_TEXTURES];
+layout( binding = 1 ) uniform sampler2DArray texSamplers[MAX_TEXTURES];
 
 layout( location = 0 ) out vec4 outColor;
 
@@ -14,7 +14,10 @@ void main()
 {
   if ( samplerId > 0 )
   {
-    vec4 texColor = texture( texSamplers[samplerId], fragTexCoord );
+    // the low 16 bits select the texture slot, the bits above the layer of an array texture
+    int  slot     = samplerId & 0xffff;
+    vec3 uv       = vec3( fragTexCoord, float( samplerId >> 16 ) );
+    vec4 texColor = texture( texSamplers[slot], uv );
     outColor      = vec4( texColor * texColor.a ) * fragColor;
   }
   else
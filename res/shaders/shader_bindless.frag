@@ -0,0 +1,26 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout( location = 0 ) in vec4 fragColor;
+layout( location = 1 ) in vec2 fragTexCoord;
+layout( location = 2 ) flat in int samplerId;
+
+layout( binding = 1 ) uniform sampler2DArray texSamplers[];
+
+layout( location = 0 ) out vec4 outColor;
+
+void main()
+{
+  if ( samplerId > 0 )
+  {
+    // the low 16 bits select the texture slot, the bits above the layer of an array texture
+    int  slot     = samplerId & 0xffff;
+    vec3 uv       = vec3( fragTexCoord, float( samplerId >> 16 ) );
+    vec4 texColor = texture( texSamplers[nonuniformEXT( slot )], uv );
+    outColor      = vec4( texColor * texColor.a ) * fragColor;
+  }
+  else
+  {
+    outColor = fragColor;
+  }
+}
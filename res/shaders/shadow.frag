@@ -0,0 +1,82 @@
+#version 450
+
+// closed form gaussian blurred ( rounded ) rectangle, after Evan Wallace's "Fast Rounded Rectangle Shadows"
+
+layout( location = 0 ) in vec2 fragPosition;
+layout( location = 1 ) flat in vec4 fragRect;
+layout( location = 2 ) flat in vec4 fragColor;
+layout( location = 3 ) flat in vec2 fragParams;
+
+layout( location = 0 ) out vec4 outColor;
+
+vec4 erf4( vec4 x )
+{
+  vec4 s = sign( x ), a = abs( x );
+  x = 1.0 + ( 0.278393 + ( 0.230389 + 0.078108 * ( a * a ) ) * a ) * a;
+  x *= x;
+  return s - s / ( x * x );
+}
+
+vec2 erf2( vec2 x )
+{
+  vec2 s = sign( x ), a = abs( x );
+  x = 1.0 + ( 0.278393 + ( 0.230389 + 0.078108 * ( a * a ) ) * a ) * a;
+  x *= x;
+  return s - s / ( x * x );
+}
+
+float gaussian( float x, float sigma )
+{
+  const float pi = 3.141592653589793;
+  return exp( -( x * x ) / ( 2.0 * sigma * sigma ) ) / ( sqrt( 2.0 * pi ) * sigma );
+}
+
+float boxShadow( vec2 lower, vec2 upper, vec2 point, float sigma )
+{
+  vec4 query    = vec4( point - lower, point - upper );
+  vec4 integral = 0.5 + 0.5 * erf4( query * ( sqrt( 0.5 ) / sigma ) );
+  return ( integral.z - integral.x ) * ( integral.w - integral.y );
+}
+
+// blur along x is exact, the row offset of the rounded corner is integrated along y with 4 samples
+float roundedBoxShadowX( float x, float y, float sigma, float corner, vec2 halfSize )
+{
+  float delta    = min( halfSize.y - corner - abs( y ), 0.0 );
+  float curved   = halfSize.x - corner + sqrt( max( 0.0, corner * corner - delta * delta ) );
+  vec2  integral = 0.5 + 0.5 * erf2( ( x + vec2( -curved, curved ) ) * ( sqrt( 0.5 ) / sigma ) );
+  return integral.y - integral.x;
+}
+
+float roundedBoxShadow( vec2 lower, vec2 upper, vec2 point, float sigma, float corner )
+{
+  vec2 center   = ( lower + upper ) * 0.5;
+  vec2 halfSize = ( upper - lower ) * 0.5;
+  point -= center;
+
+  float low   = point.y - halfSize.y;
+  float high  = point.y + halfSize.y;
+  float start = clamp( -3.0 * sigma, low, high );
+  float end   = clamp( 3.0 * sigma, low, high );
+
+  float dy    = ( end - start ) / 4.0;
+  float y     = start + dy * 0.5;
+  float value = 0.0;
+  for ( int i = 0; i < 4; i++ )
+  {
+    value += roundedBoxShadowX( point.x, point.y - y, sigma, corner, halfSize ) * gaussian( y, sigma ) * dy;
+    y += dy;
+  }
+
+  return value;
+}
+
+void main()
+{
+  float radius = fragParams.x;
+  float sigma  = fragParams.y;
+
+  float shadow = radius > 0.0 ? roundedBoxShadow( fragRect.xy, fragRect.zw, fragPosition, sigma, radius )
+                              : boxShadow( fragRect.xy, fragRect.zw, fragPosition, sigma );
+
+  outColor = vec4( fragColor.rgb, fragColor.a * shadow );
+}
@@ -0,0 +1,40 @@
+#version 450
+
+layout( location = 0 ) in vec4 inRect;
+layout( location = 1 ) in vec4 inColor;
+layout( location = 2 ) in vec2 inParams;
+
+layout( binding = 0 ) uniform UniformBufferObject
+{
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+
+layout( location = 0 ) out vec2 fragPosition;
+layout( location = 1 ) flat out vec4 fragRect;
+layout( location = 2 ) flat out vec4 fragColor;
+layout( location = 3 ) flat out vec2 fragParams;
+
+const vec2 corners[6] = vec2[6]( vec2( 0.0, 0.0 ),
+                                 vec2( 1.0, 0.0 ),
+                                 vec2( 1.0, 1.0 ),
+                                 vec2( 1.0, 1.0 ),
+                                 vec2( 0.0, 1.0 ),
+                                 vec2( 0.0, 0.0 ) );
+
+void main()
+{
+  // grow the quad by 3 sigma, the gaussian is negligible past that
+  float margin = 3.0 * inParams.y;
+  vec2  lower  = inRect.xy - margin;
+  vec2  upper  = inRect.xy + inRect.zw + margin;
+
+  fragPosition = mix( lower, upper, corners[gl_VertexIndex] );
+  gl_Position  = ubo.proj * ubo.view * ubo.model * vec4( fragPosition, 0.0, 1.0 );
+
+  fragRect   = vec4( inRect.xy, inRect.xy + inRect.zw );
+  fragColor  = inColor;
+  fragParams = inParams;
+}
@@ -0,0 +1,28 @@
+#version 450
+
+layout( location = 0 ) in vec2 inPosition;
+layout( location = 1 ) in vec2 inOffset;
+layout( location = 2 ) in vec2 inScale;
+layout( location = 3 ) in vec4 inColor;
+
+layout( binding = 0 ) uniform UniformBufferObject
+{
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+
+layout( location = 0 ) out vec4 fragColor;
+layout( location = 1 ) out vec2 fragTexCoord;
+layout( location = 2 ) flat out int samplerId;
+
+void main()
+{
+  vec2 position = inOffset + inPosition * inScale;
+  gl_Position   = ubo.proj * ubo.view * ubo.model * vec4( position, 0.0, 1.0 );
+
+  fragColor    = inColor;
+  fragTexCoord = inPosition;
+  samplerId    = -1;
+}
@@ -17,6 +17,8 @@ extern "C"
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <math.h>
 
@@ -64,40 +66,554 @@ extern "C"
 
 #define MAX_BATCH_VERTICES 500000
 #define MAX_BATCH_INDICES 550000
+
+#define DK_VK_SHAPE_MESH_CACHE_SIZE 256
+#define DK_VK_SHAPE_MESH_MAX_VERTICES 65536
+#define DK_VK_SHAPE_MESH_MAX_INDICES 196608
+#define DK_VK_SHAPE_MAX_INSTANCES 65536
+#define DK_VK_SHAPE_RATIO_STEPS 4096
+#define DK_VK_SHADOW_MAX_INSTANCES 16384
 #define DK_VK_MAX_TEXTURES 10
+#define DK_VK_MAX_LOADED_TEXTURES 256
+// enough tables of DK_VK_MAX_TEXTURES - 1 usable slots for every loaded texture to appear in one batch
+#define DK_VK_MAX_TEXTURE_TABLES \
+  ( ( DK_VK_MAX_LOADED_TEXTURES + DK_VK_MAX_TEXTURES - 2 ) / ( DK_VK_MAX_TEXTURES - 1 ) )
+#define DK_VK_MAX_BINDLESS_TEXTURES 4096
+#define DK_VK_ATLAS_PAGE_SIZE 1024
+#define DK_VK_ATLAS_PADDING 1
+#define DK_VK_ATLAS_INVALID_REGION UINT32_MAX
+#define DK_VK_TEXTURE_WORKER_COUNT 2
+#define DK_VK_TEXTURE_UPLOADS_PER_POLL 4
+#define DK_VK_MAX_DECODE_THREADS 32
+#define DK_VK_TEXTURE_LAYER_SHIFT 16
+#define DK_VK_MAX_TEXTURE_LAYERS 2048
+#define DK_VK_TEXTURE_INDEX_BITS 16
+#define DK_VK_TEXTURE_INDEX_MASK 0xffffu
+#define DK_VK_TEXTURE_GENERATION_MASK 0xffffu
+#define DK_VK_STAGING_CHUNK_SIZE ( 16u * 1024u * 1024u )
+#define DK_VK_STAGING_ALIGNMENT 16
+#define DK_VK_TEXTURE_UPDATE_SEGMENT_SIZE ( 16u * 1024u * 1024u )
+#define DK_VK_MAX_SAMPLERS 32
+#define DK_VK_MEMORY_BLOCK_SIZE ( 64ull * 1024ull * 1024ull )
+#define DK_VK_MEMORY_MIN_ALLOCATION 256
+#define DK_VK_BUDDY_ORDER_COUNT 19 // log2( DK_VK_MEMORY_BLOCK_SIZE / DK_VK_MEMORY_MIN_ALLOCATION ) + 1
+#define DK_VK_RESIDENCY_IDLE_FRAMES 120
+#define DK_VK_RESIDENCY_EVICTIONS_PER_POLL 4
+#define DK_VK_RESIDENCY_MIN_EXTENT 64
+#define DK_VK_RESIDENCY_BUDGET_FRACTION 0.8
+#define DK_VK_TEXTURE_CACHE_MAGIC 0x43544b44 // "DKTC"
+#define DK_VK_TEXTURE_CACHE_VERSION 1
+#define DK_VK_QOI_MAGIC 0x716f6966 // "qoif"
+#define DK_VK_QOI_HEADER_SIZE 14
+#define DK_VK_QOI_PADDING_SIZE 8
+#define DK_VK_QOI_PIXELS_MAX 400000000u
+#define DK_VK_QOI_OP_INDEX 0x00
+#define DK_VK_QOI_OP_DIFF 0x40
+#define DK_VK_QOI_OP_LUMA 0x80
+#define DK_VK_QOI_OP_RUN 0xc0
+#define DK_VK_QOI_OP_RGB 0xfe
+#define DK_VK_QOI_OP_RGBA 0xff
+#define DK_VK_QOI_MASK 0xc0
+
+#define DK_VK_DESCRIPTOR_BINDING_UNIFORM  ( 1u << 0 )
+#define DK_VK_DESCRIPTOR_BINDING_TEXTURES ( 1u << 1 )
+#define DK_VK_TEXTURE_SLOT_STALE UINT32_MAX
+
+#define DK_VK_TEXTURE_COMPRESSION_BC   ( 1u << 0 )
+#define DK_VK_TEXTURE_COMPRESSION_ETC2 ( 1u << 1 )
+#define DK_VK_TEXTURE_COMPRESSION_ASTC ( 1u << 2 )
 #define DK_VK_FONT_ATLAS_PADDING 1
 
+#define DK_VK_POLYGON_CACHE_BUCKETS 64
+#define DK_VK_POLYGON_CACHE_WAYS 4
+
+#define DK_VK_HASH_SEED 14695981039346656037ULL
+
   typedef struct DK_Vertex
   {
     DK_vkVec2  pos;
     DK_vkColor color;
     DK_vkVec2  texCoord;
-    /* Note (david) when 0 is treated as no textured output */
+    /* Note (david) when 0 is treated as no textured output
+     * the low 16 bits are the texture slot and the bits above the layer of an array texture */
     int32_t samplerId;
   } DK_Vertex;
 
+  /* Note: buddy pools serve resources that come and go ( textures, stencil image, staging bursts ), linear
+   * pools are bump allocated for resources that are never freed before shutdown. Freeing the most recent
+   * allocation of a linear block moves its head back, any other space only returns once the block is
+   * empty, so anything freed earlier belongs in a buddy pool. Optimal tiled images get their own buddy pool
+   * when bufferImageGranularity is larger than the smallest buddy range, otherwise buffers and images
+   * share one */
+  typedef enum
+  {
+    DK_VK_MEMORY_POOL_BUDDY,
+    DK_VK_MEMORY_POOL_BUDDY_OPTIMAL,
+    DK_VK_MEMORY_POOL_LINEAR,
+    DK_VK_MEMORY_POOL_COUNT,
+    DK_VK_MEMORY_POOL_DEDICATED = DK_VK_MEMORY_POOL_COUNT,
+  } DK_vkMemoryPoolKind;
+
+  // mapped is only set for host visible memory, blocks stay mapped for their whole lifetime
+  typedef struct
+  {
+    VkDeviceMemory      memory;
+    VkDeviceSize        offset;
+    VkDeviceSize        size;
+    void               *mapped;
+    DK_vkMemoryPoolKind pool;
+    uint32_t            memoryType;
+    uint32_t            block;
+  } DK_vkAllocation;
+
   typedef struct
   {
-    VkImage        image;
     VkDeviceMemory memory;
-    VkImageView    view;
-    VkSampler      sampler;
+    unsigned char *mapped;
+    VkDeviceSize   used;
+    uint32_t       allocationCount;
+
+    // linear pools
+    VkDeviceSize head;
+
+    // buddy pools, offsets of the free ranges of each order
+    VkDeviceSize *freeRanges[DK_VK_BUDDY_ORDER_COUNT];
+    uint32_t      freeCounts[DK_VK_BUDDY_ORDER_COUNT];
+    uint32_t      freeCapacities[DK_VK_BUDDY_ORDER_COUNT];
+  } DK_vkMemoryBlock;
+
+  // released blocks keep their slot with memory set to VK_NULL_HANDLE, allocations refer to blocks by index
+  typedef struct
+  {
+    DK_vkMemoryPoolKind kind;
+    uint32_t            memoryType;
+    DK_vkMemoryBlock   *blocks;
+    uint32_t            blockCount;
+  } DK_vkMemoryPool;
+
+  typedef struct
+  {
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize                     bufferImageGranularity;
+    uint32_t                         maxAllocationCount;
+
+    DK_vkMemoryPool pools[DK_VK_MEMORY_POOL_COUNT][VK_MAX_MEMORY_TYPES];
+
+    uint32_t     deviceAllocationCount;
+    uint32_t     dedicatedCount;
+    VkDeviceSize dedicatedBytes;
+  } DK_vkMemoryAllocator;
+
+  // fragmentation is 1 - largestFreeRange / free bytes, 0 when all free space is one range
+  typedef struct
+  {
+    uint32_t     blockCount;
+    uint32_t     allocationCount;
+    VkDeviceSize reservedBytes;
+    VkDeviceSize usedBytes;
+    VkDeviceSize largestFreeRange;
+    float        fragmentation;
+  } DK_vkMemoryStats;
+
+  typedef enum
+  {
+    DK_VK_TEXTURE_RESIDENT,
+    DK_VK_TEXTURE_STREAMING,
+    DK_VK_TEXTURE_EVICTED,
+  } DK_vkTextureResidency;
+
+  /* Note: width and height are the size the texture was loaded with, baseLevel counts the mip levels the
+   * residency manager dropped since. source is the file an evicted texture is reloaded from, NULL when
+   * the texture can not be reloaded. layerCount is above 1 only for DK_vkAddTextureArray textures.
+   * refCount counts the DK_vkAddTexture calls that were given this texture, pixelHash and pixelDigest are
+   * two independent content hashes of the decoded image, 0 when the texture was not created from one.
+   * Images are shared when both hashes and the size match, the pixels themselves are not compared since
+   * they only live on the gpu, so a crafted pair of images could still be taken for one. samplerId is
+   * the handle the texture was registered under, generation survives DK_vkRemoveTexture and nextFree
+   * links free slots */
+  typedef struct
+  {
+    VkImage         image;
+    DK_vkAllocation memory;
+    VkImageView     view;
+    VkSampler       sampler;
+    int32_t         width;
+    int32_t         height;
+    int32_t         channels;
+    bool            isActive;
+    uint32_t        samplerId;
+
+    VkFormat              format;
+    uint32_t              mipLevels;
+    uint32_t              baseLevel;
+    uint32_t              layerCount;
+    DK_vkTextureResidency residency;
+    uint64_t              lastUsedFrame;
+    char                 *source;
+    uint32_t              refCount;
+    uint64_t              pixelHash;
+    uint64_t              pixelDigest;
+    bool                  isDynamic;
+    uint32_t              generation;
+    uint32_t              nextFree;
+  } DK_vkTexture;
+
+  // sampler cache key, maxAnisotropy <= 1 disables anisotropic filtering
+  typedef struct
+  {
+    VkFilter             magFilter;
+    VkFilter             minFilter;
+    VkSamplerMipmapMode  mipmapMode;
+    VkSamplerAddressMode addressMode;
+    float                maxAnisotropy;
+  } DK_vkSamplerState;
+
+  typedef struct
+  {
+    DK_vkSamplerState state;
+    VkSampler         sampler;
+  } DK_vkSamplerEntry;
+
+  /* Note: samplers are immutable and shared by every texture with the same state, textures never own
+   * the sampler they point to, only DK_vkDestroySamplerCache releases them */
+  typedef struct
+  {
+    DK_vkSamplerEntry entries[DK_VK_MAX_SAMPLERS];
+    uint32_t          count;
+  } DK_vkSamplerCache;
+
+  /* Note: file layout of a KTX2 container up to the level index, every field is little endian and
+   * naturally aligned so the header can be copied straight out of the file */
+  typedef struct
+  {
+    uint8_t  identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+  } DK_vkKTX2Header;
+
+  typedef struct
+  {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+  } DK_vkKTX2Level;
+
+  typedef enum
+  {
+    DK_VK_FILL_RULE_NONZERO,
+    DK_VK_FILL_RULE_EVEN_ODD,
+  } DK_vkFillRule;
+
+  typedef enum
+  {
+    DK_VK_BATCH_COMMAND_TRIANGLES,
+    DK_VK_BATCH_COMMAND_STENCIL_FILL,
+    DK_VK_BATCH_COMMAND_STENCIL_COVER,
+    DK_VK_BATCH_COMMAND_SHAPE_INSTANCES,
+    DK_VK_BATCH_COMMAND_SHADOW_INSTANCES,
+  } DK_vkBatchCommandType;
+
+  typedef struct
+  {
+    DK_vkBatchCommandType type;
+    uint32_t              firstIndex;
+    uint32_t              indexCount;
+    uint32_t              stencilCompareMask;
+    uint32_t              textureTable;
+
+    // shape instances index into the shape mesh buffers instead of the batch buffers
+    int32_t  vertexOffset;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+  } DK_vkBatchCommand;
+
+  typedef enum
+  {
+    DK_VK_SHAPE_CIRCLE,
+    DK_VK_SHAPE_ROUNDED_RECTANGLE,
+  } DK_vkShapeType;
+
+  typedef struct
+  {
+    float offset[2];
+    float scale[2];
+    float color[4];
+  } DK_vkShapeInstance;
+
+  typedef struct
+  {
+    uint64_t key;
+    uint64_t lastUsed;
+    bool     used;
+    int32_t  vertexOffset;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t vertexCapacity;
+    uint32_t indexCapacity;
+  } DK_vkShapeMesh;
+
+  /* Note: unit meshes are tessellated once and kept in device local memory, each draw only appends
+   * an instance record ( offset, scale and color ). Instances are written into the region of
+   * currentFrame, DK_VK_SHAPE_MAX_INSTANCES per frame in flight. Once the table or the mesh buffers
+   * are full the least recently used mesh not drawn since batchClock gives up its slot and storage */
+  typedef struct
+  {
+    DK_vkShapeMesh meshes[DK_VK_SHAPE_MESH_CACHE_SIZE];
+    uint64_t       clock;
+    uint64_t       batchClock;
+
+    VkBuffer        vertexBuffer;
+    DK_vkAllocation vertexBufferMemory;
+    VkBuffer        indexBuffer;
+    DK_vkAllocation indexBufferMemory;
+    uint32_t        vertexCount;
+    uint32_t        indexCount;
+
+    VkBuffer            instanceBuffer;
+    DK_vkAllocation     instanceBufferMemory;
+    DK_vkShapeInstance *instanceBufferMapped;
+    uint32_t            instanceCount;
+  } DK_vkShapeCache;
+
+  typedef struct
+  {
+    float rect[4];
+    float color[4];
+    float radius;
+    float sigma;
+  } DK_vkShadowInstance;
+
+  // DK_VK_SHADOW_MAX_INSTANCES per frame in flight, instances are written into the region of currentFrame
+  typedef struct
+  {
+    VkBuffer             instanceBuffer;
+    DK_vkAllocation      instanceBufferMemory;
+    DK_vkShadowInstance *instanceBufferMapped;
+    uint32_t             instanceCount;
+  } DK_vkShadowBatch;
+
+  typedef struct
+  {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+  } DK_vkSkylineNode;
+
+  /* Note: every page is a regular texture of the texture system, the skyline holds the top edge of the
+   * packed area from left to right */
+  typedef struct
+  {
+    uint32_t          textureId;
+    DK_vkSkylineNode *skyline;
+    uint32_t          skylineCount;
+  } DK_vkAtlasPage;
+
+  typedef struct
+  {
+    uint32_t  textureId;
+    DK_vkVec2 position; // in texels, as expected by DK_vkDrawTextureRegion
+    DK_vkSize size;
+    DK_vkVec4 uv; // { u1, v1, u2, v2 }
+  } DK_vkAtlasRegion;
+
+  typedef struct
+  {
+    uint32_t pageSize;
+
+    DK_vkAtlasPage *pages;
+    uint32_t        pageCount;
+
+    DK_vkAtlasRegion *regions;
+    uint32_t          regionCount;
+    uint32_t          regionCapacity;
+  } DK_vkAtlas;
+
+  typedef enum
+  {
+    DK_VK_TEXTURE_JOB_QUEUED,
+    DK_VK_TEXTURE_JOB_DECODING,
+    DK_VK_TEXTURE_JOB_DECODED,
+    DK_VK_TEXTURE_JOB_FAILED,
+  } DK_vkTextureJobState;
+
+  // pixels are always RGBA, mapping is set when they point into a memory mapped texture cache entry
+  typedef struct
+  {
+    unsigned char *pixels;
     int32_t        width;
     int32_t        height;
     int32_t        channels;
-    bool           isActive;
-    uint32_t       samplerId;
-  } DK_vkTexture;
+    void          *mapping;
+    size_t         mappingSize;
+  } DK_vkImageData;
+
+  /* Note: a cache entry is this header, the source path and the RGBA pixels. An entry is valid while
+   * the source has the same size and either the same mtime or the same content hash */
+  typedef struct
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    int64_t  sourceMtime;
+    uint64_t sourceSize;
+    int32_t  width;
+    int32_t  height;
+    int32_t  channels;
+    uint32_t pathLength;
+  } DK_vkTextureCacheHeader;
+
+  typedef struct
+  {
+    char                *filename;
+    uint32_t             textureId;
+    DK_vkTextureJobState state;
+    DK_vkImageData       image;
+  } DK_vkTextureJob;
+
+  /* Note: shared by the threads of one DK_vkAddTextures call, next, consumed and states are guarded by
+   * mutex. images[i] belongs to the decoding thread until states[i] leaves DK_VK_TEXTURE_JOB_DECODING.
+   * Workers never start an image more than lookahead images past the last one uploaded */
+  typedef struct
+  {
+    const char           *cacheDirectory;
+    const char          **paths;
+    DK_vkImageData       *images;
+    DK_vkTextureJobState *states;
+    uint32_t              count;
+    uint32_t              next;
+    uint32_t              consumed;
+    uint32_t              lookahead;
+    pthread_mutex_t       mutex;
+    pthread_cond_t        decoded;
+    pthread_cond_t        space;
+  } DK_vkDecodeBatch;
+
+  /* Note: the workers only decode, every Vulkan call stays on the thread that owns the application.
+   * jobs is guarded by mutex and may be reallocated, workers look their job up by texture id */
+  typedef struct
+  {
+    pthread_t       workers[DK_VK_TEXTURE_WORKER_COUNT];
+    pthread_mutex_t mutex;
+    pthread_cond_t  wake;
+    bool            running;
+
+    DK_vkTextureJob *jobs;
+    uint32_t         jobCount;
+    uint32_t         jobCapacity;
+  } DK_vkTextureStreamer;
+
+  /* Note: while depth > 0 every single time command is recorded into commandBuffer, stagingSerial is
+   * the staging belt serial that is retired once the fence of the submission has signaled */
+  typedef struct
+  {
+    VkCommandBuffer commandBuffer;
+    VkFence         fence;
+    uint32_t        depth;
+    bool            pending;
+    uint64_t        stagingSerial;
+  } DK_vkUploadContext;
+
+  /* Note: budget is the texture budget in bytes set with DK_vkSetTextureBudget, when it is 0 the device
+   * local heap budget reported by VK_EXT_memory_budget is used. Without either nothing is evicted */
+  typedef struct
+  {
+    VkDeviceSize                                budget;
+    bool                                        memoryBudget;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2;
+    uint64_t                                    frame;
+    uint32_t                                    demotedCount;
+    uint32_t                                    evictedCount;
+  } DK_vkResidency;
+
+  // bump allocated, rewound once the submission tagged with serial has completed
+  typedef struct
+  {
+    VkBuffer        buffer;
+    DK_vkAllocation memory;
+    unsigned char  *mapped;
+    VkDeviceSize    size;
+    VkDeviceSize    used;
+    uint64_t        serial;
+  } DK_vkStagingChunk;
+
+  /* Note: persistently mapped upload memory shared by every host to device copy. Allocations are tagged
+   * with currentSerial, every serial below completedSerial has finished on the gpu */
+  typedef struct
+  {
+    DK_vkStagingChunk *chunks;
+    uint32_t           chunkCount;
+    uint64_t           currentSerial;
+    uint64_t           completedSerial;
+  } DK_vkStagingBelt;
+
+  typedef struct
+  {
+    VkBuffer     buffer;
+    VkDeviceSize offset;
+    void        *data;
+  } DK_vkStagingAllocation;
+
+  // textureId is the slot index, not the handle
+  typedef struct
+  {
+    uint32_t     textureId;
+    VkDeviceSize offset;
+    int32_t      x;
+    int32_t      y;
+    uint32_t     width;
+    uint32_t     height;
+  } DK_vkTextureUpdate;
+
+  /* Note: one segment of DK_VK_TEXTURE_UPDATE_SEGMENT_SIZE per frame in flight. Updates are written into
+   * the segment of currentFrame and recorded by the next DK_vkFlushBatch, which moves on to the next
+   * segment. A segment is written again only after the fence of the frame that read it */
+  typedef struct
+  {
+    VkBuffer            buffer;
+    DK_vkAllocation     memory;
+    VkDeviceSize        head;
+    DK_vkTextureUpdate *updates;
+    uint32_t            updateCount;
+    uint32_t            updateCapacity;
+  } DK_vkTextureUpdateRing;
+
+  // removed by DK_vkRemoveTexture while frames in flight may still sample it
+  typedef struct
+  {
+    VkImage         image;
+    VkImageView     view;
+    DK_vkAllocation memory;
+  } DK_vkRetiredTexture;
 
+  // another file that decoded to the pixels of an existing texture, found again without decoding
   typedef struct
   {
-    VkBuffer       vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    DK_Vertex     *vertexBufferMapped;
+    char    *path;
+    uint32_t index;
+  } DK_vkTextureAlias;
 
-    VkBuffer       indexBuffer;
-    VkDeviceMemory indexBufferMemory;
-    uint32_t      *indexBufferMapped;
+  typedef struct
+  {
+    VkBuffer        vertexBuffer;
+    DK_vkAllocation vertexBufferMemory;
+    DK_Vertex      *vertexBufferMapped;
+
+    VkBuffer        indexBuffer;
+    DK_vkAllocation indexBufferMemory;
+    uint32_t       *indexBufferMapped;
 
     uint32_t vertexCount;
     uint32_t indexCount;
@@ -108,8 +624,23 @@ extern "C"
     VkPipeline       pipeline;
     VkPipelineLayout pipelineLayout;
 
+    /* Note: draws that need a different pipeline split the batch into commands, consecutive plain
+     * triangles stay in one open segment starting at segmentStart */
+    DK_vkBatchCommand *commands;
+    uint32_t           commandCount;
+    uint32_t           commandCapacity;
+    uint32_t           segmentStart;
+
     DK_vkTexture *currentTexture;
 
+    /* Note: maps the sampler array slots used by this batch to texture ids, one table per descriptor set
+     * the batch binds. Slot 0 is the untextured slot so every textureSlotCounts entry starts at 1, new
+     * commands are drawn with textureTable */
+    uint32_t textureSlots[DK_VK_MAX_TEXTURE_TABLES][DK_VK_MAX_TEXTURES];
+    uint32_t textureSlotCounts[DK_VK_MAX_TEXTURE_TABLES];
+    uint32_t textureTableCount;
+    uint32_t textureTable;
+
   } DK_vkRenderer;
 
   typedef struct
@@ -123,6 +654,26 @@ extern "C"
     float zoom;
   } DK_Camera;
 
+  typedef struct
+  {
+    uint64_t   hash;
+    uint64_t   lastUsed;
+    DK_vkVec2 *points;
+    uint32_t   pointCount;
+    uint32_t  *holeStarts;
+    uint32_t   holeCount;
+    uint32_t  *indices;
+    uint32_t   indexCount;
+  } DK_vkPolygonCacheEntry;
+
+  typedef struct
+  {
+    /* Note: triangulations are keyed by a content hash of the point list, entries are compared by value
+     * on lookup so a hash collision never returns a wrong triangulation */
+    DK_vkPolygonCacheEntry entries[DK_VK_POLYGON_CACHE_BUCKETS][DK_VK_POLYGON_CACHE_WAYS];
+    uint64_t               clock;
+  } DK_vkPolygonCache;
+
   typedef struct
   {
     GLFWwindow *window;
@@ -150,6 +701,16 @@ extern "C"
     VkPipelineLayout pipelineLayout;
     VkPipeline       graphicsPipeline;
 
+    VkFormat        stencilFormat;
+    VkImage         stencilImage;
+    DK_vkAllocation stencilImageMemory;
+    VkImageView     stencilImageView;
+    VkPipeline      stencilFillPipeline;
+    VkPipeline      stencilCoverPipeline;
+
+    VkPipeline shapePipeline;
+    VkPipeline shadowPipeline;
+
     VkCommandPool    commandPool;
     VkCommandBuffer *commandBuffers;
 
@@ -161,26 +722,77 @@ extern "C"
     uint32_t currentFrame;
     bool     framebufferResized;
 
-    VkBuffer       vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    DK_vkMemoryAllocator allocator;
+
+    VkBuffer        vertexBuffer;
+    DK_vkAllocation vertexBufferMemory;
 
-    VkBuffer       uniformBuffer;
-    VkDeviceMemory uniformBufferMemory;
+    VkBuffer        uniformBuffer;
+    DK_vkAllocation uniformBufferMemory;
 
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool      descriptorPool;
-    VkDescriptorSet       descriptorSet;
+
+    /* Note: one descriptor set per frame in flight and texture table, bindless textures only use table 0.
+     * A set is only written once the fence of its frame has signaled and only for the bindings flagged in
+     * its dirty mask. frameTextureSlots holds the texture id each sampler slot of the set currently points
+     * to. With bindless textures the elements from dirtyTextureBegin to dirtyTextureEnd are rewritten
+     * without the whole binding being dirty */
+    VkDescriptorSet descriptorSets[DK_VULKAN_MAX_FRAMES_IN_FLIGHT][DK_VK_MAX_TEXTURE_TABLES];
+    uint32_t        descriptorDirtyMask[DK_VULKAN_MAX_FRAMES_IN_FLIGHT][DK_VK_MAX_TEXTURE_TABLES];
+    uint32_t        dirtyTextureBegin[DK_VULKAN_MAX_FRAMES_IN_FLIGHT];
+    uint32_t        dirtyTextureEnd[DK_VULKAN_MAX_FRAMES_IN_FLIGHT];
+
+    uint32_t frameTextureSlots[DK_VULKAN_MAX_FRAMES_IN_FLIGHT][DK_VK_MAX_TEXTURE_TABLES][DK_VK_MAX_TEXTURES];
 
     DK_vkRenderer batchRenderer;
 
+    /* Note: textureCount is the number of slots ever used, removed slots are reused through the list
+     * starting at freeTextureSlot, 0 when it is empty since slot 0 is never removed */
     DK_vkTexture *textures;
     uint32_t      textureCount;
     uint32_t      maxTextures;
     uint32_t      activeTextureCount;
+    uint32_t      freeTextureSlot;
+
+    DK_vkRetiredTexture *retiredTextures;
+    uint32_t             retiredTextureCount;
+    uint32_t             retiredTextureCapacity;
+
+    DK_vkTextureAlias *textureAliases;
+    uint32_t           textureAliasCount;
+    uint32_t           textureAliasCapacity;
+
+    DK_vkTextureStreamer   textureStreamer;
+    DK_vkUploadContext     uploads;
+    DK_vkStagingBelt       staging;
+    DK_vkResidency         residency;
+    DK_vkTextureUpdateRing textureUpdates;
+
+    // decoded textures are cached here when set, see DK_vkSetTextureCacheDirectory
+    char *textureCacheDirectory;
+
+    // set when DK_VK_ENABLE_BINDLESS is defined and the device supports descriptor indexing
+    bool     bindlessTextures;
+    uint32_t bindlessTextureCapacity;
+
+    // set when DK_VK_ENABLE_MIPMAPS is defined and the texture format can be blitted with linear filtering
+    bool textureMipmaps;
+
+    // DK_VK_TEXTURE_COMPRESSION_* families the device can sample, queried in DK_vkPickPhysicalDevice
+    uint32_t textureCompression;
+
+    DK_vkSamplerCache samplers;
+    // 1 when the device has no anisotropic filtering
+    float maxSamplerAnisotropy;
 
     DK_vkTexture *currentTexture;
 
     DK_Camera camera;
+
+    DK_vkPolygonCache polygonCache;
+    DK_vkShapeCache   shapeCache;
+    DK_vkShadowBatch  shadowBatch;
   } DK_vkApplication;
 
   typedef struct
@@ -196,7 +808,7 @@ extern "C"
   typedef struct
   {
     VkImage           image;
-    VkDeviceMemory    memory;
+    DK_vkAllocation   memory;
     VkImageView       view;
     VkSampler         sampler;
     int32_t           width;
@@ -252,7 +864,7 @@ extern "C"
                                                          size_t               codeSize );
   DK_VULKAN_FUNC void           DK_vkInitializeTextureDescriptor( DK_vkApplication *app );
   DK_VULKAN_FUNC void
-  DK_vkSafeUnmapMemory( DK_vkApplication *app, VkDeviceMemory *memory, void **mappedData );
+  DK_vkSafeUnmapMemory( DK_vkApplication *app, DK_vkAllocation *memory, void **mappedData );
 
   DK_VULKAN_FUNC void     DK_vkCreateVertexBuffer( DK_vkApplication *app );
   DK_VULKAN_FUNC void     DK_vkCreateUniformBuffer( DK_vkApplication *app );
@@ -268,15 +880,55 @@ extern "C"
                                              VkBufferUsageFlags    usage,
                                              VkMemoryPropertyFlags properties,
                                              VkBuffer             *buffer,
-                                             VkDeviceMemory       *bufferMemory );
+                                             DK_vkAllocation      *bufferMemory );
+  DK_VULKAN_FUNC void     DK_vkCreateBufferEx( DK_vkApplication     *app,
+                                               VkDeviceSize          size,
+                                               VkBufferUsageFlags    usage,
+                                               VkMemoryPropertyFlags properties,
+                                               DK_vkMemoryPoolKind   pool,
+                                               VkBuffer             *buffer,
+                                               DK_vkAllocation      *bufferMemory );
+
+  DK_VULKAN_FUNC void DK_vkInitMemoryAllocator( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkDestroyMemoryAllocator( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkAllocateDeviceMemory(
+      DK_vkApplication *app, uint32_t memoryType, VkDeviceSize size, VkDeviceMemory *memory, void **mapped );
+  DK_VULKAN_FUNC void DK_vkAllocateMemory( DK_vkApplication     *app,
+                                           VkMemoryRequirements  requirements,
+                                           VkMemoryPropertyFlags properties,
+                                           DK_vkMemoryPoolKind   pool,
+                                           DK_vkAllocation      *allocation );
+  DK_VULKAN_FUNC void DK_vkFreeMemory( DK_vkApplication *app, DK_vkAllocation *allocation );
+  DK_VULKAN_FUNC uint32_t DK_vkAddMemoryBlock( DK_vkApplication *app, DK_vkMemoryPool *pool );
+  DK_VULKAN_FUNC void     DK_vkReleaseMemoryBlock( DK_vkApplication *app, DK_vkMemoryBlock *block );
+  DK_VULKAN_FUNC uint32_t DK_vkGetBuddyOrder( VkDeviceSize size );
+  DK_VULKAN_FUNC void     DK_vkPushFreeRange( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize offset );
+  DK_VULKAN_FUNC bool     DK_vkTakeFreeRange( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize offset );
+  DK_VULKAN_FUNC bool     DK_vkBuddyAllocate( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize *offset );
+  DK_VULKAN_FUNC void     DK_vkBuddyFree( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize offset );
+  DK_VULKAN_FUNC void
+  DK_vkGetMemoryStats( DK_vkApplication *app, DK_vkMemoryPoolKind pool, DK_vkMemoryStats *stats );
+  DK_VULKAN_FUNC void DK_vkPrintMemoryStats( DK_vkApplication *app );
   DK_VULKAN_FUNC void
   DK_vkCopyBuffer( DK_vkApplication *app, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size );
+  DK_VULKAN_FUNC void DK_vkCopyBufferRegion( DK_vkApplication *app,
+                                             VkBuffer          srcBuffer,
+                                             VkBuffer          dstBuffer,
+                                             VkDeviceSize      srcOffset,
+                                             VkDeviceSize      dstOffset,
+                                             VkDeviceSize      size );
 
   DK_VULKAN_FUNC void DK_vkCreateBatchRenderer( DK_vkApplication *app );
   DK_VULKAN_FUNC void DK_vkDestroyBatchRenderer( DK_vkApplication *app );
   DK_VULKAN_FUNC void DK_vkBeginBatch( DK_vkApplication *app );
   DK_VULKAN_FUNC void DK_vkEndBatch( DK_vkApplication *app );
   DK_VULKAN_FUNC void DK_vkFlushBatch( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkCloseBatchSegment( DK_vkRenderer *renderer );
+  DK_VULKAN_FUNC DK_vkBatchCommand *DK_vkPushBatchCommand( DK_vkRenderer        *renderer,
+                                                           DK_vkBatchCommandType type,
+                                                           uint32_t              firstIndex,
+                                                           uint32_t              indexCount,
+                                                           uint32_t              stencilCompareMask );
 
   DK_VULKAN_FUNC void         DK_vkUpdateDescriptorSetLayout( DK_vkApplication *app );
   DK_VULKAN_FUNC DK_vkTexture DK_vkLoadTexture( DK_vkApplication *app, const char *filename );
@@ -284,33 +936,223 @@ extern "C"
   DK_VULKAN_FUNC void         DK_vkCreateTextureImage( DK_vkApplication *app,
                                                        const char       *filename,
                                                        VkImage          *image,
-                                                       VkDeviceMemory   *imageMemory,
+                                                       DK_vkAllocation  *imageMemory,
                                                        int32_t          *width,
                                                        int32_t          *height,
                                                        int32_t          *channels );
+  DK_VULKAN_FUNC void         DK_vkCreateTextureImageFromPixels( DK_vkApplication    *app,
+                                                                 const unsigned char *pixels,
+                                                                 uint32_t             width,
+                                                                 uint32_t             height,
+                                                                 VkImage             *image,
+                                                                 DK_vkAllocation     *imageMemory );
   DK_VULKAN_FUNC void         DK_vkCreateDummyTexture( DK_vkApplication *app );
-
+  DK_VULKAN_FUNC void         DK_vkCreateImage( DK_vkApplication     *app,
+                                                uint32_t              width,
+                                                uint32_t              height,
+                                                uint32_t              mipLevels,
+                                                VkFormat              format,
+                                                VkImageTiling         tiling,
+                                                VkImageUsageFlags     usage,
+                                                VkMemoryPropertyFlags properties,
+                                                VkImage              *image,
+                                                DK_vkAllocation      *imageMemory );
+  DK_VULKAN_FUNC void         DK_vkCreateImageEx( DK_vkApplication     *app,
+                                                  uint32_t              width,
+                                                  uint32_t              height,
+                                                  uint32_t              mipLevels,
+                                                  uint32_t              arrayLayers,
+                                                  VkFormat              format,
+                                                  VkImageTiling         tiling,
+                                                  VkImageUsageFlags     usage,
+                                                  VkMemoryPropertyFlags properties,
+                                                  VkImage              *image,
+                                                  DK_vkAllocation      *imageMemory );
+
+  DK_VULKAN_FUNC uint32_t DK_vkGetMipLevelCount( DK_vkApplication *app, uint32_t width, uint32_t height );
+  DK_VULKAN_FUNC void     DK_vkGenerateMipmaps( DK_vkApplication *app,
+                                            VkImage           image,
+                                            uint32_t          width,
+                                            uint32_t          height,
+                                            uint32_t          mipLevels,
+                                            uint32_t          layerCount );
   DK_VULKAN_FUNC void
   DK_vkCreateTextureImageView( DK_vkApplication *app, VkImage image, VkImageView *imageView );
+  DK_VULKAN_FUNC void DK_vkCreateTextureImageViewEx( DK_vkApplication *app,
+                                                     VkImage           image,
+                                                     VkFormat          format,
+                                                     VkImageView      *imageView );
+  DK_VULKAN_FUNC void DK_vkCreateTextureImageViewSwizzled( DK_vkApplication         *app,
+                                                           VkImage                   image,
+                                                           VkFormat                  format,
+                                                           const VkComponentMapping *components,
+                                                           VkImageView              *imageView );
   DK_VULKAN_FUNC void            DK_vkCreateTextureSampler( DK_vkApplication *app, VkSampler *sampler );
+  DK_VULKAN_FUNC void            DK_vkCreatePackedTextureSampler( DK_vkApplication *app, VkSampler *sampler );
+  DK_VULKAN_FUNC DK_vkSamplerState DK_vkGetDefaultSamplerState( DK_vkApplication *app );
+  DK_VULKAN_FUNC VkSampler DK_vkGetSampler( DK_vkApplication *app, const DK_vkSamplerState *state );
+  DK_VULKAN_FUNC void      DK_vkDestroySamplerCache( DK_vkApplication *app );
   DK_VULKAN_FUNC void            DK_vkTransitionImageLayout( DK_vkApplication *app,
                                                              VkImage           image,
                                                              VkFormat          format,
                                                              VkImageLayout     oldLayout,
                                                              VkImageLayout     newLayout );
+  DK_VULKAN_FUNC void            DK_vkCopyBufferToImageRegion( DK_vkApplication *app,
+                                                                VkBuffer          buffer,
+                                                                VkDeviceSize      bufferOffset,
+                                                                VkImage           image,
+                                                                int32_t           x,
+                                                                int32_t           y,
+                                                                uint32_t          width,
+                                                                uint32_t          height );
   DK_VULKAN_FUNC void            DK_vkCopyBufferToImage( DK_vkApplication *app,
                                                          VkBuffer          buffer,
                                                          VkImage           image,
                                                          uint32_t          width,
                                                          uint32_t          height );
+  DK_VULKAN_FUNC void            DK_vkCopyBufferToImageLayer( DK_vkApplication *app,
+                                                              VkBuffer          buffer,
+                                                              VkDeviceSize      bufferOffset,
+                                                              VkImage           image,
+                                                              uint32_t          layer,
+                                                              uint32_t          width,
+                                                              uint32_t          height );
   DK_VULKAN_FUNC VkCommandBuffer DK_vkBeginSingleTimeCommands( DK_vkApplication *app );
+  DK_VULKAN_FUNC void            DK_vkBeginUploads( DK_vkApplication *app );
+  DK_VULKAN_FUNC void            DK_vkEndUploads( DK_vkApplication *app, bool wait );
+  DK_VULKAN_FUNC void            DK_vkFinishUploads( DK_vkApplication *app );
+  DK_VULKAN_FUNC void            DK_vkPollUploads( DK_vkApplication *app );
+  DK_VULKAN_FUNC void            DK_vkDestroyUploadContext( DK_vkApplication *app );
+  DK_VULKAN_FUNC DK_vkStagingChunk *DK_vkAddStagingChunk( DK_vkApplication *app, VkDeviceSize size );
+  DK_VULKAN_FUNC DK_vkStagingAllocation DK_vkAllocateStaging( DK_vkApplication *app, VkDeviceSize size );
+  DK_VULKAN_FUNC DK_vkStagingAllocation
+  DK_vkStageData( DK_vkApplication *app, const void *data, VkDeviceSize size );
+  DK_VULKAN_FUNC void DK_vkRetireStaging( DK_vkApplication *app, uint64_t serial );
+  DK_VULKAN_FUNC void DK_vkDestroyStagingBelt( DK_vkApplication *app );
+  DK_VULKAN_FUNC uint32_t DK_vkCreateDynamicTexture( DK_vkApplication *app, uint32_t width, uint32_t height );
+  DK_VULKAN_FUNC void     DK_vkUpdateTextureRegion( DK_vkApplication    *app,
+                                                uint32_t             textureId,
+                                                int32_t              x,
+                                                int32_t              y,
+                                                uint32_t             width,
+                                                uint32_t             height,
+                                                const unsigned char *pixels,
+                                                uint32_t             stride );
+  DK_VULKAN_FUNC void DK_vkRecordTextureUpdates( DK_vkApplication *app, VkCommandBuffer commandBuffer );
+  DK_VULKAN_FUNC void DK_vkRecordTextureCopy( VkCommandBuffer commandBuffer,
+                                              VkBuffer        buffer,
+                                              VkDeviceSize    bufferOffset,
+                                              VkImage         image,
+                                              int32_t         x,
+                                              int32_t         y,
+                                              uint32_t        width,
+                                              uint32_t        height );
+  DK_VULKAN_FUNC void DK_vkDestroyTextureUpdateRing( DK_vkApplication *app );
   DK_VULKAN_FUNC void DK_vkEndSingleTimeCommands( DK_vkApplication *app, VkCommandBuffer commandBuffer );
 
   DK_VULKAN_FUNC void     DK_vkInitTextureSystem( DK_vkApplication *app );
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureCapacity( DK_vkApplication *app );
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureSlotCount( DK_vkApplication *app );
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureTableCount( DK_vkApplication *app );
+  DK_VULKAN_FUNC uint32_t DK_vkFindTextureSlot( DK_vkRenderer *renderer, uint32_t table, uint32_t index );
+  DK_VULKAN_FUNC int32_t  DK_vkAcquireTextureSlot( DK_vkApplication *app, uint32_t index );
+  DK_VULKAN_FUNC void     DK_vkMarkDescriptorsDirty( DK_vkApplication *app, uint32_t bindingMask );
+  DK_VULKAN_FUNC void     DK_vkMarkTextureDirty( DK_vkApplication *app, uint32_t index );
+  DK_VULKAN_FUNC void     DK_vkUpdateFrameDescriptorSet( DK_vkApplication *app, uint32_t frame );
+  DK_VULKAN_FUNC void     DK_vkUpdateTextureTableSet( DK_vkApplication *app, uint32_t frame, uint32_t table );
+  DK_VULKAN_FUNC bool     DK_vkHasDeviceExtension( VkPhysicalDevice device, const char *name );
+  DK_VULKAN_FUNC void     DK_vkQueryBindlessSupport( DK_vkApplication *app );
+  DK_VULKAN_FUNC void     DK_vkQueryMipmapSupport( DK_vkApplication *app );
+  DK_VULKAN_FUNC void     DK_vkWriteTextureDescriptors( DK_vkApplication *app,
+                                                    VkDescriptorSet   set,
+                                                    uint32_t          first,
+                                                    uint32_t          count );
   DK_VULKAN_FUNC uint32_t DK_vkAddTexture( DK_vkApplication *app, const char *filename );
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureKTX2( DK_vkApplication *app, const char *filename );
+  DK_VULKAN_FUNC bool
+  DK_vkLoadTextureKTX2( DK_vkApplication *app, const char *filename, DK_vkTexture *texture );
+  DK_VULKAN_FUNC uint32_t DK_vkGetFormatCompression( VkFormat format );
+  DK_VULKAN_FUNC bool     DK_vkGetFormatBlockSize( VkFormat  format,
+                                                   uint32_t *blockWidth,
+                                                   uint32_t *blockHeight,
+                                                   uint32_t *blockBytes );
+  DK_VULKAN_FUNC bool     DK_vkIsTextureFormatSupported( DK_vkApplication *app, VkFormat format );
+  DK_VULKAN_FUNC uint32_t DK_vkRegisterTexture( DK_vkApplication *app, DK_vkTexture texture );
+  DK_VULKAN_FUNC uint32_t DK_vkMakeTextureHandle( uint32_t index, uint32_t generation );
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureIndex( DK_vkApplication *app, uint32_t textureId );
+  DK_VULKAN_FUNC DK_vkTexture *DK_vkGetTexture( DK_vkApplication *app, uint32_t textureId );
+  DK_VULKAN_FUNC bool          DK_vkHasFreeTextureSlot( DK_vkApplication *app );
+  DK_VULKAN_FUNC void          DK_vkRemoveTexture( DK_vkApplication *app, uint32_t textureId );
+  DK_VULKAN_FUNC void          DK_vkReleaseRetiredTextures( DK_vkApplication *app );
+  DK_VULKAN_FUNC uint64_t DK_vkHashImage( const DK_vkImageData *image, uint64_t *digest );
+  DK_VULKAN_FUNC uint32_t DK_vkFindTextureBySource( DK_vkApplication *app, const char *filename );
+  DK_VULKAN_FUNC void     DK_vkAddTextureAlias( DK_vkApplication *app, uint32_t index, const char *filename );
+  DK_VULKAN_FUNC void     DK_vkRemoveTextureAliases( DK_vkApplication *app, uint32_t index );
+  DK_VULKAN_FUNC uint32_t DK_vkFindTextureByHash(
+      DK_vkApplication *app, uint64_t hash, uint64_t digest, int32_t width, int32_t height );
+  DK_VULKAN_FUNC uint32_t DK_vkRetainTexture( DK_vkApplication *app, uint32_t index );
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureFromImage( DK_vkApplication     *app,
+                                                    const DK_vkImageData *image,
+                                                    const char           *filename );
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureAsync( DK_vkApplication *app, const char *filename );
+  DK_VULKAN_FUNC uint32_t
+  DK_vkAddTextures( DK_vkApplication *app, const char **paths, uint32_t count, uint32_t *outIds );
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureArray( DK_vkApplication *app, const char **paths, uint32_t count );
+  DK_VULKAN_FUNC void *DK_vkDecodeWorker( void *userData );
+  DK_VULKAN_FUNC void  DK_vkCreateTextureFromImage( DK_vkApplication     *app,
+                                                    const DK_vkImageData *image,
+                                                    DK_vkTexture         *texture );
+  DK_VULKAN_FUNC void
+  DK_vkQueueTextureJob( DK_vkApplication *app, uint32_t textureId, const char *filename );
+  DK_VULKAN_FUNC bool     DK_vkIsTextureResident( DK_vkApplication *app, uint32_t textureId );
+  DK_VULKAN_FUNC void
+  DK_vkSetTextureSampling( DK_vkApplication *app, uint32_t textureId, const DK_vkSamplerState *state );
+
+  DK_VULKAN_FUNC DK_vkTexture *DK_vkGetResidentTexture( DK_vkApplication *app, uint32_t index );
+  DK_VULKAN_FUNC void          DK_vkStartTextureStreaming( DK_vkApplication *app );
+  DK_VULKAN_FUNC void          DK_vkStopTextureStreaming( DK_vkApplication *app );
+  DK_VULKAN_FUNC void          DK_vkPollTextureStreaming( DK_vkApplication *app );
   DK_VULKAN_FUNC void     DK_vkSetTexture( DK_vkApplication *app, uint32_t textureId );
   DK_VULKAN_FUNC void     DK_vkUpdateDescriptorSetWithTexture( DK_vkApplication *app, DK_vkTexture *texture );
 
+  DK_VULKAN_FUNC uint64_t DK_vkHashBytes( const void *data, size_t size, uint64_t hash );
+  DK_VULKAN_FUNC uint64_t DK_vkHashWords( const void *data, size_t size, uint64_t seed );
+  DK_VULKAN_FUNC void     DK_vkSetTextureCacheDirectory( DK_vkApplication *app, const char *directory );
+  DK_VULKAN_FUNC void
+  DK_vkGetTextureCachePath( const char *directory, const char *filename, char *path, size_t pathSize );
+  DK_VULKAN_FUNC bool DK_vkHashFile( const char *filename, uint64_t *hash );
+  DK_VULKAN_FUNC bool DK_vkReadTextureCache( const char        *directory,
+                                             const char        *filename,
+                                             const struct stat *source,
+                                             DK_vkImageData    *image );
+  DK_VULKAN_FUNC void DK_vkWriteTextureCache( const char           *directory,
+                                              const char           *filename,
+                                              const struct stat    *source,
+                                              const DK_vkImageData *image );
+  DK_VULKAN_FUNC bool
+  DK_vkLoadImage( const char *cacheDirectory, const char *filename, DK_vkImageData *image );
+  DK_VULKAN_FUNC void DK_vkFreeImage( DK_vkImageData *image );
+  DK_VULKAN_FUNC bool DK_vkDecodeImageFile( const char *filename, DK_vkImageData *image );
+  DK_VULKAN_FUNC bool
+  DK_vkReadImageInfo( const char *filename, int32_t *width, int32_t *height, int32_t *channels );
+  DK_VULKAN_FUNC uint32_t DK_vkReadBigEndian32( const uint8_t *bytes );
+  DK_VULKAN_FUNC bool     DK_vkIsQOI( const uint8_t *data, size_t size );
+  DK_VULKAN_FUNC bool DK_vkReadQOIHeader(
+      const uint8_t *data, size_t size, int32_t *width, int32_t *height, int32_t *channels );
+  DK_VULKAN_FUNC unsigned char *DK_vkDecodeQOI(
+      const uint8_t *data, size_t size, int32_t *width, int32_t *height, int32_t *channels );
+
+  DK_VULKAN_FUNC char        *DK_vkCopyString( const char *string );
+  DK_VULKAN_FUNC void         DK_vkQueryMemoryBudgetSupport( DK_vkApplication *app );
+  DK_VULKAN_FUNC void         DK_vkSetTextureBudget( DK_vkApplication *app, VkDeviceSize bytes );
+  DK_VULKAN_FUNC VkDeviceSize DK_vkGetTextureMemoryUsage( DK_vkApplication *app );
+  DK_VULKAN_FUNC VkDeviceSize DK_vkGetMemoryOverBudget( DK_vkApplication *app );
+  DK_VULKAN_FUNC void         DK_vkTouchTexture( DK_vkApplication *app, uint32_t index );
+  DK_VULKAN_FUNC bool         DK_vkCanDemoteTexture( DK_vkTexture *texture );
+  DK_VULKAN_FUNC void         DK_vkDemoteTexture( DK_vkApplication *app, DK_vkTexture *texture );
+  DK_VULKAN_FUNC void         DK_vkEvictTexture( DK_vkApplication *app, DK_vkTexture *texture );
+  DK_VULKAN_FUNC void         DK_vkUpdateResidency( DK_vkApplication *app );
+
   DK_VULKAN_FUNC void
   DK_vkDrawTriangle( DK_vkApplication *app, DK_vkVec2 p1, DK_vkVec2 p2, DK_vkVec3 p3, DK_vkColor tint );
 
@@ -348,6 +1190,75 @@ extern "C"
                                        DK_vkColor        tint,
                                        int32_t           segments );
 
+  DK_VULKAN_FUNC bool DK_vkReserveBatch( DK_vkApplication *app, uint32_t vertexCount, uint32_t indexCount );
+
+  DK_VULKAN_FUNC void DK_vkDrawPolygon( DK_vkApplication *app,
+                                        const DK_vkVec2  *points,
+                                        uint32_t          pointCount,
+                                        DK_vkColor        tint );
+
+  DK_VULKAN_FUNC void DK_vkDrawPolygonWithHoles( DK_vkApplication *app,
+                                                 const DK_vkVec2  *points,
+                                                 uint32_t          pointCount,
+                                                 const uint32_t   *holeStarts,
+                                                 uint32_t          holeCount,
+                                                 DK_vkColor        tint );
+
+  DK_VULKAN_FUNC void DK_vkDestroyPolygonCache( DK_vkApplication *app );
+
+  DK_VULKAN_FUNC void DK_vkCreateStencilResources( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkDestroyStencilResources( DK_vkApplication *app );
+
+  DK_VULKAN_FUNC void DK_vkCreateShapeCache( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkDestroyShapeCache( DK_vkApplication *app );
+  DK_VULKAN_FUNC bool DK_vkDrawCachedShape( DK_vkApplication *app,
+                                            DK_vkShapeType    type,
+                                            DK_vkVec2         position,
+                                            DK_vkSize         size,
+                                            float             radius,
+                                            DK_vkColor        tint,
+                                            int32_t           segments );
+
+  DK_VULKAN_FUNC void DK_vkCreateShadowBatch( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkDestroyShadowBatch( DK_vkApplication *app );
+  DK_VULKAN_FUNC void DK_vkDrawShadowRect( DK_vkApplication *app,
+                                           DK_vkVec2         position,
+                                           DK_vkSize         size,
+                                           float             blur,
+                                           DK_vkColor        color );
+  DK_VULKAN_FUNC void DK_vkDrawShadowRoundedRect( DK_vkApplication *app,
+                                                  DK_vkVec2         position,
+                                                  DK_vkSize         size,
+                                                  float             radius,
+                                                  float             blur,
+                                                  DK_vkColor        color );
+
+  DK_VULKAN_FUNC DK_vkAtlas DK_vkCreateAtlas( DK_vkApplication *app, uint32_t pageSize );
+  DK_VULKAN_FUNC void       DK_vkDestroyAtlas( DK_vkApplication *app, DK_vkAtlas *atlas );
+  DK_VULKAN_FUNC uint32_t   DK_vkAtlasAddImage( DK_vkApplication *app,
+                                                DK_vkAtlas       *atlas,
+                                                const char       *filename );
+  DK_VULKAN_FUNC uint32_t   DK_vkAtlasAddPixels( DK_vkApplication    *app,
+                                                 DK_vkAtlas          *atlas,
+                                                 const unsigned char *pixels,
+                                                 uint32_t             width,
+                                                 uint32_t             height );
+  DK_VULKAN_FUNC DK_vkAtlasRegion *DK_vkGetAtlasRegion( DK_vkAtlas *atlas, uint32_t region );
+  DK_VULKAN_FUNC void              DK_vkDrawAtlasRegion( DK_vkApplication *app,
+                                                         DK_vkAtlas       *atlas,
+                                                         uint32_t          region,
+                                                         DK_vkVec2         position,
+                                                         DK_vkSize         size,
+                                                         DK_vkColor        tint );
+
+  DK_VULKAN_FUNC void DK_vkDrawPath( DK_vkApplication *app,
+                                     const DK_vkVec2  *points,
+                                     uint32_t          pointCount,
+                                     const uint32_t   *contourStarts,
+                                     uint32_t          contourCount,
+                                     DK_vkFillRule     fillRule,
+                                     DK_vkColor        tint );
+
   DK_VULKAN_FUNC void DK_vkDrawTexturedQuad( DK_vkApplication *app,
                                              DK_vkVec2         position,
                                              DK_vkSize         size,
@@ -355,6 +1266,14 @@ extern "C"
                                              DK_vkVec2         uv2,
                                              DK_vkColor        tint,
                                              int32_t           samplerId );
+  DK_VULKAN_FUNC void DK_vkDrawTexturedQuadLayer( DK_vkApplication *app,
+                                                  DK_vkVec2         position,
+                                                  DK_vkSize         size,
+                                                  DK_vkVec2         uv1,
+                                                  DK_vkVec2         uv2,
+                                                  DK_vkColor        tint,
+                                                  uint32_t          textureId,
+                                                  uint32_t          layer );
 
   DK_VULKAN_FUNC void DK_vkDrawTexture( DK_vkApplication *app,
                                         DK_vkVec2         position,
@@ -362,6 +1281,13 @@ extern "C"
                                         float             scale,
                                         DK_vkColor        tint );
 
+  DK_VULKAN_FUNC void DK_vkDrawTextureLayer( DK_vkApplication *app,
+                                             DK_vkVec2         position,
+                                             uint32_t          textureId,
+                                             uint32_t          layer,
+                                             float             scale,
+                                             DK_vkColor        tint );
+
   DK_VULKAN_FUNC void DK_vkDrawTextureRegion( DK_vkApplication *app,
                                               DK_vkVec2         position,
                                               DK_vkSize         size,
@@ -370,6 +1296,12 @@ extern "C"
                                               DK_vkSize         region_size,
                                               DK_vkColor        tinit );
 
+  DK_VULKAN_FUNC void DK_vkDrawNineSlice( DK_vkApplication *app,
+                                          uint32_t          textureId,
+                                          DK_vkVec4         borders,
+                                          DK_vkVec4         rect,
+                                          DK_vkColor        tint );
+
   DK_VULKAN_FUNC void DK_vkFlushBatchWithTexture( DK_vkApplication *app );
   DK_VULKAN_FUNC void DK_vkCleanupTextureSystem( DK_vkApplication *app );
 
@@ -402,6 +1334,7 @@ extern "C"
                                                           const VkAllocationCallbacks *pAllocator );
 
   DK_VULKAN_FUNC unsigned char *DK_vkReadFile( const char *filename, size_t *size );
+  DK_VULKAN_FUNC unsigned char *DK_vkTryReadFile( const char *filename, size_t *size );
 
   DK_VULKAN_FUNC DK_vkFont DK_vkLoadFont( DK_vkApplication *app, const char *filename, int32_t baseSize );
   DK_VULKAN_FUNC void      DK_vkUnloadFont( DK_vkApplication *app, DK_vkFont *font );
@@ -437,11 +1370,37 @@ extern "C"
   const bool enableValidationLayers = true;
 #endif
 
-  unsigned char *vertShaderCode = NULL;
-  unsigned char *fragShaderCode = NULL;
+#ifdef DK_VK_ENABLE_STENCIL
+  const bool enableStencilAttachment = true;
+#else
+  const bool enableStencilAttachment = false;
+#endif
+
+#ifdef DK_VK_ENABLE_BINDLESS
+  const bool enableBindlessTextures = true;
+#else
+  const bool enableBindlessTextures = false;
+#endif
+
+#ifdef DK_VK_ENABLE_MIPMAPS
+  const bool enableTextureMipmaps = true;
+#else
+  const bool enableTextureMipmaps = false;
+#endif
+
+  unsigned char *vertShaderCode       = NULL;
+  unsigned char *fragShaderCode       = NULL;
+  unsigned char *bindlessFragShaderCode = NULL;
+  unsigned char *shapeVertShaderCode  = NULL;
+  unsigned char *shadowVertShaderCode = NULL;
+  unsigned char *shadowFragShaderCode = NULL;
 
   size_t vertShaderCodeSize;
   size_t fragShaderCodeSize;
+  size_t bindlessFragShaderCodeSize;
+  size_t shapeVertShaderCodeSize;
+  size_t shadowVertShaderCodeSize;
+  size_t shadowFragShaderCodeSize;
 
   const DK_Vertex vertices[] = {
       { { 0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
@@ -450,12 +1409,24 @@ extern "C"
   };
 
   DK_VULKAN_FUNC unsigned char *DK_vkReadFile( const char *filename, size_t *size )
+  {
+    unsigned char *buffer = DK_vkTryReadFile( filename, size );
+    if ( buffer == NULL )
+    {
+      exit( 1 );
+    }
+
+    return buffer;
+  }
+
+  // reports the failure and returns NULL, for files the caller can do without
+  DK_VULKAN_FUNC unsigned char *DK_vkTryReadFile( const char *filename, size_t *size )
   {
     int32_t fd = open( filename, O_RDONLY );
     if ( fd == -1 )
     {
       fprintf( stderr, "Failed to open file: %s\n", filename );
-      exit( 1 );
+      return NULL;
     }
 
     struct stat st;
@@ -463,7 +1434,7 @@ extern "C"
     {
       fprintf( stderr, "Failed to get file size: %s\n", filename );
       close( fd );
-      exit( 1 );
+      return NULL;
     }
 
     unsigned char *buffer    = (unsigned char *)malloc( st.st_size );
@@ -474,7 +1445,7 @@ extern "C"
       fprintf( stderr, "Failed to read file: %s\n", filename );
       free( buffer );
       close( fd );
-      exit( 1 );
+      return NULL;
     }
 
     close( fd );
@@ -486,13 +1457,12 @@ extern "C"
                                                uint32_t              typeFilter,
                                                VkMemoryPropertyFlags properties )
   {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties( app->physicalDevice, &memProperties );
+    VkPhysicalDeviceMemoryProperties *memProperties = &app->allocator.memoryProperties;
 
-    for ( uint32_t i = 0; i < memProperties.memoryTypeCount; i++ )
+    for ( uint32_t i = 0; i < memProperties->memoryTypeCount; i++ )
     {
       if ( ( typeFilter & ( 1 << i ) ) &&
-           ( memProperties.memoryTypes[i].propertyFlags & properties ) == properties )
+           ( memProperties->memoryTypes[i].propertyFlags & properties ) == properties )
       {
         return i;
       }
@@ -507,7 +1477,18 @@ extern "C"
                                          VkBufferUsageFlags    usage,
                                          VkMemoryPropertyFlags properties,
                                          VkBuffer             *buffer,
-                                         VkDeviceMemory       *bufferMemory )
+                                         DK_vkAllocation      *bufferMemory )
+  {
+    DK_vkCreateBufferEx( app, size, usage, properties, DK_VK_MEMORY_POOL_BUDDY, buffer, bufferMemory );
+  }
+
+  DK_VULKAN_FUNC void DK_vkCreateBufferEx( DK_vkApplication     *app,
+                                           VkDeviceSize          size,
+                                           VkBufferUsageFlags    usage,
+                                           VkMemoryPropertyFlags properties,
+                                           DK_vkMemoryPoolKind   pool,
+                                           VkBuffer             *buffer,
+                                           DK_vkAllocation      *bufferMemory )
   {
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -524,97 +1505,61 @@ extern "C"
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements( app->device, *buffer, &memRequirements );
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize       = memRequirements.size;
-    allocInfo.memoryTypeIndex      = DK_vkFindMemoryType( app, memRequirements.memoryTypeBits, properties );
-
-    if ( vkAllocateMemory( app->device, &allocInfo, NULL, bufferMemory ) != VK_SUCCESS )
-    {
-      fprintf( stderr, "Failed to allocate buffer memory\n" );
-      exit( 1 );
-    }
-
-    vkBindBufferMemory( app->device, *buffer, *bufferMemory, 0 );
+    DK_vkAllocateMemory( app, memRequirements, properties, pool, bufferMemory );
+    vkBindBufferMemory( app->device, *buffer, bufferMemory->memory, bufferMemory->offset );
   }
 
   DK_VULKAN_FUNC void
   DK_vkCopyBuffer( DK_vkApplication *app, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size )
   {
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool                 = app->commandPool;
-    allocInfo.commandBufferCount          = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers( app->device, &allocInfo, &commandBuffer );
-
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    DK_vkCopyBufferRegion( app, srcBuffer, dstBuffer, 0, 0, size );
+  }
 
-    vkBeginCommandBuffer( commandBuffer, &beginInfo );
+  DK_VULKAN_FUNC void DK_vkCopyBufferRegion( DK_vkApplication *app,
+                                             VkBuffer          srcBuffer,
+                                             VkBuffer          dstBuffer,
+                                             VkDeviceSize      srcOffset,
+                                             VkDeviceSize      dstOffset,
+                                             VkDeviceSize      size )
+  {
+    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
 
     VkBufferCopy copyRegion = { 0 };
-    copyRegion.srcOffset    = 0;
-    copyRegion.dstOffset    = 0;
+    copyRegion.srcOffset    = srcOffset;
+    copyRegion.dstOffset    = dstOffset;
     copyRegion.size         = size;
     vkCmdCopyBuffer( commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion );
 
-    vkEndCommandBuffer( commandBuffer );
-
-    VkSubmitInfo submitInfo       = {};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffer;
-
-    vkQueueSubmit( app->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
-    vkQueueWaitIdle( app->graphicsQueue );
-
-    vkFreeCommandBuffers( app->device, app->commandPool, 1, &commandBuffer );
+    DK_vkEndSingleTimeCommands( app, commandBuffer );
   }
 
   DK_VULKAN_FUNC void DK_vkCreateVertexBuffer( DK_vkApplication *app )
   {
     VkDeviceSize bufferSize = sizeof( vertices );
 
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    DK_vkCreateBuffer( app,
-                       bufferSize,
-                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &stagingBuffer,
-                       &stagingBufferMemory );
-
-    void *data;
-    vkMapMemory( app->device, stagingBufferMemory, 0, bufferSize, 0, &data );
-    memcpy( data, vertices, bufferSize );
-    vkUnmapMemory( app->device, stagingBufferMemory );
-
-    DK_vkCreateBuffer( app,
-                       bufferSize,
-                       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                       &app->vertexBuffer,
-                       &app->vertexBufferMemory );
+    DK_vkStagingAllocation staging = DK_vkStageData( app, vertices, bufferSize );
 
-    DK_vkCopyBuffer( app, stagingBuffer, app->vertexBuffer, bufferSize );
+    DK_vkCreateBufferEx( app,
+                         bufferSize,
+                         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &app->vertexBuffer,
+                         &app->vertexBufferMemory );
 
-    vkDestroyBuffer( app->device, stagingBuffer, NULL );
-    vkFreeMemory( app->device, stagingBufferMemory, NULL );
+    DK_vkCopyBufferRegion( app, staging.buffer, app->vertexBuffer, staging.offset, 0, bufferSize );
   }
 
   DK_VULKAN_FUNC void DK_vkCreateUniformBuffer( DK_vkApplication *app )
   {
     VkDeviceSize bufferSize = sizeof( DK_vkUniformBufferObject );
-    DK_vkCreateBuffer( app,
-                       bufferSize,
-                       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &app->uniformBuffer,
-                       &app->uniformBufferMemory );
+    DK_vkCreateBufferEx( app,
+                         bufferSize,
+                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &app->uniformBuffer,
+                         &app->uniformBufferMemory );
   }
 
   DK_VULKAN_FUNC void DK_vkCreateDescriptorSetLayoutEx( DK_vkApplication *app )
@@ -629,7 +1574,7 @@ extern "C"
 
     bindings[1].binding            = 1;
     bindings[1].descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[1].descriptorCount    = DK_VK_MAX_TEXTURES;
+    bindings[1].descriptorCount    = DK_vkGetTextureSlotCount( app );
     bindings[1].stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
     bindings[1].pImmutableSamplers = NULL;
 
@@ -638,6 +1583,23 @@ extern "C"
     layoutInfo.bindingCount                    = 2;
     layoutInfo.pBindings                       = bindings;
 
+    // bindless: the sampler array may have holes and is written while the set is bound
+    VkDescriptorBindingFlagsEXT bindingFlags[2] = {
+        0,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+    bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount  = 2;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    if ( app->bindlessTextures )
+    {
+      layoutInfo.pNext = &bindingFlagsInfo;
+      layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    }
+
     if ( vkCreateDescriptorSetLayout( app->device, &layoutInfo, NULL, &app->descriptorSetLayout ) !=
          VK_SUCCESS )
     {
@@ -650,17 +1612,24 @@ extern "C"
   {
     VkDescriptorPoolSize poolSizes[2] = {};
 
+    uint32_t setCount = DK_vkGetTextureTableCount( app ) * DK_VULKAN_MAX_FRAMES_IN_FLIGHT;
+
     poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 1;
+    poolSizes[0].descriptorCount = setCount;
 
     poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = DK_VK_MAX_TEXTURES;
+    poolSizes[1].descriptorCount = DK_vkGetTextureSlotCount( app ) * setCount;
 
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount              = 2;
     poolInfo.pPoolSizes                 = poolSizes;
-    poolInfo.maxSets                    = 1;
+    poolInfo.maxSets                    = setCount;
+
+    if ( app->bindlessTextures )
+    {
+      poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    }
 
     if ( vkCreateDescriptorPool( app->device, &poolInfo, NULL, &app->descriptorPool ) != VK_SUCCESS )
     {
@@ -671,71 +1640,34 @@ extern "C"
 
   DK_VULKAN_FUNC void DK_vkUpdateDescriptorSetWithTextures( DK_vkApplication *app )
   {
-    VkDescriptorBufferInfo bufferInfo = { 0 };
-    bufferInfo.buffer                 = app->uniformBuffer;
-    bufferInfo.offset                 = 0;
-    bufferInfo.range                  = sizeof( DK_vkUniformBufferObject );
-
-    VkDescriptorImageInfo imageInfos[DK_VK_MAX_TEXTURES];
-    for ( uint32_t i = 0; i < DK_VK_MAX_TEXTURES; i++ )
-    {
-      uint32_t texIndex         = i < app->textureCount ? i : 0; // use texture 0 as fallback
-      imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfos[i].imageView   = app->textures[texIndex].view;
-      imageInfos[i].sampler     = app->textures[texIndex].sampler;
-    }
-
-    VkWriteDescriptorSet descriptorWrites[2] = {};
-
-    descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet          = app->descriptorSet;
-    descriptorWrites[0].dstBinding      = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo     = &bufferInfo;
-
-    descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet          = app->descriptorSet;
-    descriptorWrites[1].dstBinding      = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = DK_VK_MAX_TEXTURES;
-    descriptorWrites[1].pImageInfo      = imageInfos;
-
-    vkUpdateDescriptorSets( app->device, 2, descriptorWrites, 0, NULL );
+    DK_vkMarkDescriptorsDirty( app, DK_VK_DESCRIPTOR_BINDING_TEXTURES );
   }
 
   DK_VULKAN_FUNC void DK_vkCreateDescriptorSetEx( DK_vkApplication *app )
   {
+    VkDescriptorSetLayout layouts[DK_VK_MAX_TEXTURE_TABLES];
+    for ( uint32_t i = 0; i < DK_VK_MAX_TEXTURE_TABLES; i++ )
+    {
+      layouts[i] = app->descriptorSetLayout;
+    }
+
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool              = app->descriptorPool;
-    allocInfo.descriptorSetCount          = 1;
-    allocInfo.pSetLayouts                 = &app->descriptorSetLayout;
+    allocInfo.descriptorSetCount          = DK_vkGetTextureTableCount( app );
+    allocInfo.pSetLayouts                 = layouts;
 
-    if ( vkAllocateDescriptorSets( app->device, &allocInfo, &app->descriptorSet ) != VK_SUCCESS )
+    for ( uint32_t i = 0; i < DK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++ )
     {
-      fprintf( stderr, "Failed to allocate descriptor set\n" );
-      exit( 1 );
+      if ( vkAllocateDescriptorSets( app->device, &allocInfo, app->descriptorSets[i] ) != VK_SUCCESS )
+      {
+        fprintf( stderr, "Failed to allocate descriptor set\n" );
+        exit( 1 );
+      }
     }
 
-    VkDescriptorBufferInfo bufferInfo = { 0 };
-    bufferInfo.buffer                 = app->uniformBuffer;
-    bufferInfo.offset                 = 0;
-    bufferInfo.range                  = sizeof( DK_vkUniformBufferObject );
-
-    VkWriteDescriptorSet descriptorWrites[1] = {};
-
-    descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet          = app->descriptorSet;
-    descriptorWrites[0].dstBinding      = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo     = &bufferInfo;
-
-    vkUpdateDescriptorSets( app->device, 1, descriptorWrites, 0, NULL );
+    // the sets are filled in by DK_vkUpdateFrameDescriptorSet before their first use
+    DK_vkMarkDescriptorsDirty( app, DK_VK_DESCRIPTOR_BINDING_UNIFORM | DK_VK_DESCRIPTOR_BINDING_TEXTURES );
   }
 
   DK_VULKAN_FUNC void DK_vkUpdateUniformBuffer( DK_vkApplication *app )
@@ -746,16 +1678,7 @@ extern "C"
     DK_vkIdentityMatrix( ubo.proj );
     DK_vkOrtho( app->camera.left, app->camera.right, app->camera.bottom, app->camera.top, app->camera.near, app->camera.far, ubo.proj );
 
-    void *data;
-    VkResult result = vkMapMemory( app->device, app->uniformBufferMemory, 0, sizeof( ubo ), 0, &data );
-    if ( result != VK_SUCCESS )
-    {
-      fprintf( stderr, "Failed to map uniform buffer memory\n" );
-      exit( 1 );
-    }
-    
-    memcpy( data, &ubo, sizeof( ubo ) );
-    vkUnmapMemory( app->device, app->uniformBufferMemory );
+    memcpy( app->uniformBufferMemory.mapped, &ubo, sizeof( ubo ) );
   }
 
   DK_VULKAN_FUNC void DK_vkFramebufferResizeCallback( GLFWwindow *window, int32_t width, int32_t height )
@@ -836,7 +1759,7 @@ extern "C"
     {
       if ( app->textures == NULL )
       {
-        app->maxTextures  = DK_VK_MAX_TEXTURES;
+        app->maxTextures  = DK_vkGetTextureCapacity( app );
         app->textureCount = 0;
         app->textures     = (DK_vkTexture *)malloc( sizeof( DK_vkTexture ) * app->maxTextures );
       }
@@ -844,37 +1767,8 @@ extern "C"
       DK_vkCreateDummyTexture( app );
     }
 
-    DK_vkTexture          *texture    = app->currentTexture ? app->currentTexture : &app->textures[0];
-    VkDescriptorImageInfo *imageInfos = malloc( app->maxTextures * sizeof( VkDescriptorImageInfo ) );
-    for ( uint32_t i = 0; i < app->maxTextures; i++ )
-    {
-      if ( i < app->textureCount )
-      {
-        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfos[i].imageView   = app->textures[i].view;
-        imageInfos[i].sampler     = app->textures[i].sampler;
-      }
-      else
-      {
-        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfos[i].imageView   = app->textures[0].view;
-        imageInfos[i].sampler     = app->textures[0].sampler;
-      }
-    }
-
-    VkWriteDescriptorSet descriptorWrite = {};
-    descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet               = app->descriptorSet;
-    descriptorWrite.dstBinding           = 1;
-    descriptorWrite.dstArrayElement      = 0;
-    descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.descriptorCount      = app->maxTextures;
-    descriptorWrite.pImageInfo           = imageInfos;
-
-    vkUpdateDescriptorSets( app->device, 1, &descriptorWrite, 0, NULL );
-
-    free( imageInfos );
-  }
+    DK_vkMarkDescriptorsDirty( app, DK_VK_DESCRIPTOR_BINDING_TEXTURES );
+  }
 
   DK_VULKAN_FUNC void DK_vkGetWindowScale( DK_vkApplication *app, float *scaleX, float *scaleY )
   {
@@ -890,8 +1784,15 @@ extern "C"
 
   DK_VULKAN_FUNC void DK_vkInitApp( DK_vkApplication *app, int32_t width, int32_t height, const char *title )
   {
-    vertShaderCode = DK_vkReadFile( "vert.spv", &vertShaderCodeSize );
-    fragShaderCode = DK_vkReadFile( "frag.spv", &fragShaderCodeSize );
+    vertShaderCode       = DK_vkReadFile( "vert.spv", &vertShaderCodeSize );
+    fragShaderCode       = DK_vkReadFile( "frag.spv", &fragShaderCodeSize );
+    shapeVertShaderCode  = DK_vkReadFile( "shape_vert.spv", &shapeVertShaderCodeSize );
+    if ( enableBindlessTextures )
+    {
+      bindlessFragShaderCode = DK_vkReadFile( "frag_bindless.spv", &bindlessFragShaderCodeSize );
+    }
+    shadowVertShaderCode = DK_vkReadFile( "shadow_vert.spv", &shadowVertShaderCodeSize );
+    shadowFragShaderCode = DK_vkReadFile( "shadow_frag.spv", &shadowFragShaderCodeSize );
 
     glfwInit();
 
@@ -921,6 +1822,7 @@ extern "C"
     DK_vkCreateSurface( app );
     DK_vkPickPhysicalDevice( app );
     DK_vkCreateLogicalDevice( app );
+    DK_vkInitMemoryAllocator( app );
 
     DK_vkCreateDescriptorSetLayoutEx( app );
 
@@ -928,6 +1830,7 @@ extern "C"
     DK_vkCreateImageViews( app );
     DK_vkCreateRenderPass( app );
     DK_vkCreateGraphicsPipeline( app );
+    DK_vkCreateStencilResources( app );
     DK_vkCreateFramebuffers( app );
     DK_vkCreateCommandPool( app );
 
@@ -944,6 +1847,8 @@ extern "C"
     DK_vkCreateSyncObjects( app );
 
     DK_vkCreateBatchRenderer( app );
+    DK_vkCreateShapeCache( app );
+    DK_vkCreateShadowBatch( app );
 
     app->currentFrame       = 0;
     app->framebufferResized = true;
@@ -953,6 +1858,8 @@ extern "C"
 
   DK_VULKAN_FUNC void DK_vkCleanup( DK_vkApplication *app )
   {
+    DK_vkStopTextureStreaming( app );
+    DK_vkDestroyUploadContext( app );
 
     vkDeviceWaitIdle( app->device );
     DK_vkCleanupSwapChain( app );
@@ -960,13 +1867,29 @@ extern "C"
     DK_vkDestroyBatchRenderer( app );
 
     vkDestroyBuffer( app->device, app->uniformBuffer, NULL );
-    vkFreeMemory( app->device, app->uniformBufferMemory, NULL );
+    DK_vkFreeMemory( app, &app->uniformBufferMemory );
 
     vkDestroyDescriptorPool( app->device, app->descriptorPool, NULL );
     vkDestroyDescriptorSetLayout( app->device, app->descriptorSetLayout, NULL );
 
     vkDestroyBuffer( app->device, app->vertexBuffer, NULL );
-    vkFreeMemory( app->device, app->vertexBufferMemory, NULL );
+    DK_vkFreeMemory( app, &app->vertexBufferMemory );
+
+    DK_vkDestroyStagingBelt( app );
+    DK_vkDestroyTextureUpdateRing( app );
+    DK_vkReleaseRetiredTextures( app );
+    free( app->retiredTextures );
+    for ( uint32_t i = 0; i < app->textureAliasCount; i++ )
+    {
+      free( app->textureAliases[i].path );
+    }
+    free( app->textureAliases );
+    DK_vkDestroySamplerCache( app );
+    DK_vkSetTextureCacheDirectory( app, NULL );
+
+    DK_vkDestroyPolygonCache( app );
+    DK_vkDestroyShapeCache( app );
+    DK_vkDestroyShadowBatch( app );
 
     for ( int32_t i = 0; i < DK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++ )
     {
@@ -979,6 +1902,7 @@ extern "C"
     free( app->inFlightFences );
 
     vkDestroyCommandPool( app->device, app->commandPool, NULL );
+    DK_vkDestroyMemoryAllocator( app );
     vkDestroyDevice( app->device, NULL );
     if ( enableValidationLayers )
     {
@@ -990,6 +1914,10 @@ extern "C"
 
     free( vertShaderCode );
     free( fragShaderCode );
+    free( shapeVertShaderCode );
+    free( bindlessFragShaderCode );
+    free( shadowVertShaderCode );
+    free( shadowFragShaderCode );
 
     glfwDestroyWindow( app->window );
     glfwTerminate();
@@ -1223,6 +2151,31 @@ extern "C"
       fprintf( stderr, "Failed to find a suitable GPU %u\n", deviceCount );
       exit( 1 );
     }
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures( app->physicalDevice, &supportedFeatures );
+
+    app->textureCompression = 0;
+    if ( supportedFeatures.textureCompressionBC )
+    {
+      app->textureCompression |= DK_VK_TEXTURE_COMPRESSION_BC;
+    }
+    if ( supportedFeatures.textureCompressionETC2 )
+    {
+      app->textureCompression |= DK_VK_TEXTURE_COMPRESSION_ETC2;
+    }
+    if ( supportedFeatures.textureCompressionASTC_LDR )
+    {
+      app->textureCompression |= DK_VK_TEXTURE_COMPRESSION_ASTC;
+    }
+
+    app->maxSamplerAnisotropy = 1.0f;
+    if ( supportedFeatures.samplerAnisotropy )
+    {
+      VkPhysicalDeviceProperties properties;
+      vkGetPhysicalDeviceProperties( app->physicalDevice, &properties );
+      app->maxSamplerAnisotropy = properties.limits.maxSamplerAnisotropy;
+    }
   }
 
   DK_VULKAN_FUNC DK_vkQueueFamilyIndices DK_vkFindQueueFamilies( VkPhysicalDevice device,
@@ -1293,15 +2246,51 @@ extern "C"
       queueCreateInfos[i] = queueCreateInfo;
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures = { 0 };
+    uint32_t                 compression      = app->textureCompression;
+    VkPhysicalDeviceFeatures deviceFeatures   = { 0 };
+    deviceFeatures.textureCompressionBC       = ( compression & DK_VK_TEXTURE_COMPRESSION_BC ) != 0;
+    deviceFeatures.textureCompressionETC2     = ( compression & DK_VK_TEXTURE_COMPRESSION_ETC2 ) != 0;
+    deviceFeatures.textureCompressionASTC_LDR = ( compression & DK_VK_TEXTURE_COMPRESSION_ASTC ) != 0;
+    deviceFeatures.samplerAnisotropy          = app->maxSamplerAnisotropy > 1.0f;
+
+    const char *extensions[8];
+    uint32_t    extensionCount = 0;
+    for ( int32_t i = 0; i < deviceExtensionCount; i++ )
+    {
+      extensions[extensionCount++] = deviceExtensions[i];
+    }
+
+    DK_vkQueryBindlessSupport( app );
+    DK_vkQueryMipmapSupport( app );
+    DK_vkQueryMemoryBudgetSupport( app );
+
+    if ( app->residency.memoryBudget )
+    {
+      extensions[extensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = { 0 };
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    if ( app->bindlessTextures )
+    {
+      extensions[extensionCount++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+      extensions[extensionCount++] = VK_KHR_MAINTENANCE3_EXTENSION_NAME;
+
+      indexingFeatures.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+      indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+      indexingFeatures.descriptorBindingPartiallyBound              = VK_TRUE;
+      indexingFeatures.runtimeDescriptorArray                       = VK_TRUE;
+    }
 
     VkDeviceCreateInfo createInfo      = {};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext                   = app->bindlessTextures ? &indexingFeatures : NULL;
     createInfo.queueCreateInfoCount    = uniqueQueueFamilyCount;
     createInfo.pQueueCreateInfos       = queueCreateInfos;
     createInfo.pEnabledFeatures        = &deviceFeatures;
-    createInfo.enabledExtensionCount   = deviceExtensionCount;
-    createInfo.ppEnabledExtensionNames = deviceExtensions;
+    createInfo.enabledExtensionCount   = extensionCount;
+    createInfo.ppEnabledExtensionNames = extensions;
 
     if ( enableValidationLayers )
     {
@@ -1533,6 +2522,29 @@ extern "C"
     return shaderModule;
   }
 
+  DK_VULKAN_FUNC VkFormat DK_vkFindStencilFormat( DK_vkApplication *app )
+  {
+    VkFormat candidates[] = {
+        VK_FORMAT_S8_UINT,
+        VK_FORMAT_D24_UNORM_S8_UINT,
+        VK_FORMAT_D32_SFLOAT_S8_UINT,
+    };
+
+    for ( uint32_t i = 0; i < sizeof( candidates ) / sizeof( candidates[0] ); i++ )
+    {
+      VkFormatProperties properties;
+      vkGetPhysicalDeviceFormatProperties( app->physicalDevice, candidates[i], &properties );
+
+      if ( properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT )
+      {
+        return candidates[i];
+      }
+    }
+
+    fprintf( stderr, "Failed to find a supported stencil format\n" );
+    exit( 1 );
+  }
+
   DK_VULKAN_FUNC void DK_vkCreateRenderPass( DK_vkApplication *app )
   {
     VkAttachmentDescription colorAttachment = { 0 };
@@ -1562,10 +2574,40 @@ extern "C"
     dependency.dstStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     dependency.dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+    VkAttachmentDescription attachments[2] = { colorAttachment };
+    uint32_t                attachmentCount = 1;
+
+    // stencil only lives for the duration of the pass, it is cleared on load and never stored
+    VkAttachmentReference stencilAttachmentRef = { 0 };
+    if ( enableStencilAttachment )
+    {
+      app->stencilFormat = DK_vkFindStencilFormat( app );
+
+      VkAttachmentDescription stencilAttachment = { 0 };
+      stencilAttachment.format                  = app->stencilFormat;
+      stencilAttachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
+      stencilAttachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      stencilAttachment.storeOp                 = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      stencilAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_CLEAR;
+      stencilAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      stencilAttachment.initialLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+      stencilAttachment.finalLayout             = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+      attachments[attachmentCount++] = stencilAttachment;
+
+      stencilAttachmentRef.attachment = 1;
+      stencilAttachmentRef.layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+      subpass.pDepthStencilAttachment = &stencilAttachmentRef;
+
+      dependency.srcStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+      dependency.dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+      dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    }
+
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount        = 1;
-    renderPassInfo.pAttachments           = &colorAttachment;
+    renderPassInfo.attachmentCount        = attachmentCount;
+    renderPassInfo.pAttachments           = attachments;
     renderPassInfo.subpassCount           = 1;
     renderPassInfo.pSubpasses             = &subpass;
     renderPassInfo.dependencyCount        = 1;
@@ -1581,7 +2623,10 @@ extern "C"
   DK_VULKAN_FUNC void DK_vkCreateGraphicsPipeline( DK_vkApplication *app )
   {
     VkShaderModule vertShaderModule = DK_vkCreateShaderModule( app, vertShaderCode, vertShaderCodeSize );
-    VkShaderModule fragShaderModule = DK_vkCreateShaderModule( app, fragShaderCode, fragShaderCodeSize );
+    VkShaderModule fragShaderModule =
+        app->bindlessTextures
+            ? DK_vkCreateShaderModule( app, bindlessFragShaderCode, bindlessFragShaderCodeSize )
+            : DK_vkCreateShaderModule( app, fragShaderCode, fragShaderCodeSize );
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1689,6 +2734,12 @@ extern "C"
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments    = &colorBlendAttachment;
 
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType             = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable   = VK_FALSE;
+    depthStencil.depthWriteEnable  = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount             = 1;
@@ -1712,7 +2763,7 @@ extern "C"
     pipelineInfo.pViewportState               = &viewportState;
     pipelineInfo.pRasterizationState          = &rasterizer;
     pipelineInfo.pMultisampleState            = &multisampling;
-    pipelineInfo.pDepthStencilState           = NULL;
+    pipelineInfo.pDepthStencilState           = enableStencilAttachment ? &depthStencil : NULL;
     pipelineInfo.pColorBlendState             = &colorBlending;
     pipelineInfo.pDynamicState                = NULL;
     pipelineInfo.layout                       = app->pipelineLayout;
@@ -1732,6 +2783,188 @@ extern "C"
       exit( 1 );
     }
 
+    // shapes pull the unit mesh from binding 0 and offset, scale and color per instance from binding 1
+    VkShaderModule shapeVertShaderModule =
+        DK_vkCreateShaderModule( app, shapeVertShaderCode, shapeVertShaderCodeSize );
+
+    VkPipelineShaderStageCreateInfo shapeShaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    shapeShaderStages[0].module                         = shapeVertShaderModule;
+
+    VkVertexInputBindingDescription shapeBindings[2] = { 0 };
+    shapeBindings[0].binding                         = 0;
+    shapeBindings[0].stride                          = sizeof( float ) * 2;
+    shapeBindings[0].inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+    shapeBindings[1].binding                         = 1;
+    shapeBindings[1].stride                          = sizeof( DK_vkShapeInstance );
+    shapeBindings[1].inputRate                       = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputAttributeDescription shapeAttributes[4] = { 0 };
+
+    shapeAttributes[0].binding  = 0;
+    shapeAttributes[0].location = 0;
+    shapeAttributes[0].format   = VK_FORMAT_R32G32_SFLOAT;
+    shapeAttributes[0].offset   = 0;
+
+    shapeAttributes[1].binding  = 1;
+    shapeAttributes[1].location = 1;
+    shapeAttributes[1].format   = VK_FORMAT_R32G32_SFLOAT;
+    shapeAttributes[1].offset   = offsetof( DK_vkShapeInstance, offset );
+
+    shapeAttributes[2].binding  = 1;
+    shapeAttributes[2].location = 2;
+    shapeAttributes[2].format   = VK_FORMAT_R32G32_SFLOAT;
+    shapeAttributes[2].offset   = offsetof( DK_vkShapeInstance, scale );
+
+    shapeAttributes[3].binding  = 1;
+    shapeAttributes[3].location = 3;
+    shapeAttributes[3].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+    shapeAttributes[3].offset   = offsetof( DK_vkShapeInstance, color );
+
+    VkPipelineVertexInputStateCreateInfo shapeVertexInputInfo = vertexInputInfo;
+    shapeVertexInputInfo.vertexBindingDescriptionCount        = 2;
+    shapeVertexInputInfo.pVertexBindingDescriptions           = shapeBindings;
+    shapeVertexInputInfo.vertexAttributeDescriptionCount      = 4;
+    shapeVertexInputInfo.pVertexAttributeDescriptions         = shapeAttributes;
+
+    VkGraphicsPipelineCreateInfo shapePipelineInfo = pipelineInfo;
+    shapePipelineInfo.pStages                      = shapeShaderStages;
+    shapePipelineInfo.pVertexInputState            = &shapeVertexInputInfo;
+
+    if ( vkCreateGraphicsPipelines( app->device,
+                                    VK_NULL_HANDLE,
+                                    1,
+                                    &shapePipelineInfo,
+                                    NULL,
+                                    &app->shapePipeline ) != VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to create shape pipeline\n" );
+      exit( 1 );
+    }
+
+    vkDestroyShaderModule( app->device, shapeVertShaderModule, NULL );
+
+    // shadows expand a quad from gl_VertexIndex, the only input is the per instance record
+    VkShaderModule shadowVertShaderModule =
+        DK_vkCreateShaderModule( app, shadowVertShaderCode, shadowVertShaderCodeSize );
+    VkShaderModule shadowFragShaderModule =
+        DK_vkCreateShaderModule( app, shadowFragShaderCode, shadowFragShaderCodeSize );
+
+    VkPipelineShaderStageCreateInfo shadowShaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    shadowShaderStages[0].module                         = shadowVertShaderModule;
+    shadowShaderStages[1].module                         = shadowFragShaderModule;
+
+    VkVertexInputBindingDescription shadowBinding = { 0 };
+    shadowBinding.binding                         = 0;
+    shadowBinding.stride                          = sizeof( DK_vkShadowInstance );
+    shadowBinding.inputRate                       = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputAttributeDescription shadowAttributes[3] = { 0 };
+
+    shadowAttributes[0].binding  = 0;
+    shadowAttributes[0].location = 0;
+    shadowAttributes[0].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+    shadowAttributes[0].offset   = offsetof( DK_vkShadowInstance, rect );
+
+    shadowAttributes[1].binding  = 0;
+    shadowAttributes[1].location = 1;
+    shadowAttributes[1].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+    shadowAttributes[1].offset   = offsetof( DK_vkShadowInstance, color );
+
+    shadowAttributes[2].binding  = 0;
+    shadowAttributes[2].location = 2;
+    shadowAttributes[2].format   = VK_FORMAT_R32G32_SFLOAT;
+    shadowAttributes[2].offset   = offsetof( DK_vkShadowInstance, radius );
+
+    VkPipelineVertexInputStateCreateInfo shadowVertexInputInfo = vertexInputInfo;
+    shadowVertexInputInfo.vertexBindingDescriptionCount        = 1;
+    shadowVertexInputInfo.pVertexBindingDescriptions           = &shadowBinding;
+    shadowVertexInputInfo.vertexAttributeDescriptionCount      = 3;
+    shadowVertexInputInfo.pVertexAttributeDescriptions         = shadowAttributes;
+
+    VkGraphicsPipelineCreateInfo shadowPipelineInfo = pipelineInfo;
+    shadowPipelineInfo.pStages                      = shadowShaderStages;
+    shadowPipelineInfo.pVertexInputState            = &shadowVertexInputInfo;
+
+    if ( vkCreateGraphicsPipelines( app->device,
+                                    VK_NULL_HANDLE,
+                                    1,
+                                    &shadowPipelineInfo,
+                                    NULL,
+                                    &app->shadowPipeline ) != VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to create shadow pipeline\n" );
+      exit( 1 );
+    }
+
+    vkDestroyShaderModule( app->device, shadowVertShaderModule, NULL );
+    vkDestroyShaderModule( app->device, shadowFragShaderModule, NULL );
+
+    if ( enableStencilAttachment )
+    {
+      // fill pass: no color, count winding into stencil ( clockwise increments, counter-clockwise decrements )
+      VkStencilOpState windingOp = { 0 };
+      windingOp.failOp           = VK_STENCIL_OP_KEEP;
+      windingOp.depthFailOp      = VK_STENCIL_OP_KEEP;
+      windingOp.compareOp        = VK_COMPARE_OP_ALWAYS;
+      windingOp.compareMask      = 0xFF;
+      windingOp.writeMask        = 0xFF;
+      windingOp.reference        = 0;
+
+      depthStencil.stencilTestEnable = VK_TRUE;
+      depthStencil.front             = windingOp;
+      depthStencil.front.passOp      = VK_STENCIL_OP_INCREMENT_AND_WRAP;
+      depthStencil.back              = windingOp;
+      depthStencil.back.passOp       = VK_STENCIL_OP_DECREMENT_AND_WRAP;
+
+      rasterizer.cullMode                 = VK_CULL_MODE_NONE;
+      colorBlendAttachment.colorWriteMask = 0;
+
+      if ( vkCreateGraphicsPipelines( app->device,
+                                      VK_NULL_HANDLE,
+                                      1,
+                                      &pipelineInfo,
+                                      NULL,
+                                      &app->stencilFillPipeline ) != VK_SUCCESS )
+      {
+        fprintf( stderr, "Failed to create stencil fill pipeline\n" );
+        exit( 1 );
+      }
+
+      // cover pass: shade where the winding is non zero ( or odd, via the compare mask ) and reset to zero
+      VkStencilOpState coverOp = { 0 };
+      coverOp.failOp           = VK_STENCIL_OP_ZERO;
+      coverOp.passOp           = VK_STENCIL_OP_ZERO;
+      coverOp.depthFailOp      = VK_STENCIL_OP_ZERO;
+      coverOp.compareOp        = VK_COMPARE_OP_NOT_EQUAL;
+      coverOp.compareMask      = 0xFF;
+      coverOp.writeMask        = 0xFF;
+      coverOp.reference        = 0;
+
+      depthStencil.front = coverOp;
+      depthStencil.back  = coverOp;
+
+      colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+      VkDynamicState                   dynamicStates[] = { VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK };
+      VkPipelineDynamicStateCreateInfo dynamicState    = {};
+      dynamicState.sType                               = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+      dynamicState.dynamicStateCount                   = 1;
+      dynamicState.pDynamicStates                      = dynamicStates;
+      pipelineInfo.pDynamicState                       = &dynamicState;
+
+      if ( vkCreateGraphicsPipelines( app->device,
+                                      VK_NULL_HANDLE,
+                                      1,
+                                      &pipelineInfo,
+                                      NULL,
+                                      &app->stencilCoverPipeline ) != VK_SUCCESS )
+      {
+        fprintf( stderr, "Failed to create stencil cover pipeline\n" );
+        exit( 1 );
+      }
+    }
+
     vkDestroyShaderModule( app->device, fragShaderModule, NULL );
     vkDestroyShaderModule( app->device, vertShaderModule, NULL );
   }
@@ -1742,12 +2975,12 @@ extern "C"
 
     for ( uint32_t i = 0; i < app->imageCount; i++ )
     {
-      VkImageView attachments[] = { app->swapChainImageViews[i] };
+      VkImageView attachments[] = { app->swapChainImageViews[i], app->stencilImageView };
 
       VkFramebufferCreateInfo framebufferInfo = {};
       framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
       framebufferInfo.renderPass              = app->renderPass;
-      framebufferInfo.attachmentCount         = 1;
+      framebufferInfo.attachmentCount         = enableStencilAttachment ? 2 : 1;
       framebufferInfo.pAttachments            = attachments;
       framebufferInfo.width                   = app->swapChainExtent.width;
       framebufferInfo.height                  = app->swapChainExtent.height;
@@ -1815,9 +3048,11 @@ extern "C"
       renderPassInfo.renderArea.offset.y   = 0;
       renderPassInfo.renderArea.extent     = app->swapChainExtent;
 
-      VkClearValue clearColor        = { 0.0f, 0.0f, 0.0f, 1.0f };
-      renderPassInfo.clearValueCount = 1;
-      renderPassInfo.pClearValues    = &clearColor;
+      VkClearValue clearValues[2]              = { 0 };
+      clearValues[0].color                     = (VkClearColorValue){ { 0.0f, 0.0f, 0.0f, 1.0f } };
+      clearValues[1].depthStencil              = (VkClearDepthStencilValue){ 1.0f, 0 };
+      renderPassInfo.clearValueCount           = enableStencilAttachment ? 2 : 1;
+      renderPassInfo.pClearValues              = clearValues;
 
       vkCmdBeginRenderPass( app->commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
 
@@ -1832,7 +3067,7 @@ extern "C"
                                app->pipelineLayout,
                                0,
                                1,
-                               &app->descriptorSet,
+                               &app->descriptorSets[i % DK_VULKAN_MAX_FRAMES_IN_FLIGHT][0],
                                0,
                                NULL );
 
@@ -1894,6 +3129,7 @@ extern "C"
     DK_vkCreateRenderPass( app );
     DK_vkCreateDescriptorSetLayoutEx( app );
     DK_vkCreateGraphicsPipeline( app );
+    DK_vkCreateStencilResources( app );
     DK_vkCreateFramebuffers( app );
 
     vkDestroyDescriptorPool( app->device, app->descriptorPool, NULL );
@@ -1935,6 +3171,9 @@ extern "C"
 
     vkFreeCommandBuffers( app->device, app->commandPool, app->imageCount, app->commandBuffers );
     vkDestroyPipeline( app->device, app->graphicsPipeline, NULL );
+    vkDestroyPipeline( app->device, app->shapePipeline, NULL );
+    vkDestroyPipeline( app->device, app->shadowPipeline, NULL );
+    DK_vkDestroyStencilResources( app );
     vkDestroyPipelineLayout( app->device, app->pipelineLayout, NULL );
     vkDestroyRenderPass( app->device, app->renderPass, NULL );
     for ( uint32_t i = 0; i < app->imageCount; i++ )
@@ -1988,38 +3227,77 @@ extern "C"
   {
     DK_vkTexture texture = { 0 };
 
-    DK_vkCreateTextureImage( app,
-                             filename,
-                             &texture.image,
-                             &texture.memory,
-                             &texture.width,
-                             &texture.height,
-                             &texture.channels );
-    DK_vkCreateTextureImageView( app, texture.image, &texture.view );
-    DK_vkCreateTextureSampler( app, &texture.sampler );
+    DK_vkImageData image;
+    if ( !DK_vkLoadImage( app->textureCacheDirectory, filename, &image ) )
+    {
+      fprintf( stderr, "Failed to load texture image: %s\n", filename );
+      exit( 1 );
+    }
+
+    DK_vkCreateTextureFromImage( app, &image, &texture );
+    DK_vkFreeImage( &image );
 
     return texture;
   }
 
+  // keeps the sampler of a texture that is reloaded after eviction
+  DK_VULKAN_FUNC void DK_vkCreateTextureFromImage( DK_vkApplication     *app,
+                                                   const DK_vkImageData *image,
+                                                   DK_vkTexture         *texture )
+  {
+    DK_vkCreateTextureImageFromPixels(
+        app, image->pixels, image->width, image->height, &texture->image, &texture->memory );
+    DK_vkCreateTextureImageView( app, texture->image, &texture->view );
+    if ( texture->sampler == VK_NULL_HANDLE )
+    {
+      DK_vkCreateTextureSampler( app, &texture->sampler );
+    }
+
+    texture->width      = image->width;
+    texture->height     = image->height;
+    texture->channels   = image->channels;
+    texture->format     = VK_FORMAT_R8G8B8A8_SRGB;
+    texture->mipLevels  = DK_vkGetMipLevelCount( app, image->width, image->height );
+    texture->baseLevel  = 0;
+    texture->layerCount = 1;
+    texture->residency  = DK_VK_TEXTURE_RESIDENT;
+  }
+
   DK_VULKAN_FUNC void DK_vkDestroyTexture( DK_vkApplication *app, DK_vkTexture *texture )
   {
     vkDeviceWaitIdle( app->device );
 
-    vkDestroySampler( app->device, texture->sampler, NULL );
     vkDestroyImageView( app->device, texture->view, NULL );
     vkDestroyImage( app->device, texture->image, NULL );
-    vkFreeMemory( app->device, texture->memory, NULL );
+    DK_vkFreeMemory( app, &texture->memory );
   }
 
   DK_VULKAN_FUNC void DK_vkCreateImage( DK_vkApplication     *app,
                                         uint32_t              width,
                                         uint32_t              height,
+                                        uint32_t              mipLevels,
                                         VkFormat              format,
                                         VkImageTiling         tiling,
                                         VkImageUsageFlags     usage,
                                         VkMemoryPropertyFlags properties,
                                         VkImage              *image,
-                                        VkDeviceMemory       *imageMemory )
+                                        DK_vkAllocation      *imageMemory )
+  {
+    DK_vkCreateImageEx(
+        app, width, height, mipLevels, 1, format, tiling, usage, properties, image, imageMemory );
+  }
+
+  DK_VULKAN_FUNC void DK_vkCreateImageEx( DK_vkApplication     *app,
+                                          uint32_t              width,
+                                          uint32_t              height,
+                                          uint32_t              mipLevels,
+                                          uint32_t              arrayLayers,
+                                          VkFormat              format,
+                                          VkImageTiling         tiling,
+                                          VkImageUsageFlags     usage,
+                                          VkMemoryPropertyFlags properties,
+                                          VkImage              *image,
+                                          DK_vkAllocation      *imageMemory )
   {
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -2027,8 +3305,8 @@ extern "C"
     imageInfo.extent.width      = width;
     imageInfo.extent.height     = height;
     imageInfo.extent.depth      = 1;
-    imageInfo.mipLevels         = 1;
-    imageInfo.arrayLayers       = 1;
+    imageInfo.mipLevels         = mipLevels;
+    imageInfo.arrayLayers       = arrayLayers;
     imageInfo.format            = format;
     imageInfo.tiling            = tiling;
     imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -2045,65 +3323,62 @@ extern "C"
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements( app->device, *image, &memRequirements );
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize       = memRequirements.size;
-    allocInfo.memoryTypeIndex      = DK_vkFindMemoryType( app, memRequirements.memoryTypeBits, properties );
-
-    if ( vkAllocateMemory( app->device, &allocInfo, NULL, imageMemory ) != VK_SUCCESS )
+    // linear tiled images may sit next to buffers, optimal ones follow the granularity rule
+    DK_vkMemoryPoolKind pool = DK_VK_MEMORY_POOL_BUDDY;
+    if ( tiling == VK_IMAGE_TILING_OPTIMAL &&
+         app->allocator.bufferImageGranularity > DK_VK_MEMORY_MIN_ALLOCATION )
     {
-      fprintf( stderr, "Failed to allocate image memory\n" );
-      exit( 1 );
+      pool = DK_VK_MEMORY_POOL_BUDDY_OPTIMAL;
     }
 
-    vkBindImageMemory( app->device, *image, *imageMemory, 0 );
+    DK_vkAllocateMemory( app, memRequirements, properties, pool, imageMemory );
+    vkBindImageMemory( app->device, *image, imageMemory->memory, imageMemory->offset );
   }
 
   DK_VULKAN_FUNC void DK_vkCreateTextureImage( DK_vkApplication *app,
                                                const char       *filename,
                                                VkImage          *image,
-                                               VkDeviceMemory   *imageMemory,
+                                               DK_vkAllocation  *imageMemory,
                                                int32_t          *width,
                                                int32_t          *height,
                                                int32_t          *channels )
   {
-
-    int32_t      texWidth, texHeight, texChannels;
-    stbi_uc     *pixels    = stbi_load( filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha );
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-    if ( !pixels )
+    DK_vkImageData data;
+    if ( !DK_vkLoadImage( app->textureCacheDirectory, filename, &data ) )
     {
       fprintf( stderr, "Failed to load texture image: %s\n", filename );
       exit( 1 );
     }
 
-    *width    = texWidth;
-    *height   = texHeight;
-    *channels = texChannels;
+    *width    = data.width;
+    *height   = data.height;
+    *channels = data.channels;
+
+    DK_vkCreateTextureImageFromPixels( app, data.pixels, data.width, data.height, image, imageMemory );
 
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    DK_vkCreateBuffer( app,
-                       imageSize,
-                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &stagingBuffer,
-                       &stagingBufferMemory );
+    DK_vkFreeImage( &data );
+  }
 
-    void *data;
-    vkMapMemory( app->device, stagingBufferMemory, 0, imageSize, 0, &data );
-    memcpy( data, pixels, (size_t)imageSize );
-    vkUnmapMemory( app->device, stagingBufferMemory );
+  DK_VULKAN_FUNC void DK_vkCreateTextureImageFromPixels( DK_vkApplication    *app,
+                                                         const unsigned char *pixels,
+                                                         uint32_t             width,
+                                                         uint32_t             height,
+                                                         VkImage             *image,
+                                                         DK_vkAllocation     *imageMemory )
+  {
+    VkDeviceSize imageSize = (VkDeviceSize)width * height * 4;
 
-    stbi_image_free( pixels );
+    DK_vkStagingAllocation staging   = DK_vkStageData( app, pixels, imageSize );
+    uint32_t               mipLevels = DK_vkGetMipLevelCount( app, width, height );
 
     DK_vkCreateImage( app,
-                      texWidth,
-                      texHeight,
+                      width,
+                      height,
+                      mipLevels,
                       VK_FORMAT_R8G8B8A8_SRGB,
                       VK_IMAGE_TILING_OPTIMAL,
-                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                          VK_IMAGE_USAGE_SAMPLED_BIT,
                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                       image,
                       imageMemory );
@@ -2114,31 +3389,176 @@ extern "C"
                                 VK_IMAGE_LAYOUT_UNDEFINED,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
 
-    DK_vkCopyBufferToImage( app, stagingBuffer, *image, (uint32_t)texWidth, (uint32_t)texHeight );
+    DK_vkCopyBufferToImageRegion( app, staging.buffer, staging.offset, *image, 0, 0, width, height );
+
+    if ( mipLevels > 1 )
+    {
+      DK_vkGenerateMipmaps( app, *image, width, height, mipLevels, 1 );
+      return;
+    }
 
     DK_vkTransitionImageLayout( app,
                                 *image,
                                 VK_FORMAT_R8G8B8A8_SRGB,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkGetMipLevelCount( DK_vkApplication *app, uint32_t width, uint32_t height )
+  {
+    if ( !app->textureMipmaps )
+    {
+      return 1;
+    }
+
+    uint32_t levels = 1;
+    uint32_t size   = width > height ? width : height;
+    while ( size > 1 )
+    {
+      size >>= 1;
+      levels++;
+    }
+
+    return levels;
+  }
+
+  /* Note: expects every level in TRANSFER_DST_OPTIMAL with level 0 filled. Each level is blitted from the
+   * previous one, which is then moved to SHADER_READ_ONLY_OPTIMAL, the last level is moved after the loop.
+   * All layers of an array image are blitted together */
+  DK_VULKAN_FUNC void DK_vkGenerateMipmaps( DK_vkApplication *app,
+                                            VkImage           image,
+                                            uint32_t          width,
+                                            uint32_t          height,
+                                            uint32_t          mipLevels,
+                                            uint32_t          layerCount )
+  {
+    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
+
+    VkImageMemoryBarrier barrier            = {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = layerCount;
+
+    int32_t mipWidth  = (int32_t)width;
+    int32_t mipHeight = (int32_t)height;
+
+    for ( uint32_t level = 1; level < mipLevels; level++ )
+    {
+      barrier.subresourceRange.baseMipLevel = level - 1;
+      barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+      vkCmdPipelineBarrier( commandBuffer,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            0,
+                            0,
+                            NULL,
+                            0,
+                            NULL,
+                            1,
+                            &barrier );
+
+      int32_t nextWidth  = mipWidth > 1 ? mipWidth / 2 : 1;
+      int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+      VkImageBlit blit                   = { 0 };
+      blit.srcOffsets[1]                 = (VkOffset3D){ mipWidth, mipHeight, 1 };
+      blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel       = level - 1;
+      blit.srcSubresource.baseArrayLayer = 0;
+      blit.srcSubresource.layerCount     = layerCount;
+      blit.dstOffsets[1]                 = (VkOffset3D){ nextWidth, nextHeight, 1 };
+      blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.dstSubresource.mipLevel       = level;
+      blit.dstSubresource.baseArrayLayer = 0;
+      blit.dstSubresource.layerCount     = layerCount;
+      vkCmdBlitImage( commandBuffer,
+                      image,
+                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      image,
+                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                      1,
+                      &blit,
+                      VK_FILTER_LINEAR );
 
-    vkDestroyBuffer( app->device, stagingBuffer, NULL );
-    vkFreeMemory( app->device, stagingBufferMemory, NULL );
+      barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier( commandBuffer,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                            0,
+                            0,
+                            NULL,
+                            0,
+                            NULL,
+                            1,
+                            &barrier );
+
+      mipWidth  = nextWidth;
+      mipHeight = nextHeight;
+    }
+
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          0,
+                          0,
+                          NULL,
+                          0,
+                          NULL,
+                          1,
+                          &barrier );
+
+    DK_vkEndSingleTimeCommands( app, commandBuffer );
   }
 
   DK_VULKAN_FUNC void
   DK_vkCreateTextureImageView( DK_vkApplication *app, VkImage image, VkImageView *imageView )
+  {
+    DK_vkCreateTextureImageViewEx( app, image, VK_FORMAT_R8G8B8A8_SRGB, imageView );
+  }
+
+  DK_VULKAN_FUNC void DK_vkCreateTextureImageViewEx( DK_vkApplication *app,
+                                                     VkImage           image,
+                                                     VkFormat          format,
+                                                     VkImageView      *imageView )
+  {
+    DK_vkCreateTextureImageViewSwizzled( app, image, format, NULL, imageView );
+  }
+
+  /* Note: components may be NULL for the identity mapping. Every texture is viewed as a 2D array so one
+   * sampler2DArray binding serves single images ( one layer ) and DK_vkAddTextureArray textures alike */
+  DK_VULKAN_FUNC void DK_vkCreateTextureImageViewSwizzled( DK_vkApplication         *app,
+                                                           VkImage                   image,
+                                                           VkFormat                  format,
+                                                           const VkComponentMapping *components,
+                                                           VkImageView              *imageView )
   {
     VkImageViewCreateInfo viewInfo           = {};
     viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image                           = image;
-    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format                          = VK_FORMAT_R8G8B8A8_SRGB;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format                          = format;
+    viewInfo.components                      = components ? *components : (VkComponentMapping){ 0 };
     viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel   = 0;
-    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
     viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount     = 1;
+    viewInfo.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
 
     if ( vkCreateImageView( app->device, &viewInfo, NULL, imageView ) != VK_SUCCESS )
     {
@@ -2149,38 +3569,117 @@ extern "C"
 
   DK_VULKAN_FUNC void DK_vkCreateTextureSampler( DK_vkApplication *app, VkSampler *sampler )
   {
+    DK_vkSamplerState state = DK_vkGetDefaultSamplerState( app );
+    *sampler                = DK_vkGetSampler( app, &state );
+  }
+
+  /* Note: atlas pages and font atlases keep 1 texel between packed images, a linear footprint would
+   * blend in the neighbours when they are drawn scaled down, so they are always sampled nearest */
+  DK_VULKAN_FUNC void DK_vkCreatePackedTextureSampler( DK_vkApplication *app, VkSampler *sampler )
+  {
+    DK_vkSamplerState state = DK_vkGetDefaultSamplerState( app );
+    state.minFilter         = VK_FILTER_NEAREST;
+    state.mipmapMode        = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    state.addressMode       = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    *sampler                = DK_vkGetSampler( app, &state );
+  }
+
+  // magnification stays nearest, minification blends between mip levels when they are generated
+  DK_VULKAN_FUNC DK_vkSamplerState DK_vkGetDefaultSamplerState( DK_vkApplication *app )
+  {
+    DK_vkSamplerState state = { 0 };
+    state.magFilter         = VK_FILTER_NEAREST;
+    state.minFilter         = app->textureMipmaps ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    state.mipmapMode        = app->textureMipmaps ? VK_SAMPLER_MIPMAP_MODE_LINEAR
+                                                  : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    state.addressMode       = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    state.maxAnisotropy     = 1.0f;
+    return state;
+  }
+
+  DK_VULKAN_FUNC VkSampler DK_vkGetSampler( DK_vkApplication *app, const DK_vkSamplerState *state )
+  {
+    DK_vkSamplerCache *cache = &app->samplers;
+
+    float maxAnisotropy = state->maxAnisotropy < app->maxSamplerAnisotropy ? state->maxAnisotropy
+                                                                           : app->maxSamplerAnisotropy;
+    if ( maxAnisotropy < 1.0f )
+    {
+      maxAnisotropy = 1.0f;
+    }
+
+    for ( uint32_t i = 0; i < cache->count; i++ )
+    {
+      DK_vkSamplerState *cached = &cache->entries[i].state;
+      if ( cached->magFilter == state->magFilter && cached->minFilter == state->minFilter &&
+           cached->mipmapMode == state->mipmapMode && cached->addressMode == state->addressMode &&
+           cached->maxAnisotropy == maxAnisotropy )
+      {
+        return cache->entries[i].sampler;
+      }
+    }
+
+    if ( cache->count >= DK_VK_MAX_SAMPLERS )
+    {
+      fprintf( stderr, "Sampler cache full, reusing the first sampler\n" );
+      return cache->entries[0].sampler;
+    }
+
     VkSamplerCreateInfo samplerInfo = {};
     samplerInfo.sType               = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 
-    samplerInfo.magFilter = VK_FILTER_NEAREST;
-    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.magFilter = state->magFilter;
+    samplerInfo.minFilter = state->minFilter;
 
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeU = state->addressMode;
+    samplerInfo.addressModeV = state->addressMode;
+    samplerInfo.addressModeW = state->addressMode;
 
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    samplerInfo.maxAnisotropy    = 1.0f;
+    samplerInfo.anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy    = maxAnisotropy;
     samplerInfo.borderColor      = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable           = VK_FALSE;
 
+    // single level images clamp to level 0 on their own, pre-computed chains ( KTX2 ) stay usable
     samplerInfo.compareOp  = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.mipmapMode = state->mipmapMode;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod     = 0.0f;
-    samplerInfo.maxLod     = 0.0f;
+    samplerInfo.maxLod     = VK_LOD_CLAMP_NONE;
+
+    DK_vkSamplerEntry *entry   = &cache->entries[cache->count];
+    entry->state               = *state;
+    entry->state.maxAnisotropy = maxAnisotropy;
 
-    if ( vkCreateSampler( app->device, &samplerInfo, NULL, sampler ) != VK_SUCCESS )
+    if ( vkCreateSampler( app->device, &samplerInfo, NULL, &entry->sampler ) != VK_SUCCESS )
     {
       fprintf( stderr, "Failed to create texture sampler\n" );
       exit( 1 );
     }
+
+    cache->count++;
+    return entry->sampler;
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroySamplerCache( DK_vkApplication *app )
+  {
+    for ( uint32_t i = 0; i < app->samplers.count; i++ )
+    {
+      vkDestroySampler( app->device, app->samplers.entries[i].sampler, NULL );
+    }
+
+    app->samplers.count = 0;
   }
 
   DK_VULKAN_FUNC VkCommandBuffer DK_vkBeginSingleTimeCommands( DK_vkApplication *app )
   {
+    if ( app->uploads.depth > 0 )
+    {
+      return app->uploads.commandBuffer;
+    }
+
     VkCommandBufferAllocateInfo allocInfo = {};
     allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -2201,6 +3700,12 @@ extern "C"
 
   DK_VULKAN_FUNC void DK_vkEndSingleTimeCommands( DK_vkApplication *app, VkCommandBuffer commandBuffer )
   {
+    // recorded into the upload batch, submitted by DK_vkEndUploads
+    if ( app->uploads.depth > 0 && commandBuffer == app->uploads.commandBuffer )
+    {
+      return;
+    }
+
     vkEndCommandBuffer( commandBuffer );
 
     VkSubmitInfo submitInfo       = {};
@@ -2211,50 +3716,303 @@ extern "C"
     vkQueueSubmit( app->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
     vkQueueWaitIdle( app->graphicsQueue );
 
+    DK_vkRetireStaging( app, app->staging.currentSerial++ );
+
     vkFreeCommandBuffers( app->device, app->commandPool, 1, &commandBuffer );
   }
 
-  DK_VULKAN_FUNC void DK_vkTransitionImageLayout( DK_vkApplication *app,
-                                                  VkImage           image,
-                                                  VkFormat          format,
-                                                  VkImageLayout     oldLayout,
-                                                  VkImageLayout     newLayout )
+  /* Note: uploads can be nested, only the outermost DK_vkEndUploads submits. Everything recorded in
+   * between goes out in one command buffer guarded by one fence instead of a queue drain per call */
+  DK_VULKAN_FUNC void DK_vkBeginUploads( DK_vkApplication *app )
   {
-    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
-
-    VkImageMemoryBarrier barrier            = {};
-    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout                       = oldLayout;
-    barrier.newLayout                       = newLayout;
-    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image                           = image;
-    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel   = 0;
-    barrier.subresourceRange.levelCount     = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount     = 1;
+    DK_vkUploadContext *uploads = &app->uploads;
+    if ( uploads->depth > 0 )
+    {
+      uploads->depth++;
+      return;
+    }
 
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
+    DK_vkFinishUploads( app );
 
-    if ( oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL )
+    if ( uploads->fence == VK_NULL_HANDLE )
     {
-      barrier.srcAccessMask = 0;
-      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      VkFenceCreateInfo fenceInfo = {};
+      fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 
-      sourceStage      = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-      destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      if ( vkCreateFence( app->device, &fenceInfo, NULL, &uploads->fence ) != VK_SUCCESS )
+      {
+        fprintf( stderr, "Failed to create upload fence\n" );
+        exit( 1 );
+      }
     }
-    else if ( oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-              newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL )
+
+    uploads->commandBuffer = DK_vkBeginSingleTimeCommands( app );
+    uploads->depth         = 1;
+  }
+
+  DK_VULKAN_FUNC void DK_vkEndUploads( DK_vkApplication *app, bool wait )
+  {
+    DK_vkUploadContext *uploads = &app->uploads;
+    if ( uploads->depth == 0 )
     {
-      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      fprintf( stderr, "No upload batch in progress\n" );
+      return;
+    }
 
-      sourceStage      = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    if ( --uploads->depth > 0 )
+    {
+      return;
+    }
+
+    // make the copies visible to every later submission that reads the uploaded buffers and images
+    VkMemoryBarrier barrier = {};
+    barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask   =
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier( uploads->commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          0,
+                          1,
+                          &barrier,
+                          0,
+                          NULL,
+                          0,
+                          NULL );
+
+    vkEndCommandBuffer( uploads->commandBuffer );
+
+    VkSubmitInfo submitInfo       = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &uploads->commandBuffer;
+
+    vkResetFences( app->device, 1, &uploads->fence );
+    if ( vkQueueSubmit( app->graphicsQueue, 1, &submitInfo, uploads->fence ) != VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to submit upload batch\n" );
+      exit( 1 );
+    }
+
+    uploads->stagingSerial = app->staging.currentSerial++;
+    uploads->pending       = true;
+
+    if ( wait )
+    {
+      DK_vkFinishUploads( app );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkReleaseUploads( DK_vkApplication *app )
+  {
+    DK_vkUploadContext *uploads = &app->uploads;
+
+    DK_vkRetireStaging( app, uploads->stagingSerial );
+
+    vkFreeCommandBuffers( app->device, app->commandPool, 1, &uploads->commandBuffer );
+    uploads->commandBuffer = VK_NULL_HANDLE;
+    uploads->pending       = false;
+  }
+
+  DK_VULKAN_FUNC void DK_vkFinishUploads( DK_vkApplication *app )
+  {
+    if ( !app->uploads.pending )
+    {
+      return;
+    }
+
+    vkWaitForFences( app->device, 1, &app->uploads.fence, VK_TRUE, UINT64_MAX );
+    DK_vkReleaseUploads( app );
+  }
+
+  // non blocking, hands the staging memory of a finished upload batch back to the belt
+  DK_VULKAN_FUNC void DK_vkPollUploads( DK_vkApplication *app )
+  {
+    if ( app->uploads.pending && vkGetFenceStatus( app->device, app->uploads.fence ) == VK_SUCCESS )
+    {
+      DK_vkReleaseUploads( app );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyUploadContext( DK_vkApplication *app )
+  {
+    DK_vkFinishUploads( app );
+
+    if ( app->uploads.fence != VK_NULL_HANDLE )
+    {
+      vkDestroyFence( app->device, app->uploads.fence, NULL );
+      app->uploads.fence = VK_NULL_HANDLE;
+    }
+  }
+
+  DK_VULKAN_FUNC DK_vkStagingChunk *DK_vkAddStagingChunk( DK_vkApplication *app, VkDeviceSize size )
+  {
+    DK_vkStagingBelt  *belt   = &app->staging;
+    DK_vkStagingChunk *chunks =
+        (DK_vkStagingChunk *)realloc( belt->chunks, ( belt->chunkCount + 1 ) * sizeof( DK_vkStagingChunk ) );
+    if ( chunks == NULL )
+    {
+      fprintf( stderr, "Failed to grow the staging belt\n" );
+      exit( 1 );
+    }
+    belt->chunks = chunks;
+
+    // only the first chunk is kept for good, burst chunks are freed on retire and have to give the space back
+    bool               permanent = belt->chunkCount == 0 && size <= DK_VK_STAGING_CHUNK_SIZE;
+    DK_vkStagingChunk *chunk     = &belt->chunks[belt->chunkCount++];
+    memset( chunk, 0, sizeof( DK_vkStagingChunk ) );
+    chunk->size = size;
+
+    DK_vkCreateBufferEx( app,
+                         size,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         permanent ? DK_VK_MEMORY_POOL_LINEAR : DK_VK_MEMORY_POOL_BUDDY,
+                         &chunk->buffer,
+                         &chunk->memory );
+    chunk->mapped = (unsigned char *)chunk->memory.mapped;
+
+    return chunk;
+  }
+
+  /* Note: the returned range stays valid until the copy reading it has been submitted, the space is
+   * handed out again once that submission is retired. Chunks are only added when every existing one
+   * is still in flight or too small, so steady state loading does not allocate device memory */
+  DK_VULKAN_FUNC DK_vkStagingAllocation DK_vkAllocateStaging( DK_vkApplication *app, VkDeviceSize size )
+  {
+    DK_vkStagingBelt *belt = &app->staging;
+    size = ( size + DK_VK_STAGING_ALIGNMENT - 1 ) & ~(VkDeviceSize)( DK_VK_STAGING_ALIGNMENT - 1 );
+
+    DK_vkStagingChunk *chunk = NULL;
+    for ( uint32_t i = 0; i < belt->chunkCount && chunk == NULL; i++ )
+    {
+      DK_vkStagingChunk *candidate = &belt->chunks[i];
+      if ( candidate->serial < belt->completedSerial )
+      {
+        candidate->used = 0;
+      }
+
+      if ( candidate->size - candidate->used >= size )
+      {
+        chunk = candidate;
+      }
+    }
+
+    if ( chunk == NULL )
+    {
+      chunk = DK_vkAddStagingChunk( app, size > DK_VK_STAGING_CHUNK_SIZE ? size : DK_VK_STAGING_CHUNK_SIZE );
+    }
+
+    DK_vkStagingAllocation allocation = { 0 };
+    allocation.buffer                 = chunk->buffer;
+    allocation.offset                 = chunk->used;
+    allocation.data                   = chunk->mapped + chunk->used;
+
+    chunk->used  += size;
+    chunk->serial = belt->currentSerial;
+
+    return allocation;
+  }
+
+  DK_VULKAN_FUNC DK_vkStagingAllocation
+  DK_vkStageData( DK_vkApplication *app, const void *data, VkDeviceSize size )
+  {
+    DK_vkStagingAllocation allocation = DK_vkAllocateStaging( app, size );
+    memcpy( allocation.data, data, (size_t)size );
+    return allocation;
+  }
+
+  /* Note: every allocation tagged with serial or an older one may be reused. The belt shrinks back to its
+   * first chunk, chunks added for a burst and dedicated chunks larger than DK_VK_STAGING_CHUNK_SIZE are
+   * freed as soon as nothing in flight reads them */
+  DK_VULKAN_FUNC void DK_vkRetireStaging( DK_vkApplication *app, uint64_t serial )
+  {
+    DK_vkStagingBelt *belt = &app->staging;
+    if ( serial + 1 > belt->completedSerial )
+    {
+      belt->completedSerial = serial + 1;
+    }
+
+    for ( uint32_t i = belt->chunkCount; i-- > 0; )
+    {
+      DK_vkStagingChunk *chunk = &belt->chunks[i];
+      if ( ( i == 0 && chunk->size <= DK_VK_STAGING_CHUNK_SIZE ) || chunk->serial >= belt->completedSerial )
+      {
+        continue;
+      }
+
+      vkDestroyBuffer( app->device, chunk->buffer, NULL );
+      DK_vkFreeMemory( app, &chunk->memory );
+
+      belt->chunks[i] = belt->chunks[--belt->chunkCount];
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyStagingBelt( DK_vkApplication *app )
+  {
+    DK_vkStagingBelt *belt = &app->staging;
+    for ( uint32_t i = 0; i < belt->chunkCount; i++ )
+    {
+      vkDestroyBuffer( app->device, belt->chunks[i].buffer, NULL );
+      DK_vkFreeMemory( app, &belt->chunks[i].memory );
+    }
+
+    free( belt->chunks );
+    belt->chunks     = NULL;
+    belt->chunkCount = 0;
+  }
+
+  DK_VULKAN_FUNC void DK_vkTransitionImageLayout( DK_vkApplication *app,
+                                                  VkImage           image,
+                                                  VkFormat          format,
+                                                  VkImageLayout     oldLayout,
+                                                  VkImageLayout     newLayout )
+  {
+    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
+
+    VkImageMemoryBarrier barrier            = {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout                       = oldLayout;
+    barrier.newLayout                       = newLayout;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
+
+    VkPipelineStageFlags sourceStage;
+    VkPipelineStageFlags destinationStage;
+
+    if ( oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL )
+    {
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+      sourceStage      = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+      destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    else if ( oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+              newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL )
+    {
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+      sourceStage      = VK_PIPELINE_STAGE_TRANSFER_BIT;
       destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
+    else if ( oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
+              newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL )
+    {
+      barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+      sourceStage      = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
     else
     {
       fprintf( stderr, "Unsupported layout transition\n" );
@@ -2266,23 +4024,26 @@ extern "C"
     DK_vkEndSingleTimeCommands( app, commandBuffer );
   }
 
-  DK_VULKAN_FUNC void DK_vkCopyBufferToImage( DK_vkApplication *app,
-                                              VkBuffer          buffer,
-                                              VkImage           image,
-                                              uint32_t          width,
-                                              uint32_t          height )
+  DK_VULKAN_FUNC void DK_vkCopyBufferToImageRegion( DK_vkApplication *app,
+                                                    VkBuffer          buffer,
+                                                    VkDeviceSize      bufferOffset,
+                                                    VkImage           image,
+                                                    int32_t           x,
+                                                    int32_t           y,
+                                                    uint32_t          width,
+                                                    uint32_t          height )
   {
     VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
 
     VkBufferImageCopy region               = { 0 };
-    region.bufferOffset                    = 0;
+    region.bufferOffset                    = bufferOffset;
     region.bufferRowLength                 = 0;
     region.bufferImageHeight               = 0;
     region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
     region.imageSubresource.mipLevel       = 0;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount     = 1;
-    region.imageOffset                     = (VkOffset3D){ 0, 0, 0 };
+    region.imageOffset                     = (VkOffset3D){ x, y, 0 };
     region.imageExtent                     = (VkExtent3D){ width, height, 1 };
 
     vkCmdCopyBufferToImage( commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
@@ -2290,1116 +4051,5605 @@ extern "C"
     DK_vkEndSingleTimeCommands( app, commandBuffer );
   }
 
-  // ========================================================================================
-  // BATCH RENDERING IMPLEMENTATION
-  // ========================================================================================
-
-  DK_VULKAN_FUNC void DK_vkCreateBatchRenderer( DK_vkApplication *app )
+  DK_VULKAN_FUNC void DK_vkCopyBufferToImage( DK_vkApplication *app,
+                                              VkBuffer          buffer,
+                                              VkImage           image,
+                                              uint32_t          width,
+                                              uint32_t          height )
   {
-    DK_vkRenderer *renderer = &app->batchRenderer;
-
-    renderer->vertexCount        = 0;
-    renderer->indexCount         = 0;
-    renderer->hasBegun           = false;
-    renderer->vertexBuffer       = VK_NULL_HANDLE;
-    renderer->vertexBufferMemory = VK_NULL_HANDLE;
-    renderer->indexBuffer        = VK_NULL_HANDLE;
-    renderer->indexBufferMemory  = VK_NULL_HANDLE;
-    renderer->commandBuffer      = VK_NULL_HANDLE;
-    renderer->vertexBufferMapped = NULL;
-    renderer->indexBufferMapped  = NULL;
-    renderer->currentTexture     = NULL;
+    DK_vkCopyBufferToImageRegion( app, buffer, 0, image, 0, 0, width, height );
+  }
 
-    VkDeviceSize vertexBufferSize = sizeof( DK_Vertex ) * MAX_BATCH_VERTICES;
+  DK_VULKAN_FUNC void DK_vkCopyBufferToImageLayer( DK_vkApplication *app,
+                                                   VkBuffer          buffer,
+                                                   VkDeviceSize      bufferOffset,
+                                                   VkImage           image,
+                                                   uint32_t          layer,
+                                                   uint32_t          width,
+                                                   uint32_t          height )
+  {
+    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
 
-    DK_vkCreateBuffer( app,
-                       vertexBufferSize,
-                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &renderer->vertexBuffer,
-                       &renderer->vertexBufferMemory );
+    VkBufferImageCopy region               = { 0 };
+    region.bufferOffset                    = bufferOffset;
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = layer;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent                     = (VkExtent3D){ width, height, 1 };
 
-    vkMapMemory( app->device,
-                 renderer->vertexBufferMemory,
-                 0,
-                 vertexBufferSize,
-                 0,
-                 (void **)&renderer->vertexBufferMapped );
+    vkCmdCopyBufferToImage( commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
 
-    VkDeviceSize indexBufferSize = sizeof( uint32_t ) * MAX_BATCH_INDICES;
+    DK_vkEndSingleTimeCommands( app, commandBuffer );
+  }
 
-    DK_vkCreateBuffer( app,
-                       indexBufferSize,
-                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &renderer->indexBuffer,
-                       &renderer->indexBufferMemory );
+  // ========================================================================================
+  // MEMORY ALLOCATOR IMPLEMENTATION
+  // ========================================================================================
 
-    vkMapMemory( app->device,
-                 renderer->indexBufferMemory,
-                 0,
-                 indexBufferSize,
-                 0,
-                 (void **)&renderer->indexBufferMapped );
+  DK_VULKAN_FUNC void DK_vkInitMemoryAllocator( DK_vkApplication *app )
+  {
+    DK_vkMemoryAllocator *allocator = &app->allocator;
+    memset( allocator, 0, sizeof( DK_vkMemoryAllocator ) );
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool                 = app->commandPool;
-    allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount          = 1;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( app->physicalDevice, &properties );
+    vkGetPhysicalDeviceMemoryProperties( app->physicalDevice, &allocator->memoryProperties );
 
-    vkAllocateCommandBuffers( app->device, &allocInfo, &renderer->commandBuffer );
+    allocator->bufferImageGranularity = properties.limits.bufferImageGranularity;
+    allocator->maxAllocationCount     = properties.limits.maxMemoryAllocationCount;
 
-    // NOTE (David) Batch renderer shares the existing pipeline for now, we need to create a specific pipeline for the batch renderer
-    renderer->pipeline       = app->graphicsPipeline;
-    renderer->pipelineLayout = app->pipelineLayout;
+    for ( uint32_t kind = 0; kind < DK_VK_MEMORY_POOL_COUNT; kind++ )
+    {
+      for ( uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++ )
+      {
+        allocator->pools[kind][type].kind       = (DK_vkMemoryPoolKind)kind;
+        allocator->pools[kind][type].memoryType = type;
+      }
+    }
   }
 
-  DK_VULKAN_FUNC void DK_vkDestroyBatchRenderer( DK_vkApplication *app )
+  DK_VULKAN_FUNC void DK_vkDestroyMemoryAllocator( DK_vkApplication *app )
   {
-    DK_vkRenderer *renderer = &app->batchRenderer;
+    DK_vkMemoryAllocator *allocator = &app->allocator;
 
-    if ( renderer->vertexBufferMapped != NULL )
+    for ( uint32_t kind = 0; kind < DK_VK_MEMORY_POOL_COUNT; kind++ )
     {
-      vkUnmapMemory( app->device, renderer->vertexBufferMemory );
-      renderer->vertexBufferMapped = NULL;
+      for ( uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++ )
+      {
+        DK_vkMemoryPool *pool = &allocator->pools[kind][type];
+        for ( uint32_t i = 0; i < pool->blockCount; i++ )
+        {
+          DK_vkReleaseMemoryBlock( app, &pool->blocks[i] );
+        }
+
+        free( pool->blocks );
+        pool->blocks     = NULL;
+        pool->blockCount = 0;
+      }
     }
+  }
 
-    if ( renderer->indexBufferMapped != NULL )
+  DK_VULKAN_FUNC void DK_vkAllocateDeviceMemory(
+      DK_vkApplication *app, uint32_t memoryType, VkDeviceSize size, VkDeviceMemory *memory, void **mapped )
+  {
+    DK_vkMemoryAllocator *allocator = &app->allocator;
+    if ( allocator->deviceAllocationCount >= allocator->maxAllocationCount )
     {
-      vkUnmapMemory( app->device, renderer->indexBufferMemory );
-      renderer->indexBufferMapped = NULL;
+      fprintf( stderr, "Device memory allocation limit of %u reached\n", allocator->maxAllocationCount );
+      exit( 1 );
     }
 
-    if ( renderer->vertexBuffer != VK_NULL_HANDLE )
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = size;
+    allocInfo.memoryTypeIndex      = memoryType;
+
+    if ( vkAllocateMemory( app->device, &allocInfo, NULL, memory ) != VK_SUCCESS )
     {
-      vkDestroyBuffer( app->device, renderer->vertexBuffer, NULL );
-      renderer->vertexBuffer = VK_NULL_HANDLE;
+      fprintf( stderr, "Failed to allocate device memory\n" );
+      exit( 1 );
     }
+    allocator->deviceAllocationCount++;
+
+    VkMemoryPropertyFlags flags = allocator->memoryProperties.memoryTypes[memoryType].propertyFlags;
 
-    if ( renderer->vertexBufferMemory != VK_NULL_HANDLE )
+    *mapped = NULL;
+    if ( flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
     {
-      vkFreeMemory( app->device, renderer->vertexBufferMemory, NULL );
-      renderer->vertexBufferMemory = VK_NULL_HANDLE;
+      if ( vkMapMemory( app->device, *memory, 0, VK_WHOLE_SIZE, 0, mapped ) != VK_SUCCESS )
+      {
+        fprintf( stderr, "Failed to map device memory\n" );
+        exit( 1 );
+      }
     }
+  }
 
-    if ( renderer->indexBuffer != VK_NULL_HANDLE )
+  DK_VULKAN_FUNC uint32_t DK_vkAddMemoryBlock( DK_vkApplication *app, DK_vkMemoryPool *pool )
+  {
+    uint32_t index = pool->blockCount;
+    for ( uint32_t i = 0; i < pool->blockCount; i++ )
     {
-      vkDestroyBuffer( app->device, renderer->indexBuffer, NULL );
-      renderer->indexBuffer = VK_NULL_HANDLE;
+      if ( pool->blocks[i].memory == VK_NULL_HANDLE )
+      {
+        index = i;
+        break;
+      }
     }
 
-    if ( renderer->indexBufferMemory != VK_NULL_HANDLE )
+    if ( index == pool->blockCount )
     {
-      vkFreeMemory( app->device, renderer->indexBufferMemory, NULL );
-      renderer->indexBufferMemory = VK_NULL_HANDLE;
+      DK_vkMemoryBlock *blocks =
+          (DK_vkMemoryBlock *)realloc( pool->blocks, ( pool->blockCount + 1 ) * sizeof( DK_vkMemoryBlock ) );
+      if ( blocks == NULL )
+      {
+        fprintf( stderr, "Failed to grow memory pool\n" );
+        exit( 1 );
+      }
+      pool->blocks = blocks;
+      pool->blockCount++;
     }
 
-    if ( renderer->commandBuffer != VK_NULL_HANDLE )
+    DK_vkMemoryBlock *block = &pool->blocks[index];
+    memset( block, 0, sizeof( DK_vkMemoryBlock ) );
+
+    void *mapped = NULL;
+    DK_vkAllocateDeviceMemory( app, pool->memoryType, DK_VK_MEMORY_BLOCK_SIZE, &block->memory, &mapped );
+    block->mapped = (unsigned char *)mapped;
+
+    if ( pool->kind != DK_VK_MEMORY_POOL_LINEAR )
     {
-      vkFreeCommandBuffers( app->device, app->commandPool, 1, &renderer->commandBuffer );
-      renderer->commandBuffer = VK_NULL_HANDLE;
+      DK_vkPushFreeRange( block, DK_VK_BUDDY_ORDER_COUNT - 1, 0 );
     }
 
-    renderer->vertexCount    = 0;
-    renderer->indexCount     = 0;
-    renderer->hasBegun       = false;
-    renderer->currentTexture = NULL;
+    return index;
   }
 
-  DK_VULKAN_FUNC void DK_vkBeginBatch( DK_vkApplication *app )
+  DK_VULKAN_FUNC void DK_vkReleaseMemoryBlock( DK_vkApplication *app, DK_vkMemoryBlock *block )
   {
-    DK_vkRenderer *renderer = &app->batchRenderer;
-
-    if ( renderer->hasBegun )
+    if ( block->memory == VK_NULL_HANDLE )
     {
-      fprintf( stderr, "Batch already in progress\n" );
       return;
     }
 
-    vkQueueWaitIdle( app->graphicsQueue );
-    vkResetCommandBuffer( renderer->commandBuffer, 0 );
-
-    renderer->vertexCount = 0;
-    renderer->indexCount  = 0;
-    renderer->hasBegun    = true;
-
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if ( block->mapped != NULL )
+    {
+      vkUnmapMemory( app->device, block->memory );
+    }
+    vkFreeMemory( app->device, block->memory, NULL );
+    app->allocator.deviceAllocationCount--;
 
-    if ( vkBeginCommandBuffer( renderer->commandBuffer, &beginInfo ) != VK_SUCCESS )
+    for ( uint32_t order = 0; order < DK_VK_BUDDY_ORDER_COUNT; order++ )
     {
-      fprintf( stderr, "Failed to begin command buffer for batch\n" );
-      exit( 1 );
+      free( block->freeRanges[order] );
     }
+    memset( block, 0, sizeof( DK_vkMemoryBlock ) );
   }
 
-  DK_VULKAN_FUNC void DK_vkEndBatch( DK_vkApplication *app )
+  DK_VULKAN_FUNC uint32_t DK_vkGetBuddyOrder( VkDeviceSize size )
   {
-    DK_vkRenderer *renderer = &app->batchRenderer;
-    if ( !renderer->hasBegun )
+    uint32_t order = 0;
+    while ( ( (VkDeviceSize)DK_VK_MEMORY_MIN_ALLOCATION << order ) < size )
     {
-      fprintf( stderr, "No batch in progress\n" );
-      return;
+      order++;
     }
+    return order;
+  }
 
-    if ( renderer->vertexCount > 0 )
-    {
-      DK_vkFlushBatch( app );
-    }
-    else
+  DK_VULKAN_FUNC void DK_vkPushFreeRange( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize offset )
+  {
+    if ( block->freeCounts[order] == block->freeCapacities[order] )
     {
-      if ( renderer->hasBegun )
+      uint32_t      capacity = block->freeCapacities[order] ? block->freeCapacities[order] * 2 : 8;
+      VkDeviceSize *ranges =
+          (VkDeviceSize *)realloc( block->freeRanges[order], capacity * sizeof( VkDeviceSize ) );
+      if ( ranges == NULL )
       {
-        vkEndCommandBuffer( renderer->commandBuffer );
+        fprintf( stderr, "Failed to grow buddy free list\n" );
+        exit( 1 );
       }
+      block->freeRanges[order]     = ranges;
+      block->freeCapacities[order] = capacity;
     }
 
-    renderer->hasBegun = false;
+    block->freeRanges[order][block->freeCounts[order]++] = offset;
   }
 
-  DK_VULKAN_FUNC void DK_vkSafeUnmapMemory( DK_vkApplication *app, VkDeviceMemory *memory, void **mappedData )
+  DK_VULKAN_FUNC bool DK_vkTakeFreeRange( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize offset )
   {
-    if ( app && app->device != VK_NULL_HANDLE && *memory != VK_NULL_HANDLE && *mappedData != NULL )
+    for ( uint32_t i = 0; i < block->freeCounts[order]; i++ )
     {
-      vkUnmapMemory( app->device, *memory );
-      *mappedData = NULL;
+      if ( block->freeRanges[order][i] == offset )
+      {
+        block->freeRanges[order][i] = block->freeRanges[order][--block->freeCounts[order]];
+        return true;
+      }
     }
+    return false;
   }
 
-  DK_VULKAN_FUNC uint32_t DK_vkAddVertex( DK_vkRenderer *renderer,
-                                          float          x,
-                                          float          y,
-                                          float          r,
-                                          float          g,
-                                          float          b,
-                                          float          a,
-                                          float          u,
-                                          float          v,
-                                          int32_t        samplerId )
+  DK_VULKAN_FUNC bool DK_vkBuddyAllocate( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize *offset )
   {
-    DK_Vertex *vertex = &renderer->vertexBufferMapped[renderer->vertexCount];
-
-    vertex->pos[0]      = x;
-    vertex->pos[1]      = y;
-    vertex->color[0]    = r;
-    vertex->color[1]    = g;
-    vertex->color[2]    = b;
-    vertex->color[3]    = a;
-    vertex->texCoord[0] = u;
-    vertex->texCoord[1] = v;
-    vertex->samplerId   = samplerId;
+    uint32_t current = order;
+    while ( current < DK_VK_BUDDY_ORDER_COUNT && block->freeCounts[current] == 0 )
+    {
+      current++;
+    }
 
-    return renderer->vertexCount++;
-  }
+    if ( current == DK_VK_BUDDY_ORDER_COUNT )
+    {
+      return false;
+    }
 
-  DK_VULKAN_FUNC void DK_vkAddIndex( DK_vkRenderer *renderer, uint32_t index )
-  {
-    renderer->indexBufferMapped[renderer->indexCount++] = index;
-  }
+    VkDeviceSize range = block->freeRanges[current][--block->freeCounts[current]];
 
-  DK_VULKAN_FUNC void
-  DK_vkOrtho( float left, float right, float bottom, float top, float near, float far, DK_vkMat4 matrix )
-  {
-    memset( matrix, 0, sizeof( float ) * 16 );
-    matrix[0][0] = 2.0f / ( right - left );
-    matrix[1][1] = 2.0f / ( bottom - top );
-    matrix[2][2] = -2.0f / ( far - near );
-    matrix[3][0] = -( right + left ) / ( right - left );
-    matrix[3][1] = -( bottom + top ) / ( bottom - top );
-    matrix[3][2] = -( far + near ) / ( far - near );
-    matrix[3][3] = 1.0f;
-  }
+    // split down to the requested order, the upper halves go back on the free lists
+    while ( current > order )
+    {
+      current--;
+      DK_vkPushFreeRange( block, current, range + ( (VkDeviceSize)DK_VK_MEMORY_MIN_ALLOCATION << current ) );
+    }
 
-  DK_VULKAN_FUNC void DK_vkIdentityMatrix( DK_vkMat4 matrix )
-  {
-    memset( matrix, 0, sizeof( float ) * 16 );
-    matrix[0][0] = 1.0f;
-    matrix[1][1] = 1.0f;
-    matrix[2][2] = 1.0f;
-    matrix[3][3] = 1.0f;
+    *offset = range;
+    return true;
   }
 
-  DK_VULKAN_FUNC void DK_vkOrthoCameraInit( DK_vkApplication *app, float width, float height )
+  DK_VULKAN_FUNC void DK_vkBuddyFree( DK_vkMemoryBlock *block, uint32_t order, VkDeviceSize offset )
   {
-    float aspectRatio = width / height;
-    float orthoWidth  = width;
-    float orthoHeight = orthoWidth / aspectRatio;
+    while ( order < DK_VK_BUDDY_ORDER_COUNT - 1 )
+    {
+      VkDeviceSize size = (VkDeviceSize)DK_VK_MEMORY_MIN_ALLOCATION << order;
+      if ( !DK_vkTakeFreeRange( block, order, offset ^ size ) )
+      {
+        break;
+      }
 
-    app->camera.zoom = 1.0f;
-    app->camera.near = -1.0f;
-    app->camera.far  = 1.0f;
+      offset &= ~size;
+      order++;
+    }
 
-    app->camera.left   = 0;
-    app->camera.right  = orthoWidth;
-    app->camera.top    = 0;
-    app->camera.bottom = orthoHeight;
+    DK_vkPushFreeRange( block, order, offset );
   }
 
-  DK_VULKAN_FUNC void DK_vkOrthoCameraUpdate( DK_vkApplication *app, float width, float height )
+  /* Note: buddy ranges are aligned to their own size, so rounding the request up to the alignment is enough
+   * to satisfy it. Requests larger than half a block get their own VkDeviceMemory, they would leave too
+   * much of a block unusable otherwise */
+  DK_VULKAN_FUNC void DK_vkAllocateMemory( DK_vkApplication     *app,
+                                           VkMemoryRequirements  requirements,
+                                           VkMemoryPropertyFlags properties,
+                                           DK_vkMemoryPoolKind   pool,
+                                           DK_vkAllocation      *allocation )
   {
-    float aspectRatio = width / height;
-    float orthoWidth  = width;
-    float orthoHeight = orthoWidth / aspectRatio;
+    DK_vkMemoryAllocator *allocator = &app->allocator;
 
-    app->camera.left   = 0;
-    app->camera.right  = orthoWidth;
-    app->camera.top    = 0;
-    app->camera.bottom = orthoHeight;
-  }
+    memset( allocation, 0, sizeof( DK_vkAllocation ) );
+    allocation->memoryType = DK_vkFindMemoryType( app, requirements.memoryTypeBits, properties );
 
-  DK_VULKAN_FUNC void DK_vkZoomCamera( DK_vkApplication *app, float factor )
-  {
-    app->camera.zoom *= factor;
-    if ( app->camera.zoom < 0.1f )
-    {
-      app->camera.zoom = 0.1f;
-    }
-    if ( app->camera.zoom > 10.0f )
+    if ( pool == DK_VK_MEMORY_POOL_DEDICATED || requirements.size > DK_VK_MEMORY_BLOCK_SIZE / 2 )
     {
-      app->camera.zoom = 10.0f;
-    }
-
-    int32_t width, height;
-    glfwGetFramebufferSize( app->window, &width, &height );
-    DK_vkOrthoCameraUpdate( app, (float)width, (float)height );
-  }
+      DK_vkAllocateDeviceMemory(
+          app, allocation->memoryType, requirements.size, &allocation->memory, &allocation->mapped );
+      allocation->size = requirements.size;
+      allocation->pool = DK_VK_MEMORY_POOL_DEDICATED;
 
-  DK_VULKAN_FUNC void DK_vkCreateDummyTexture( DK_vkApplication *app )
-  {
-    if ( app->textureCount > 0 )
-    {
+      allocator->dedicatedCount++;
+      allocator->dedicatedBytes += requirements.size;
       return;
     }
 
-    if ( app->textures == NULL )
+    DK_vkMemoryPool *memoryPool = &allocator->pools[pool][allocation->memoryType];
+    VkDeviceSize     alignment  = requirements.alignment ? requirements.alignment : 1;
+    VkDeviceSize     offset     = 0;
+    uint32_t         index      = UINT32_MAX;
+
+    if ( pool == DK_VK_MEMORY_POOL_LINEAR )
     {
-      app->maxTextures  = DK_VK_MAX_TEXTURES;
-      app->textureCount = 0;
-      app->textures     = (DK_vkTexture *)malloc( sizeof( DK_vkTexture ) * app->maxTextures );
-      if ( app->textures == NULL )
+      allocation->size = requirements.size;
+      for ( uint32_t i = 0; i < memoryPool->blockCount && index == UINT32_MAX; i++ )
       {
-        fprintf( stderr, "Failed to allocate memory for textures array\n" );
-        exit( 1 );
+        DK_vkMemoryBlock *block = &memoryPool->blocks[i];
+        offset                  = ( block->head + alignment - 1 ) & ~( alignment - 1 );
+        if ( block->memory != VK_NULL_HANDLE && offset + requirements.size <= DK_VK_MEMORY_BLOCK_SIZE )
+        {
+          index = i;
+        }
       }
-    }
-
-    uint8_t      whitePixel[4] = { 255, 255, 255, 255 };
-    VkDeviceSize imageSize     = 4; // 1x1 RGBA
-
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    DK_vkCreateBuffer( app,
-                       imageSize,
-                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &stagingBuffer,
-                       &stagingBufferMemory );
-
-    void *data;
-    vkMapMemory( app->device, stagingBufferMemory, 0, imageSize, 0, &data );
-    memcpy( data, whitePixel, imageSize );
-    vkUnmapMemory( app->device, stagingBufferMemory );
-
-    DK_vkTexture dummyTexture = { 0 };
-    dummyTexture.width        = 1;
-    dummyTexture.height       = 1;
-    dummyTexture.channels     = 4;
 
-    DK_vkCreateImage( app,
-                      1,
-                      1,
-                      VK_FORMAT_R8G8B8A8_SRGB,
-                      VK_IMAGE_TILING_OPTIMAL,
-                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                      &dummyTexture.image,
-                      &dummyTexture.memory );
+      if ( index == UINT32_MAX )
+      {
+        index  = DK_vkAddMemoryBlock( app, memoryPool );
+        offset = 0;
+      }
+      memoryPool->blocks[index].head = offset + requirements.size;
+    }
+    else
+    {
+      uint32_t order   = DK_vkGetBuddyOrder( requirements.size > alignment ? requirements.size : alignment );
+      allocation->size = (VkDeviceSize)DK_VK_MEMORY_MIN_ALLOCATION << order;
 
-    DK_vkTransitionImageLayout( app,
-                                dummyTexture.image,
-                                VK_FORMAT_R8G8B8A8_SRGB,
-                                VK_IMAGE_LAYOUT_UNDEFINED,
-                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+      for ( uint32_t i = 0; i < memoryPool->blockCount && index == UINT32_MAX; i++ )
+      {
+        if ( memoryPool->blocks[i].memory != VK_NULL_HANDLE &&
+             DK_vkBuddyAllocate( &memoryPool->blocks[i], order, &offset ) )
+        {
+          index = i;
+        }
+      }
 
-    DK_vkCopyBufferToImage( app, stagingBuffer, dummyTexture.image, 1, 1 );
+      if ( index == UINT32_MAX )
+      {
+        index = DK_vkAddMemoryBlock( app, memoryPool );
+        DK_vkBuddyAllocate( &memoryPool->blocks[index], order, &offset );
+      }
+    }
 
-    DK_vkTransitionImageLayout( app,
-                                dummyTexture.image,
-                                VK_FORMAT_R8G8B8A8_SRGB,
-                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+    DK_vkMemoryBlock *block = &memoryPool->blocks[index];
+    block->used += allocation->size;
+    block->allocationCount++;
 
-    DK_vkCreateTextureImageView( app, dummyTexture.image, &dummyTexture.view );
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->mapped = block->mapped ? block->mapped + offset : NULL;
+    allocation->pool   = pool;
+    allocation->block  = index;
+  }
 
-    DK_vkCreateTextureSampler( app, &dummyTexture.sampler );
+  DK_VULKAN_FUNC void DK_vkFreeMemory( DK_vkApplication *app, DK_vkAllocation *allocation )
+  {
+    DK_vkMemoryAllocator *allocator = &app->allocator;
 
-    vkDestroyBuffer( app->device, stagingBuffer, NULL );
-    vkFreeMemory( app->device, stagingBufferMemory, NULL );
+    if ( allocation->memory == VK_NULL_HANDLE )
+    {
+      return;
+    }
 
-    app->textures[0]                  = dummyTexture;
-    app->textureCount                 = 1;
-    app->currentTexture               = &app->textures[0];
-    app->batchRenderer.currentTexture = app->currentTexture;
+    if ( allocation->pool == DK_VK_MEMORY_POOL_DEDICATED )
+    {
+      if ( allocation->mapped != NULL )
+      {
+        vkUnmapMemory( app->device, allocation->memory );
+      }
+      vkFreeMemory( app->device, allocation->memory, NULL );
 
-    DK_vkUpdateDescriptorSetWithTexture( app, &app->textures[0] );
-  }
+      allocator->deviceAllocationCount--;
+      allocator->dedicatedCount--;
+      allocator->dedicatedBytes -= allocation->size;
+      memset( allocation, 0, sizeof( DK_vkAllocation ) );
+      return;
+    }
 
-  DK_VULKAN_FUNC void DK_vkInitTextureSystem( DK_vkApplication *app )
-  {
-    app->maxTextures        = DK_VK_MAX_TEXTURES;
-    app->textureCount       = 0;
-    app->activeTextureCount = 0;
+    DK_vkMemoryPool  *pool  = &allocator->pools[allocation->pool][allocation->memoryType];
+    DK_vkMemoryBlock *block = &pool->blocks[allocation->block];
 
-    if ( app->textures != NULL )
+    if ( allocation->pool != DK_VK_MEMORY_POOL_LINEAR )
     {
-      free( app->textures );
+      DK_vkBuddyFree( block, DK_vkGetBuddyOrder( allocation->size ), allocation->offset );
     }
-
-    app->textures = (DK_vkTexture *)malloc( sizeof( DK_vkTexture ) * DK_VK_MAX_TEXTURES );
-    if ( app->textures == NULL )
+    else if ( allocation->offset + allocation->size == block->head )
     {
-      fprintf( stderr, "Failed to allocate memory for textures array\n" );
-      exit( 1 );
+      block->head = allocation->offset;
     }
 
-    app->currentTexture = NULL;
-    DK_vkCreateDummyTexture( app );
-  }
+    block->used -= allocation->size;
+    block->allocationCount--;
+    memset( allocation, 0, sizeof( DK_vkAllocation ) );
 
-  DK_VULKAN_FUNC void DK_vkUpdateDescriptorSetsWithActiveTextures( DK_vkApplication *app )
-  {
-    if ( app->activeTextureCount == 0 )
+    if ( block->allocationCount > 0 )
     {
       return;
     }
+    block->head = 0;
 
-    VkDescriptorImageInfo *imageInfos = malloc( app->activeTextureCount * sizeof( VkDescriptorImageInfo ) );
-
-    uint32_t activeIndex = 0;
-    for ( uint32_t i = 0; i < app->textureCount; i++ )
+    // keep one empty block per pool so a resource that is recreated every frame does not hit the driver
+    for ( uint32_t i = 0; i < pool->blockCount; i++ )
     {
-      if ( app->textures[i].isActive )
+      if ( &pool->blocks[i] != block && pool->blocks[i].memory != VK_NULL_HANDLE &&
+           pool->blocks[i].allocationCount == 0 )
       {
-        imageInfos[activeIndex].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfos[activeIndex].imageView   = app->textures[i].view;
-        imageInfos[activeIndex].sampler     = app->textures[i].sampler;
-        activeIndex++;
+        DK_vkReleaseMemoryBlock( app, block );
+        return;
       }
     }
-
-    VkDescriptorBufferInfo bufferInfo = { 0 };
-    bufferInfo.buffer                 = app->uniformBuffer;
-    bufferInfo.offset                 = 0;
-    bufferInfo.range                  = sizeof( DK_vkUniformBufferObject );
-
-    VkWriteDescriptorSet descriptorWrites[2] = {};
-
-    descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet          = app->descriptorSet;
-    descriptorWrites[0].dstBinding      = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo     = &bufferInfo;
-
-    descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet          = app->descriptorSet;
-    descriptorWrites[1].dstBinding      = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = app->activeTextureCount;
-    descriptorWrites[1].pImageInfo      = imageInfos;
-
-    vkUpdateDescriptorSets( app->device, 2, descriptorWrites, 0, NULL );
-
-    free( imageInfos );
   }
 
-  DK_VULKAN_FUNC uint32_t DK_vkAddTexture( DK_vkApplication *app, const char *filename )
+  DK_VULKAN_FUNC void
+  DK_vkGetMemoryStats( DK_vkApplication *app, DK_vkMemoryPoolKind pool, DK_vkMemoryStats *stats )
   {
-    if ( app->textureCount >= app->maxTextures )
+    DK_vkMemoryAllocator *allocator = &app->allocator;
+    memset( stats, 0, sizeof( DK_vkMemoryStats ) );
+
+    if ( pool == DK_VK_MEMORY_POOL_DEDICATED )
     {
-      fprintf( stderr, "Maximum texture count reached\n" );
-      return 0;
+      stats->blockCount      = allocator->dedicatedCount;
+      stats->allocationCount = allocator->dedicatedCount;
+      stats->reservedBytes   = allocator->dedicatedBytes;
+      stats->usedBytes       = allocator->dedicatedBytes;
+      return;
     }
 
-    uint32_t textureId                 = app->textureCount++;
-    app->textures[textureId]           = DK_vkLoadTexture( app, filename );
-    app->textures[textureId].samplerId = textureId;
+    for ( uint32_t type = 0; type < allocator->memoryProperties.memoryTypeCount; type++ )
+    {
+      DK_vkMemoryPool *memoryPool = &allocator->pools[pool][type];
+      for ( uint32_t i = 0; i < memoryPool->blockCount; i++ )
+      {
+        DK_vkMemoryBlock *block = &memoryPool->blocks[i];
+        if ( block->memory == VK_NULL_HANDLE )
+        {
+          continue;
+        }
 
-    DK_vkUpdateDescriptorSetWithTextures( app );
+        stats->blockCount++;
+        stats->allocationCount += block->allocationCount;
+        stats->reservedBytes += DK_VK_MEMORY_BLOCK_SIZE;
+        stats->usedBytes += block->used;
 
-    return textureId;
+        VkDeviceSize largest = 0;
+        if ( pool == DK_VK_MEMORY_POOL_LINEAR )
+        {
+          largest = DK_VK_MEMORY_BLOCK_SIZE - block->head;
+        }
+        else
+        {
+          for ( uint32_t order = DK_VK_BUDDY_ORDER_COUNT; order > 0; order-- )
+          {
+            if ( block->freeCounts[order - 1] > 0 )
+            {
+              largest = (VkDeviceSize)DK_VK_MEMORY_MIN_ALLOCATION << ( order - 1 );
+              break;
+            }
+          }
+        }
+
+        if ( largest > stats->largestFreeRange )
+        {
+          stats->largestFreeRange = largest;
+        }
+      }
+    }
+
+    VkDeviceSize freeBytes = stats->reservedBytes - stats->usedBytes;
+    stats->fragmentation   = freeBytes > 0 ? 1.0f - (float)stats->largestFreeRange / (float)freeBytes : 0.0f;
   }
 
-  DK_VULKAN_FUNC void DK_vkSetTextureActive( DK_vkApplication *app, uint32_t textureId, bool active )
+  DK_VULKAN_FUNC void DK_vkPrintMemoryStats( DK_vkApplication *app )
   {
-    if ( textureId < app->textureCount )
+    const char *names[] = { "buddy", "buddy optimal", "linear", "dedicated" };
+
+    printf( "Info: %u device memory allocations, %u textures demoted, %u evicted\n",
+            app->allocator.deviceAllocationCount,
+            app->residency.demotedCount,
+            app->residency.evictedCount );
+    for ( uint32_t pool = 0; pool <= DK_VK_MEMORY_POOL_DEDICATED; pool++ )
     {
-      if ( active && !app->textures[textureId].isActive )
+      DK_vkMemoryStats stats;
+      DK_vkGetMemoryStats( app, (DK_vkMemoryPoolKind)pool, &stats );
+      if ( stats.blockCount == 0 )
       {
-        app->textures[textureId].isActive = true;
-        app->activeTextureCount++;
-      }
-      else if ( !active && app->textures[textureId].isActive )
-      {
-        app->textures[textureId].isActive = false;
-        if ( app->activeTextureCount > 0 )
-        {
-          app->activeTextureCount--;
-        }
+        continue;
       }
 
-      DK_vkUpdateDescriptorSetsWithActiveTextures( app );
+      printf( "Info: %-13s %u blocks, %u allocations, %.1f / %.1f MiB used, %.0f%% fragmented\n",
+              names[pool],
+              stats.blockCount,
+              stats.allocationCount,
+              (double)stats.usedBytes / ( 1024.0 * 1024.0 ),
+              (double)stats.reservedBytes / ( 1024.0 * 1024.0 ),
+              stats.fragmentation * 100.0f );
     }
   }
 
-  DK_VULKAN_FUNC void DK_vkSetTexture( DK_vkApplication *app, uint32_t textureId )
+  // ========================================================================================
+  // QOI DECODER IMPLEMENTATION
+  // ========================================================================================
+
+  DK_VULKAN_FUNC uint32_t DK_vkReadBigEndian32( const uint8_t *bytes )
   {
-    if ( textureId < app->textureCount )
-    {
-      app->currentTexture               = &app->textures[textureId];
-      app->batchRenderer.currentTexture = app->currentTexture;
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+  }
 
-      DK_vkUpdateDescriptorSetWithTexture( app, app->currentTexture );
-    }
+  DK_VULKAN_FUNC bool DK_vkIsQOI( const uint8_t *data, size_t size )
+  {
+    return size >= DK_VK_QOI_HEADER_SIZE + DK_VK_QOI_PADDING_SIZE &&
+           DK_vkReadBigEndian32( data ) == DK_VK_QOI_MAGIC;
   }
 
-  DK_VULKAN_FUNC void DK_vkUpdateDescriptorSetWithTexture( DK_vkApplication *app, DK_vkTexture *texture )
+  DK_VULKAN_FUNC bool DK_vkReadQOIHeader(
+      const uint8_t *data, size_t size, int32_t *width, int32_t *height, int32_t *channels )
   {
-    if ( !texture )
+    if ( !DK_vkIsQOI( data, size ) )
     {
-      return;
+      return false;
     }
 
-    VkDescriptorBufferInfo bufferInfo = { 0 };
-    bufferInfo.buffer                 = app->uniformBuffer;
-    bufferInfo.offset                 = 0;
-    bufferInfo.range                  = sizeof( DK_vkUniformBufferObject );
-
-    VkDescriptorImageInfo imageInfo = { 0 };
-    imageInfo.imageLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView             = texture->view;
-    imageInfo.sampler               = texture->sampler;
-
-    VkWriteDescriptorSet descriptorWrites[2] = {};
-
-    descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet          = app->descriptorSet;
-    descriptorWrites[0].dstBinding      = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo     = &bufferInfo;
-
-    descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet          = app->descriptorSet;
-    descriptorWrites[1].dstBinding      = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo      = &imageInfo;
+    uint32_t w = DK_vkReadBigEndian32( data + 4 );
+    uint32_t h = DK_vkReadBigEndian32( data + 8 );
+    if ( w == 0 || h == 0 || h >= DK_VK_QOI_PIXELS_MAX / w || ( data[12] != 3 && data[12] != 4 ) )
+    {
+      return false;
+    }
 
-    vkUpdateDescriptorSets( app->device, 2, descriptorWrites, 0, NULL );
+    *width    = (int32_t)w;
+    *height   = (int32_t)h;
+    *channels = data[12];
+    return true;
   }
 
-  DK_VULKAN_FUNC void DK_vkFlushBatch( DK_vkApplication *app )
+  /* Note: always decodes to RGBA, channels reports what the file stores like stbi_load does. The pixels
+   * are allocated with STBI_MALLOC so DK_vkFreeImage releases them the same way as stb_image output.
+   * Every op reads at most 5 bytes and the loop stops before the 8 byte end marker, no chunk can read
+   * past the buffer */
+  DK_VULKAN_FUNC unsigned char *DK_vkDecodeQOI(
+      const uint8_t *data, size_t size, int32_t *width, int32_t *height, int32_t *channels )
   {
-    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( !DK_vkReadQOIHeader( data, size, width, height, channels ) )
+    {
+      return NULL;
+    }
 
-    if ( renderer->vertexCount == 0 )
+    size_t         pixelCount = (size_t)*width * *height;
+    unsigned char *pixels     = (unsigned char *)STBI_MALLOC( pixelCount * 4 );
+    if ( pixels == NULL )
     {
-      return;
+      return NULL;
     }
 
-    if ( app->framebufferResized )
+    uint8_t  index[64][4] = { { 0 } };
+    uint8_t  px[4]        = { 0, 0, 0, 255 };
+    uint32_t run          = 0;
+    size_t   p            = DK_VK_QOI_HEADER_SIZE;
+    size_t   chunksEnd    = size - DK_VK_QOI_PADDING_SIZE;
+
+    for ( size_t i = 0; i < pixelCount; i++ )
     {
-      if ( renderer->hasBegun )
+      if ( run > 0 )
       {
-        vkEndCommandBuffer( renderer->commandBuffer );
-        renderer->hasBegun = false;
+        run--;
       }
-
-      vkDeviceWaitIdle( app->device );
-      app->framebufferResized = false;
-      DK_vkRecreateSwapChain( app );
-
-      if ( renderer->vertexCount > 0 )
+      else if ( p < chunksEnd )
       {
-        DK_vkBeginBatch( app );
+        uint8_t b1 = data[p++];
+        if ( b1 == DK_VK_QOI_OP_RGB )
+        {
+          px[0] = data[p++];
+          px[1] = data[p++];
+          px[2] = data[p++];
+        }
+        else if ( b1 == DK_VK_QOI_OP_RGBA )
+        {
+          px[0] = data[p++];
+          px[1] = data[p++];
+          px[2] = data[p++];
+          px[3] = data[p++];
+        }
+        else if ( ( b1 & DK_VK_QOI_MASK ) == DK_VK_QOI_OP_INDEX )
+        {
+          memcpy( px, index[b1], 4 );
+        }
+        else if ( ( b1 & DK_VK_QOI_MASK ) == DK_VK_QOI_OP_DIFF )
+        {
+          px[0] += ( ( b1 >> 4 ) & 0x03 ) - 2;
+          px[1] += ( ( b1 >> 2 ) & 0x03 ) - 2;
+          px[2] += ( b1 & 0x03 ) - 2;
+        }
+        else if ( ( b1 & DK_VK_QOI_MASK ) == DK_VK_QOI_OP_LUMA )
+        {
+          uint8_t b2 = data[p++];
+          int32_t vg = ( b1 & 0x3f ) - 32;
+          px[0] += vg - 8 + ( ( b2 >> 4 ) & 0x0f );
+          px[1] += vg;
+          px[2] += vg - 8 + ( b2 & 0x0f );
+        }
+        else
+        {
+          run = b1 & 0x3f;
+        }
+
+        memcpy( index[( px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11 ) % 64], px, 4 );
       }
-      return;
-    }
 
-    if ( renderer->currentTexture )
-    {
-      DK_vkUpdateDescriptorSetWithTexture( app, renderer->currentTexture );
-    }
-    else if ( app->textureCount > 0 )
-    {
-      DK_vkUpdateDescriptorSetWithTexture( app, &app->textures[0] );
-    }
-    else
-    {
-      // if no texture is available, create a dummy texture
-      DK_vkCreateDummyTexture( app );
-      DK_vkUpdateDescriptorSetWithTexture( app, &app->textures[0] );
+      memcpy( pixels + i * 4, px, 4 );
     }
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR( app->device,
-                                             app->swapChain,
-                                             UINT64_MAX,
-                                             app->imageAvailableSemaphores[app->currentFrame],
-                                             VK_NULL_HANDLE,
-                                             &imageIndex );
+    return pixels;
+  }
 
-    if ( result == VK_ERROR_OUT_OF_DATE_KHR )
+  // ========================================================================================
+  // TEXTURE CACHE IMPLEMENTATION
+  // ========================================================================================
+
+  /* Note: must be called before the first texture is loaded, the streaming workers read the directory
+   * without locking. NULL disables the cache */
+  DK_VULKAN_FUNC void DK_vkSetTextureCacheDirectory( DK_vkApplication *app, const char *directory )
+  {
+    free( app->textureCacheDirectory );
+    app->textureCacheDirectory = NULL;
+
+    if ( directory == NULL )
     {
-      app->framebufferResized = true;
       return;
     }
-    else if ( result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR )
+
+    struct stat st;
+    if ( stat( directory, &st ) != 0 && mkdir( directory, 0755 ) != 0 )
     {
-      fprintf( stderr, "Failed to acquire swap chain image\n" );
+      fprintf( stderr, "Failed to create texture cache directory: %s\n", directory );
       return;
     }
 
-    vkWaitForFences( app->device, 1, &app->inFlightFences[app->currentFrame], VK_TRUE, UINT64_MAX );
-    vkResetFences( app->device, 1, &app->inFlightFences[app->currentFrame] );
-
-    VkRenderPassBeginInfo renderPassInfo = { 0 };
-    renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass            = app->renderPass;
-    renderPassInfo.framebuffer           = app->swapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset.x   = 0;
-    renderPassInfo.renderArea.offset.y   = 0;
-    renderPassInfo.renderArea.extent     = app->swapChainExtent;
-
-    VkClearValue clearColor        = { 0.0f, 0.0f, 0.0f, 1.0f };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues    = &clearColor;
-
-    vkCmdBeginRenderPass( renderer->commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
-    vkCmdBindPipeline( renderer->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->pipeline );
+    app->textureCacheDirectory = DK_vkCopyString( directory );
+  }
 
-    vkCmdBindDescriptorSets( renderer->commandBuffer,
-                             VK_PIPELINE_BIND_POINT_GRAPHICS,
-                             renderer->pipelineLayout,
-                             0,
-                             1,
-                             &app->descriptorSet,
-                             0,
-                             NULL );
+  // entries are named after the hash of the source path, the path itself is stored to catch collisions
+  DK_VULKAN_FUNC void
+  DK_vkGetTextureCachePath( const char *directory, const char *filename, char *path, size_t pathSize )
+  {
+    uint64_t hash = DK_vkHashBytes( filename, strlen( filename ), DK_VK_HASH_SEED );
+    snprintf( path, pathSize, "%s/%016llx.dkt", directory, (unsigned long long)hash );
+  }
 
-    VkBuffer     vertexBuffers[] = { renderer->vertexBuffer };
-    VkDeviceSize offsets[]       = { 0 };
-    vkCmdBindVertexBuffers( renderer->commandBuffer, 0, 1, vertexBuffers, offsets );
-    vkCmdBindIndexBuffer( renderer->commandBuffer, renderer->indexBuffer, 0, VK_INDEX_TYPE_UINT32 );
+  DK_VULKAN_FUNC bool DK_vkHashFile( const char *filename, uint64_t *hash )
+  {
+    int32_t fd = open( filename, O_RDONLY );
+    if ( fd == -1 )
+    {
+      return false;
+    }
 
-    vkCmdDrawIndexed( renderer->commandBuffer, renderer->indexCount, 1, 0, 0, 0 );
-    vkCmdEndRenderPass( renderer->commandBuffer );
-    vkEndCommandBuffer( renderer->commandBuffer );
+    struct stat st;
+    if ( fstat( fd, &st ) == -1 || st.st_size == 0 )
+    {
+      close( fd );
+      return false;
+    }
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType        = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    void *data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( data == MAP_FAILED )
+    {
+      return false;
+    }
 
-    VkSemaphore          waitSemaphores[] = { app->imageAvailableSemaphores[app->currentFrame] };
-    VkPipelineStageFlags waitStages[]     = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount         = 1;
-    submitInfo.pWaitSemaphores            = waitSemaphores;
-    submitInfo.pWaitDstStageMask          = waitStages;
+    *hash = DK_vkHashBytes( data, st.st_size, DK_VK_HASH_SEED );
+    munmap( data, st.st_size );
+    return true;
+  }
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &renderer->commandBuffer;
+  /* Note: the entry stays mapped, image->pixels points right behind the header and the path so the
+   * upload copies straight from the page cache into staging memory. A source that was touched but not
+   * changed is recognised by its content hash and the entry's mtime is updated */
+  DK_VULKAN_FUNC bool DK_vkReadTextureCache( const char        *directory,
+                                             const char        *filename,
+                                             const struct stat *source,
+                                             DK_vkImageData    *image )
+  {
+    char path[4096];
+    DK_vkGetTextureCachePath( directory, filename, path, sizeof( path ) );
 
-    VkSemaphore signalSemaphores[]  = { app->renderFinishedSemaphores[app->currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores    = signalSemaphores;
+    int32_t fd = open( path, O_RDWR );
+    if ( fd == -1 )
+    {
+      return false;
+    }
 
-    if ( vkQueueSubmit( app->graphicsQueue, 1, &submitInfo, app->inFlightFences[app->currentFrame] ) !=
-         VK_SUCCESS )
+    struct stat st;
+    if ( fstat( fd, &st ) == -1 || (size_t)st.st_size < sizeof( DK_vkTextureCacheHeader ) )
     {
-      fprintf( stderr, "Failed to submit batch draw command buffer\n" );
-      exit( 1 );
+      close( fd );
+      return false;
     }
 
-    VkPresentInfoKHR presentInfo   = {};
-    presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores    = signalSemaphores;
+    void *mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( mapping == MAP_FAILED )
+    {
+      close( fd );
+      return false;
+    }
 
-    VkSwapchainKHR swapChains[] = { app->swapChain };
-    presentInfo.swapchainCount  = 1;
-    presentInfo.pSwapchains     = swapChains;
-    presentInfo.pImageIndices   = &imageIndex;
+    DK_vkTextureCacheHeader header      = *(const DK_vkTextureCacheHeader *)mapping;
+    const char             *storedPath  = (const char *)mapping + sizeof( DK_vkTextureCacheHeader );
+    size_t                  pathLength  = strlen( filename );
+    size_t                  pixelOffset = sizeof( DK_vkTextureCacheHeader ) + header.pathLength;
 
-    result = vkQueuePresentKHR( app->presentQueue, &presentInfo );
+    bool valid = header.magic == DK_VK_TEXTURE_CACHE_MAGIC && header.version == DK_VK_TEXTURE_CACHE_VERSION &&
+                 header.pathLength == pathLength && header.width > 0 && header.height > 0 &&
+                 (size_t)st.st_size == pixelOffset + (size_t)header.width * header.height * 4 &&
+                 memcmp( storedPath, filename, pathLength ) == 0 &&
+                 header.sourceSize == (uint64_t)source->st_size;
 
-    if ( result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || app->framebufferResized )
+    if ( valid && header.sourceMtime != (int64_t)source->st_mtime )
     {
-      app->framebufferResized = false;
-      DK_vkRecreateSwapChain( app );
+      uint64_t hash = 0;
+      valid         = DK_vkHashFile( filename, &hash ) && hash == header.sourceHash;
+      if ( valid )
+      {
+        header.sourceMtime = (int64_t)source->st_mtime;
+        if ( lseek( fd, 0, SEEK_SET ) == -1 || write( fd, &header, sizeof( header ) ) != sizeof( header ) )
+        {
+          fprintf( stderr, "Failed to update texture cache entry: %s\n", path );
+        }
+      }
     }
-    else if ( result != VK_SUCCESS )
+    close( fd );
+
+    if ( !valid )
     {
-      fprintf( stderr, "Failed to present swap chain image\n" );
+      munmap( mapping, st.st_size );
+      return false;
     }
 
-    app->currentFrame     = ( app->currentFrame + 1 ) % DK_VULKAN_MAX_FRAMES_IN_FLIGHT;
-    renderer->vertexCount = 0;
-    renderer->indexCount  = 0;
+    image->pixels      = (unsigned char *)mapping + pixelOffset;
+    image->width       = header.width;
+    image->height      = header.height;
+    image->channels    = header.channels;
+    image->mapping     = mapping;
+    image->mappingSize = st.st_size;
+    return true;
   }
 
-  DK_VULKAN_FUNC void DK_vkCleanupTextureSystem( DK_vkApplication *app )
+  /* Note: written to a temporary file that is renamed over the entry, a reader never sees a partial
+   * entry. When another thread is already writing the same entry this one gives up */
+  DK_VULKAN_FUNC void DK_vkWriteTextureCache( const char           *directory,
+                                              const char           *filename,
+                                              const struct stat    *source,
+                                              const DK_vkImageData *image )
   {
+    DK_vkTextureCacheHeader header = { 0 };
+    header.magic                   = DK_VK_TEXTURE_CACHE_MAGIC;
+    header.version                 = DK_VK_TEXTURE_CACHE_VERSION;
+    header.sourceMtime             = (int64_t)source->st_mtime;
+    header.sourceSize              = (uint64_t)source->st_size;
+    header.width                   = image->width;
+    header.height                  = image->height;
+    header.channels                = image->channels;
+    header.pathLength              = (uint32_t)strlen( filename );
+
+    if ( !DK_vkHashFile( filename, &header.sourceHash ) )
+    {
+      return;
+    }
 
-    vkDeviceWaitIdle( app->device );
-    DK_vkCleanupSwapChain( app );
+    char path[4096];
+    char temporaryPath[4096 + 7];
+    DK_vkGetTextureCachePath( directory, filename, path, sizeof( path ) );
+    snprintf( temporaryPath, sizeof( temporaryPath ), "%s.XXXXXX", path );
 
-    if ( app->batchRenderer.vertexBuffer != VK_NULL_HANDLE )
+    // a unique name per writer, a temporary file left behind by a crash never blocks the entry
+    int32_t fd = mkstemp( temporaryPath );
+    if ( fd == -1 )
     {
-      DK_vkDestroyBatchRenderer( app );
+      return;
     }
+    fchmod( fd, 0644 );
 
-    if ( app->textures != NULL )
+    size_t pixelSize = (size_t)image->width * image->height * 4;
+    bool   written   = write( fd, &header, sizeof( header ) ) == sizeof( header ) &&
+                   write( fd, filename, header.pathLength ) == (ssize_t)header.pathLength &&
+                   write( fd, image->pixels, pixelSize ) == (ssize_t)pixelSize;
+    close( fd );
+
+    if ( !written || rename( temporaryPath, path ) != 0 )
     {
-      DK_vkCleanupTextureSystem( app );
+      fprintf( stderr, "Failed to write texture cache entry: %s\n", path );
+      unlink( temporaryPath );
     }
+  }
 
-    app->currentTexture               = NULL;
-    app->batchRenderer.currentTexture = NULL;
+  // decodes through the cache when cacheDirectory is set, safe to call from the streaming workers
+  DK_VULKAN_FUNC bool
+  DK_vkLoadImage( const char *cacheDirectory, const char *filename, DK_vkImageData *image )
+  {
+    memset( image, 0, sizeof( DK_vkImageData ) );
 
-    for ( uint32_t i = 0; i < app->textureCount; i++ )
+    struct stat source;
+    bool        cacheable = cacheDirectory != NULL && stat( filename, &source ) == 0;
+    if ( cacheable && DK_vkReadTextureCache( cacheDirectory, filename, &source, image ) )
     {
-      if ( app->textures[i].sampler != VK_NULL_HANDLE )
-      {
-        vkDestroySampler( app->device, app->textures[i].sampler, NULL );
-        app->textures[i].sampler = VK_NULL_HANDLE;
-      }
-
-      if ( app->textures[i].view != VK_NULL_HANDLE )
-      {
-        vkDestroyImageView( app->device, app->textures[i].view, NULL );
-        app->textures[i].view = VK_NULL_HANDLE;
-      }
+      return true;
+    }
 
-      if ( app->textures[i].image != VK_NULL_HANDLE )
-      {
-        vkDestroyImage( app->device, app->textures[i].image, NULL );
-        app->textures[i].image = VK_NULL_HANDLE;
-      }
+    if ( !DK_vkDecodeImageFile( filename, image ) )
+    {
+      return false;
+    }
 
-      if ( app->textures[i].memory != VK_NULL_HANDLE )
-      {
-        vkFreeMemory( app->device, app->textures[i].memory, NULL );
-        app->textures[i].memory = VK_NULL_HANDLE;
-      }
+    if ( cacheable )
+    {
+      DK_vkWriteTextureCache( cacheDirectory, filename, &source, image );
     }
 
-    free( app->textures );
-    app->textures     = NULL;
-    app->textureCount = 0;
-    app->maxTextures  = 0;
+    return true;
   }
 
-  DK_VULKAN_FUNC void
-  DK_vkDrawTriangle( DK_vkApplication *app, DK_vkVec2 p1, DK_vkVec2 p2, DK_vkVec2 p3, DK_vkColor tint )
+  /* Note: the file is mapped once and the decoder is picked by its magic bytes, QOI images go through
+   * DK_vkDecodeQOI and everything else through stb_image */
+  DK_VULKAN_FUNC bool DK_vkDecodeImageFile( const char *filename, DK_vkImageData *image )
   {
-    DK_vkRenderer *renderer = &app->batchRenderer;
-    if ( !renderer->hasBegun )
+    int32_t fd = open( filename, O_RDONLY );
+    if ( fd == -1 )
     {
-      DK_vkBeginBatch( app );
+      return false;
     }
 
-    if ( renderer->vertexCount + 3 > MAX_BATCH_VERTICES || renderer->indexCount + 3 > MAX_BATCH_INDICES )
+    struct stat st;
+    if ( fstat( fd, &st ) == -1 || st.st_size <= 0 || st.st_size > INT32_MAX )
     {
-      DK_vkFlushBatch( app );
-      DK_vkBeginBatch( app );
+      close( fd );
+      return false;
     }
 
-    uint32_t baseIndex = renderer->vertexCount;
-
-    DK_vkAddVertex( renderer, p1[0], p1[1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
-    DK_vkAddVertex( renderer, p2[0], p2[1], tint[0], tint[1], tint[2], tint[3], 1.0f, 0.0f, -1 );
-    DK_vkAddVertex( renderer, p3[0], p3[1], tint[0], tint[1], tint[2], tint[3], 0.5f, 1.0f, -1 );
+    void *mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( mapping == MAP_FAILED )
+    {
+      return false;
+    }
 
-    if ( renderer->indexCount + 3 <= MAX_BATCH_INDICES )
+    const uint8_t *data = (const uint8_t *)mapping;
+    if ( DK_vkIsQOI( data, st.st_size ) )
     {
-      DK_vkAddIndex( renderer, baseIndex );
-      DK_vkAddIndex( renderer, baseIndex + 1 );
-      DK_vkAddIndex( renderer, baseIndex + 2 );
+      image->pixels = DK_vkDecodeQOI( data, st.st_size, &image->width, &image->height, &image->channels );
     }
     else
     {
-      printf( "Warning: Index buffer overflow in DK_vkDrawTriangle!\n" );
+      image->pixels = stbi_load_from_memory(
+          data, (int)st.st_size, &image->width, &image->height, &image->channels, STBI_rgb_alpha );
     }
+
+    munmap( mapping, st.st_size );
+    return image->pixels != NULL;
   }
 
-  DK_VULKAN_FUNC void DK_vkDrawQuad( DK_vkApplication *app,
-                                     DK_vkVec2         p1,
-                                     DK_vkVec2         p2,
-                                     DK_vkVec2         p3,
-                                     DK_vkVec2         p4,
-                                     DK_vkColor        tint )
+  // reads only the header, the QOI counterpart of stbi_info
+  DK_VULKAN_FUNC bool
+  DK_vkReadImageInfo( const char *filename, int32_t *width, int32_t *height, int32_t *channels )
   {
-
-    DK_vkRenderer *renderer = &app->batchRenderer;
-    if ( !renderer->hasBegun )
+    FILE *file = fopen( filename, "rb" );
+    if ( file == NULL )
     {
-      DK_vkBeginBatch( app );
+      return false;
     }
 
-    if ( renderer->vertexCount + 4 > MAX_BATCH_VERTICES || renderer->indexCount + 6 > MAX_BATCH_INDICES )
+    uint8_t header[DK_VK_QOI_HEADER_SIZE + DK_VK_QOI_PADDING_SIZE];
+    size_t  size = fread( header, 1, sizeof( header ), file );
+    fclose( file );
+
+    if ( DK_vkIsQOI( header, size ) )
     {
-      DK_vkFlushBatch( app );
-      DK_vkBeginBatch( app );
+      return DK_vkReadQOIHeader( header, size, width, height, channels );
     }
 
-    uint32_t baseIndex = renderer->vertexCount;
-    DK_vkAddVertex( renderer, p1[0], p1[1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
-    DK_vkAddVertex( renderer, p2[0], p2[1], tint[0], tint[1], tint[2], tint[3], 1.0f, 0.0f, -1 );
-    DK_vkAddVertex( renderer, p3[0], p3[1], tint[0], tint[1], tint[2], tint[3], 1.0f, 1.0f, -1 );
-    DK_vkAddVertex( renderer, p4[0], p4[1], tint[0], tint[1], tint[2], tint[3], 0.0f, 1.0f, -1 );
+    return stbi_info( filename, width, height, channels );
+  }
 
-    if ( renderer->indexCount + 6 <= MAX_BATCH_INDICES )
+  DK_VULKAN_FUNC void DK_vkFreeImage( DK_vkImageData *image )
+  {
+    if ( image->mapping != NULL )
     {
-      DK_vkAddIndex( renderer, baseIndex );
-      DK_vkAddIndex( renderer, baseIndex + 1 );
-      DK_vkAddIndex( renderer, baseIndex + 2 );
-
-      DK_vkAddIndex( renderer, baseIndex );
-      DK_vkAddIndex( renderer, baseIndex + 2 );
-      DK_vkAddIndex( renderer, baseIndex + 3 );
+      munmap( image->mapping, image->mappingSize );
     }
     else
     {
-      printf( "Warning: Index buffer overflow in DK_vkDrawQuad!\n" );
+      stbi_image_free( image->pixels );
     }
-  }
 
-  DK_VULKAN_FUNC void
-  DK_vkDrawRectangle( DK_vkApplication *app, DK_vkVec2 position, DK_vkSize size, DK_vkColor tint )
-  {
-
-    DK_vkVec2 p1 = { position[0], position[1] };
-    DK_vkVec2 p2 = { position[0] + size[0], position[1] };
-    DK_vkVec2 p3 = { position[0] + size[0], position[1] + size[1] };
-    DK_vkVec2 p4 = { position[0], position[1] + size[1] };
-    DK_vkDrawQuad( app, p1, p2, p3, p4, tint );
+    memset( image, 0, sizeof( DK_vkImageData ) );
   }
 
-  DK_VULKAN_FUNC void DK_vkDrawRoundedRectangle( DK_vkApplication *app,
-                                                 DK_vkVec2         position,
-                                                 DK_vkSize         size,
-                                                 float             radius,
-                                                 DK_vkColor        tint,
-                                                 int32_t           segments )
+  // ========================================================================================
+  // DYNAMIC TEXTURE IMPLEMENTATION
+  // ========================================================================================
+
+  /* Note: the texture starts out transparent, has a single mip level and no source file, so it is never
+   * shared, demoted or evicted. Its pixels change through DK_vkUpdateTextureRegion */
+  DK_VULKAN_FUNC uint32_t DK_vkCreateDynamicTexture( DK_vkApplication *app, uint32_t width, uint32_t height )
   {
-    if ( segments < 4 )
+    if ( !DK_vkHasFreeTextureSlot( app ) )
     {
-      segments = 4;
+      fprintf( stderr, "Maximum texture count reached\n" );
+      return 0;
     }
 
-    float x = position[0];
-    float y = position[1];
+    VkDeviceSize           imageSize = (VkDeviceSize)width * height * 4;
+    DK_vkStagingAllocation staging   = DK_vkAllocateStaging( app, imageSize );
+    memset( staging.data, 0, imageSize );
+
+    DK_vkTexture texture = { 0 };
+    DK_vkCreateImage( app,
+                      width,
+                      height,
+                      1,
+                      VK_FORMAT_R8G8B8A8_SRGB,
+                      VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &texture.image,
+                      &texture.memory );
+
+    DK_vkTransitionImageLayout( app,
+                                texture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+
+    DK_vkCopyBufferToImageRegion( app, staging.buffer, staging.offset, texture.image, 0, 0, width, height );
+
+    DK_vkTransitionImageLayout( app,
+                                texture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+    DK_vkCreateTextureImageView( app, texture.image, &texture.view );
+    DK_vkCreateTextureSampler( app, &texture.sampler );
+
+    texture.width      = (int32_t)width;
+    texture.height     = (int32_t)height;
+    texture.channels   = 4;
+    texture.format     = VK_FORMAT_R8G8B8A8_SRGB;
+    texture.mipLevels  = 1;
+    texture.layerCount = 1;
+    texture.residency  = DK_VK_TEXTURE_RESIDENT;
+    texture.isDynamic  = true;
+
+    return DK_vkRegisterTexture( app, texture );
+  }
+
+  /* Note: pixels are RGBA rows stride bytes apart, 0 for tightly packed rows. The rows are copied into the
+   * update ring right away so the caller can reuse its buffer, the copy into the image is recorded ahead
+   * of the render pass of the next DK_vkFlushBatch and is visible to everything drawn in that batch.
+   * When the ring segment is full the queued updates and this one are submitted at once instead */
+  DK_VULKAN_FUNC void DK_vkUpdateTextureRegion( DK_vkApplication    *app,
+                                                uint32_t             textureId,
+                                                int32_t              x,
+                                                int32_t              y,
+                                                uint32_t             width,
+                                                uint32_t             height,
+                                                const unsigned char *pixels,
+                                                uint32_t             stride )
+  {
+    uint32_t index = DK_vkGetTextureIndex( app, textureId );
+    if ( index == 0 || !app->textures[index].isDynamic )
+    {
+      fprintf( stderr, "Texture %u is not a dynamic texture\n", textureId );
+      return;
+    }
+
+    DK_vkTexture *texture = &app->textures[index];
+    // compared against the space left after x and y so a huge width or height can not wrap around
+    if ( x < 0 || y < 0 || width == 0 || height == 0 || (uint32_t)x >= (uint32_t)texture->width ||
+         (uint32_t)y >= (uint32_t)texture->height || width > (uint32_t)texture->width - (uint32_t)x ||
+         height > (uint32_t)texture->height - (uint32_t)y )
+    {
+      fprintf( stderr, "Texture region is outside of texture %u\n", textureId );
+      return;
+    }
+
+    if ( stride != 0 && stride < width * 4 )
+    {
+      fprintf( stderr, "Texture region stride %u is shorter than a row\n", stride );
+      return;
+    }
+
+    DK_vkTextureUpdateRing *ring    = &app->textureUpdates;
+    size_t                  rowSize = (size_t)width * 4;
+    VkDeviceSize            size    = (VkDeviceSize)rowSize * height;
+    size   = ( size + DK_VK_STAGING_ALIGNMENT - 1 ) & ~(VkDeviceSize)( DK_VK_STAGING_ALIGNMENT - 1 );
+    stride = stride != 0 ? stride : (uint32_t)rowSize;
+
+    if ( ring->head + size > DK_VK_TEXTURE_UPDATE_SEGMENT_SIZE )
+    {
+      DK_vkStagingAllocation staging = DK_vkAllocateStaging( app, size );
+      for ( uint32_t row = 0; row < height; row++ )
+      {
+        memcpy( (unsigned char *)staging.data + row * rowSize, pixels + (size_t)row * stride, rowSize );
+      }
+
+      // queued updates go first so an older update never lands on top of this one
+      VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
+      DK_vkRecordTextureUpdates( app, commandBuffer );
+      DK_vkRecordTextureCopy(
+          commandBuffer, staging.buffer, staging.offset, texture->image, x, y, width, height );
+      DK_vkEndSingleTimeCommands( app, commandBuffer );
+      return;
+    }
+
+    if ( ring->buffer == VK_NULL_HANDLE )
+    {
+      DK_vkCreateBufferEx( app,
+                           (VkDeviceSize)DK_VK_TEXTURE_UPDATE_SEGMENT_SIZE * DK_VULKAN_MAX_FRAMES_IN_FLIGHT,
+                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           DK_VK_MEMORY_POOL_LINEAR,
+                           &ring->buffer,
+                           &ring->memory );
+    }
+
+    // the first write into a segment waits for the frame that last read it, not for the whole queue
+    if ( ring->head == 0 )
+    {
+      vkWaitForFences( app->device, 1, &app->inFlightFences[app->currentFrame], VK_TRUE, UINT64_MAX );
+    }
+
+    if ( ring->updateCount == ring->updateCapacity )
+    {
+      ring->updateCapacity = ring->updateCapacity ? ring->updateCapacity * 2 : 16;
+      ring->updates        = (DK_vkTextureUpdate *)realloc( ring->updates,
+                                                     ring->updateCapacity * sizeof( DK_vkTextureUpdate ) );
+    }
+
+    VkDeviceSize   offset = (VkDeviceSize)app->currentFrame * DK_VK_TEXTURE_UPDATE_SEGMENT_SIZE + ring->head;
+    unsigned char *mapped = (unsigned char *)ring->memory.mapped + offset;
+    for ( uint32_t row = 0; row < height; row++ )
+    {
+      memcpy( mapped + row * rowSize, pixels + (size_t)row * stride, rowSize );
+    }
+
+    DK_vkTextureUpdate *update = &ring->updates[ring->updateCount++];
+    update->textureId          = index;
+    update->offset             = offset;
+    update->x                  = x;
+    update->y                  = y;
+    update->width              = width;
+    update->height             = height;
+
+    ring->head += size;
+  }
+
+  /* Note: called by DK_vkFlushBatch outside of the render pass. Once the copies are submitted the segment
+   * is free again, copies recorded into an open upload batch keep reading it until DK_vkEndUploads */
+  DK_VULKAN_FUNC void DK_vkRecordTextureUpdates( DK_vkApplication *app, VkCommandBuffer commandBuffer )
+  {
+    DK_vkTextureUpdateRing *ring = &app->textureUpdates;
+
+    for ( uint32_t i = 0; i < ring->updateCount; i++ )
+    {
+      DK_vkTextureUpdate *update = &ring->updates[i];
+      DK_vkRecordTextureCopy( commandBuffer,
+                              ring->buffer,
+                              update->offset,
+                              app->textures[update->textureId].image,
+                              update->x,
+                              update->y,
+                              update->width,
+                              update->height );
+    }
+
+    ring->updateCount = 0;
+    if ( app->uploads.depth == 0 || commandBuffer != app->uploads.commandBuffer )
+    {
+      ring->head = 0;
+    }
+  }
+
+  // the image is sampled before and after the copy, it stays in SHADER_READ_ONLY_OPTIMAL outside of it
+  DK_VULKAN_FUNC void DK_vkRecordTextureCopy( VkCommandBuffer commandBuffer,
+                                              VkBuffer        buffer,
+                                              VkDeviceSize    bufferOffset,
+                                              VkImage         image,
+                                              int32_t         x,
+                                              int32_t         y,
+                                              uint32_t        width,
+                                              uint32_t        height )
+  {
+    VkImageMemoryBarrier barrier            = {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask                   = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0,
+                          0,
+                          NULL,
+                          0,
+                          NULL,
+                          1,
+                          &barrier );
+
+    VkBufferImageCopy region               = { 0 };
+    region.bufferOffset                    = bufferOffset;
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageOffset                     = (VkOffset3D){ x, y, 0 };
+    region.imageExtent                     = (VkExtent3D){ width, height, 1 };
+    vkCmdCopyBufferToImage( commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
+
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          0,
+                          0,
+                          NULL,
+                          0,
+                          NULL,
+                          1,
+                          &barrier );
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyTextureUpdateRing( DK_vkApplication *app )
+  {
+    DK_vkTextureUpdateRing *ring = &app->textureUpdates;
+    if ( ring->buffer != VK_NULL_HANDLE )
+    {
+      vkDestroyBuffer( app->device, ring->buffer, NULL );
+      DK_vkFreeMemory( app, &ring->memory );
+    }
+
+    free( ring->updates );
+    memset( ring, 0, sizeof( DK_vkTextureUpdateRing ) );
+  }
+
+  // ========================================================================================
+  // TEXTURE RESIDENCY IMPLEMENTATION
+  // ========================================================================================
+
+  DK_VULKAN_FUNC char *DK_vkCopyString( const char *string )
+  {
+    size_t length = strlen( string ) + 1;
+    char  *copy   = (char *)malloc( length );
+    memcpy( copy, string, length );
+    return copy;
+  }
+
+  DK_VULKAN_FUNC void DK_vkQueryMemoryBudgetSupport( DK_vkApplication *app )
+  {
+    DK_vkResidency *residency       = &app->residency;
+    residency->memoryBudget         = false;
+    residency->getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+        app->instance, "vkGetPhysicalDeviceMemoryProperties2KHR" );
+
+    if ( residency->getMemoryProperties2 == NULL ||
+         !DK_vkHasDeviceExtension( app->physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME ) )
+    {
+      fprintf( stderr, "Memory budget not available, set one with DK_vkSetTextureBudget\n" );
+      return;
+    }
+
+    residency->memoryBudget = true;
+  }
+
+  // 0 falls back to the VK_EXT_memory_budget heap budget
+  DK_VULKAN_FUNC void DK_vkSetTextureBudget( DK_vkApplication *app, VkDeviceSize bytes )
+  {
+    app->residency.budget = bytes;
+  }
+
+  DK_VULKAN_FUNC VkDeviceSize DK_vkGetTextureMemoryUsage( DK_vkApplication *app )
+  {
+    VkDeviceSize usage = 0;
+    for ( uint32_t i = 1; i < app->textureCount; i++ )
+    {
+      usage += app->textures[i].memory.size;
+    }
+    return usage;
+  }
+
+  /* Note: with VK_EXT_memory_budget the usage includes every allocation of the process and of other
+   * processes sharing the heap, the renderer aims for DK_VK_RESIDENCY_BUDGET_FRACTION of the budget */
+  DK_VULKAN_FUNC VkDeviceSize DK_vkGetMemoryOverBudget( DK_vkApplication *app )
+  {
+    DK_vkResidency *residency = &app->residency;
+
+    if ( residency->budget > 0 )
+    {
+      VkDeviceSize usage = DK_vkGetTextureMemoryUsage( app );
+      return usage > residency->budget ? usage - residency->budget : 0;
+    }
+
+    if ( !residency->memoryBudget )
+    {
+      return 0;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = { 0 };
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties = { 0 };
+    properties.sType                             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext                             = &budget;
+    residency->getMemoryProperties2( app->physicalDevice, &properties );
+
+    VkDeviceSize excess = 0;
+    for ( uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; i++ )
+    {
+      if ( !( properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ) )
+      {
+        continue;
+      }
+
+      VkDeviceSize target = (VkDeviceSize)( budget.heapBudget[i] * DK_VK_RESIDENCY_BUDGET_FRACTION );
+      if ( budget.heapUsage[i] > target )
+      {
+        excess += budget.heapUsage[i] - target;
+      }
+    }
+
+    return excess;
+  }
+
+  // evicted textures are queued for reloading the first time they are drawn again
+  DK_VULKAN_FUNC void DK_vkTouchTexture( DK_vkApplication *app, uint32_t index )
+  {
+    if ( index == 0 || index >= app->textureCount )
+    {
+      return;
+    }
+
+    DK_vkTexture *texture  = &app->textures[index];
+    texture->lastUsedFrame = app->residency.frame;
+
+    if ( texture->residency == DK_VK_TEXTURE_EVICTED && texture->source != NULL )
+    {
+      texture->residency = DK_VK_TEXTURE_STREAMING;
+      DK_vkQueueTextureJob( app, texture->samplerId, texture->source );
+    }
+  }
+
+  DK_VULKAN_FUNC bool DK_vkCanDemoteTexture( DK_vkTexture *texture )
+  {
+    int32_t size = texture->width > texture->height ? texture->width : texture->height;
+    return texture->mipLevels > 1 && ( size >> texture->baseLevel ) > DK_VK_RESIDENCY_MIN_EXTENT;
+  }
+
+  /* Note: the queue must be idle. Levels 1 to n are copied into a new image one level shorter, width and
+   * height of the texture stay the same so draw sizes and uv coordinates do not change */
+  DK_VULKAN_FUNC void DK_vkDemoteTexture( DK_vkApplication *app, DK_vkTexture *texture )
+  {
+    uint32_t mipLevels = texture->mipLevels - 1;
+    uint32_t width     = (uint32_t)texture->width >> ( texture->baseLevel + 1 );
+    uint32_t height    = (uint32_t)texture->height >> ( texture->baseLevel + 1 );
+    width              = width > 0 ? width : 1;
+    height             = height > 0 ? height : 1;
+
+    uint32_t layerCount = texture->layerCount > 1 ? texture->layerCount : 1;
+
+    VkImage         image;
+    DK_vkAllocation memory;
+    DK_vkCreateImageEx( app,
+                        width,
+                        height,
+                        mipLevels,
+                        layerCount,
+                        texture->format,
+                        VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                            VK_IMAGE_USAGE_SAMPLED_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        &image,
+                        &memory );
+
+    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
+
+    VkImageMemoryBarrier barriers[2] = { 0 };
+    for ( uint32_t i = 0; i < 2; i++ )
+    {
+      barriers[i].sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barriers[i].srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+      barriers[i].dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+      barriers[i].subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      barriers[i].subresourceRange.baseMipLevel   = 0;
+      barriers[i].subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+      barriers[i].subresourceRange.baseArrayLayer = 0;
+      barriers[i].subresourceRange.layerCount     = layerCount;
+    }
+
+    barriers[0].image         = texture->image;
+    barriers[0].oldLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    barriers[1].image         = image;
+    barriers[1].oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0,
+                          0,
+                          NULL,
+                          0,
+                          NULL,
+                          2,
+                          barriers );
+
+    VkImageCopy regions[32] = { 0 };
+    for ( uint32_t level = 0; level < mipLevels; level++ )
+    {
+      uint32_t levelWidth  = width >> level;
+      uint32_t levelHeight = height >> level;
+
+      regions[level].srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      regions[level].srcSubresource.mipLevel   = level + 1;
+      regions[level].srcSubresource.layerCount = layerCount;
+      regions[level].dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      regions[level].dstSubresource.mipLevel   = level;
+      regions[level].dstSubresource.layerCount = layerCount;
+      regions[level].extent.width              = levelWidth > 0 ? levelWidth : 1;
+      regions[level].extent.height             = levelHeight > 0 ? levelHeight : 1;
+      regions[level].extent.depth              = 1;
+    }
+
+    vkCmdCopyImage( commandBuffer,
+                    texture->image,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    image,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    mipLevels,
+                    regions );
+
+    barriers[1].oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          0,
+                          0,
+                          NULL,
+                          0,
+                          NULL,
+                          1,
+                          &barriers[1] );
+
+    DK_vkEndSingleTimeCommands( app, commandBuffer );
+
+    vkDestroyImageView( app->device, texture->view, NULL );
+    vkDestroyImage( app->device, texture->image, NULL );
+    DK_vkFreeMemory( app, &texture->memory );
+
+    texture->image     = image;
+    texture->memory    = memory;
+    texture->mipLevels = mipLevels;
+    texture->baseLevel++;
+    DK_vkCreateTextureImageViewEx( app, image, texture->format, &texture->view );
+  }
+
+  // the sampler is shared through the cache and kept for the reload
+  DK_VULKAN_FUNC void DK_vkEvictTexture( DK_vkApplication *app, DK_vkTexture *texture )
+  {
+    vkDestroyImageView( app->device, texture->view, NULL );
+    vkDestroyImage( app->device, texture->image, NULL );
+    DK_vkFreeMemory( app, &texture->memory );
+
+    texture->view      = VK_NULL_HANDLE;
+    texture->image     = VK_NULL_HANDLE;
+    texture->residency = DK_VK_TEXTURE_EVICTED;
+  }
+
+  /* Note: called from DK_vkBeginBatch once the queue is idle. Textures drawn in the last
+   * DK_VK_RESIDENCY_IDLE_FRAMES frames are left alone, the least recently drawn one loses its top mip level
+   * while it is larger than DK_VK_RESIDENCY_MIN_EXTENT and is evicted after that if it has a source file.
+   * At most DK_VK_RESIDENCY_EVICTIONS_PER_POLL textures are changed per call */
+  DK_VULKAN_FUNC void DK_vkUpdateResidency( DK_vkApplication *app )
+  {
+    DK_vkResidency *residency = &app->residency;
+
+    // single time commands are deferred inside an upload batch, the old image could not be released
+    if ( app->uploads.depth > 0 )
+    {
+      return;
+    }
+
+    VkDeviceSize excess  = DK_vkGetMemoryOverBudget( app );
+    uint32_t     changed = 0;
+
+    while ( excess > 0 && changed < DK_VK_RESIDENCY_EVICTIONS_PER_POLL )
+    {
+      DK_vkTexture *victim = NULL;
+      for ( uint32_t i = 1; i < app->textureCount; i++ )
+      {
+        DK_vkTexture *texture = &app->textures[i];
+        if ( texture->view == VK_NULL_HANDLE ||
+             texture->lastUsedFrame + DK_VK_RESIDENCY_IDLE_FRAMES > residency->frame ||
+             ( !DK_vkCanDemoteTexture( texture ) && texture->source == NULL ) )
+        {
+          continue;
+        }
+
+        if ( victim == NULL || texture->lastUsedFrame < victim->lastUsedFrame )
+        {
+          victim = texture;
+        }
+      }
+
+      if ( victim == NULL )
+      {
+        break;
+      }
+
+      VkDeviceSize size = victim->memory.size;
+      if ( DK_vkCanDemoteTexture( victim ) )
+      {
+        DK_vkDemoteTexture( app, victim );
+        residency->demotedCount++;
+      }
+      else
+      {
+        DK_vkEvictTexture( app, victim );
+        residency->evictedCount++;
+      }
+
+      DK_vkMarkTextureDirty( app, (uint32_t)( victim - app->textures ) );
+
+      VkDeviceSize freed = size > victim->memory.size ? size - victim->memory.size : 0;
+      excess             = freed < excess ? excess - freed : 0;
+      changed++;
+    }
+  }
+
+  // ========================================================================================
+  // BATCH RENDERING IMPLEMENTATION
+  // ========================================================================================
+
+  DK_VULKAN_FUNC void DK_vkCreateBatchRenderer( DK_vkApplication *app )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+
+    renderer->vertexCount        = 0;
+    renderer->indexCount         = 0;
+    renderer->hasBegun           = false;
+    renderer->vertexBuffer       = VK_NULL_HANDLE;
+    renderer->vertexBufferMemory = (DK_vkAllocation){ 0 };
+    renderer->indexBuffer        = VK_NULL_HANDLE;
+    renderer->indexBufferMemory  = (DK_vkAllocation){ 0 };
+    renderer->commandBuffer      = VK_NULL_HANDLE;
+    renderer->vertexBufferMapped = NULL;
+    renderer->indexBufferMapped  = NULL;
+    renderer->currentTexture     = NULL;
+
+    VkDeviceSize vertexBufferSize = sizeof( DK_Vertex ) * MAX_BATCH_VERTICES;
+
+    DK_vkCreateBufferEx( app,
+                         vertexBufferSize,
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &renderer->vertexBuffer,
+                         &renderer->vertexBufferMemory );
+    renderer->vertexBufferMapped = (DK_Vertex *)renderer->vertexBufferMemory.mapped;
+
+    VkDeviceSize indexBufferSize = sizeof( uint32_t ) * MAX_BATCH_INDICES;
+
+    DK_vkCreateBufferEx( app,
+                         indexBufferSize,
+                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &renderer->indexBuffer,
+                         &renderer->indexBufferMemory );
+    renderer->indexBufferMapped = (uint32_t *)renderer->indexBufferMemory.mapped;
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool                 = app->commandPool;
+    allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount          = 1;
+
+    vkAllocateCommandBuffers( app->device, &allocInfo, &renderer->commandBuffer );
+
+    // NOTE (David) Batch renderer shares the existing pipeline for now, we need to create a specific pipeline for the batch renderer
+    renderer->pipeline       = app->graphicsPipeline;
+    renderer->pipelineLayout = app->pipelineLayout;
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyBatchRenderer( DK_vkApplication *app )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+
+    // the allocator owns the mapping
+    renderer->vertexBufferMapped = NULL;
+    renderer->indexBufferMapped  = NULL;
+
+    if ( renderer->vertexBuffer != VK_NULL_HANDLE )
+    {
+      vkDestroyBuffer( app->device, renderer->vertexBuffer, NULL );
+      renderer->vertexBuffer = VK_NULL_HANDLE;
+    }
+
+    DK_vkFreeMemory( app, &renderer->vertexBufferMemory );
+
+    if ( renderer->indexBuffer != VK_NULL_HANDLE )
+    {
+      vkDestroyBuffer( app->device, renderer->indexBuffer, NULL );
+      renderer->indexBuffer = VK_NULL_HANDLE;
+    }
+
+    DK_vkFreeMemory( app, &renderer->indexBufferMemory );
+
+    if ( renderer->commandBuffer != VK_NULL_HANDLE )
+    {
+      vkFreeCommandBuffers( app->device, app->commandPool, 1, &renderer->commandBuffer );
+      renderer->commandBuffer = VK_NULL_HANDLE;
+    }
+
+    free( renderer->commands );
+    renderer->commands        = NULL;
+    renderer->commandCount    = 0;
+    renderer->commandCapacity = 0;
+    renderer->segmentStart    = 0;
+
+    renderer->vertexCount    = 0;
+    renderer->indexCount     = 0;
+    renderer->hasBegun       = false;
+    renderer->currentTexture = NULL;
+  }
+
+  DK_VULKAN_FUNC void DK_vkBeginBatch( DK_vkApplication *app )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+
+    if ( renderer->hasBegun )
+    {
+      fprintf( stderr, "Batch already in progress\n" );
+      return;
+    }
+
+    vkQueueWaitIdle( app->graphicsQueue );
+    vkResetCommandBuffer( renderer->commandBuffer, 0 );
+
+    DK_vkPollUploads( app );
+    DK_vkReleaseRetiredTextures( app );
+    DK_vkPollTextureStreaming( app );
+    DK_vkUpdateResidency( app );
+
+    renderer->vertexCount  = 0;
+    renderer->indexCount   = 0;
+    renderer->commandCount = 0;
+    renderer->segmentStart = 0;
+    renderer->hasBegun     = true;
+
+    renderer->textureSlotCounts[0] = 1;
+    renderer->textureTableCount    = 1;
+    renderer->textureTable         = 0;
+    app->shapeCache.instanceCount  = 0;
+    app->shapeCache.batchClock     = app->shapeCache.clock;
+    app->shadowBatch.instanceCount = 0;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if ( vkBeginCommandBuffer( renderer->commandBuffer, &beginInfo ) != VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to begin command buffer for batch\n" );
+      exit( 1 );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkEndBatch( DK_vkApplication *app )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( !renderer->hasBegun )
+    {
+      fprintf( stderr, "No batch in progress\n" );
+      return;
+    }
+
+    if ( renderer->vertexCount > 0 || renderer->commandCount > 0 )
+    {
+      DK_vkFlushBatch( app );
+    }
+    else
+    {
+      if ( renderer->hasBegun )
+      {
+        vkEndCommandBuffer( renderer->commandBuffer );
+      }
+    }
+
+    renderer->hasBegun = false;
+    app->residency.frame++;
+  }
+
+  // host visible blocks stay mapped until they are released, only the caller's pointer is dropped
+  DK_VULKAN_FUNC void
+  DK_vkSafeUnmapMemory( DK_vkApplication *app, DK_vkAllocation *memory, void **mappedData )
+  {
+    if ( app && memory->memory != VK_NULL_HANDLE && *mappedData != NULL )
+    {
+      *mappedData = NULL;
+    }
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkAddVertex( DK_vkRenderer *renderer,
+                                          float          x,
+                                          float          y,
+                                          float          r,
+                                          float          g,
+                                          float          b,
+                                          float          a,
+                                          float          u,
+                                          float          v,
+                                          int32_t        samplerId )
+  {
+    DK_Vertex *vertex = &renderer->vertexBufferMapped[renderer->vertexCount];
+
+    vertex->pos[0]      = x;
+    vertex->pos[1]      = y;
+    vertex->color[0]    = r;
+    vertex->color[1]    = g;
+    vertex->color[2]    = b;
+    vertex->color[3]    = a;
+    vertex->texCoord[0] = u;
+    vertex->texCoord[1] = v;
+    vertex->samplerId   = samplerId;
+
+    return renderer->vertexCount++;
+  }
+
+  DK_VULKAN_FUNC void DK_vkAddIndex( DK_vkRenderer *renderer, uint32_t index )
+  {
+    renderer->indexBufferMapped[renderer->indexCount++] = index;
+  }
+
+  DK_VULKAN_FUNC void
+  DK_vkOrtho( float left, float right, float bottom, float top, float near, float far, DK_vkMat4 matrix )
+  {
+    memset( matrix, 0, sizeof( float ) * 16 );
+    matrix[0][0] = 2.0f / ( right - left );
+    matrix[1][1] = 2.0f / ( bottom - top );
+    matrix[2][2] = -2.0f / ( far - near );
+    matrix[3][0] = -( right + left ) / ( right - left );
+    matrix[3][1] = -( bottom + top ) / ( bottom - top );
+    matrix[3][2] = -( far + near ) / ( far - near );
+    matrix[3][3] = 1.0f;
+  }
+
+  DK_VULKAN_FUNC void DK_vkIdentityMatrix( DK_vkMat4 matrix )
+  {
+    memset( matrix, 0, sizeof( float ) * 16 );
+    matrix[0][0] = 1.0f;
+    matrix[1][1] = 1.0f;
+    matrix[2][2] = 1.0f;
+    matrix[3][3] = 1.0f;
+  }
+
+  DK_VULKAN_FUNC void DK_vkOrthoCameraInit( DK_vkApplication *app, float width, float height )
+  {
+    float aspectRatio = width / height;
+    float orthoWidth  = width;
+    float orthoHeight = orthoWidth / aspectRatio;
+
+    app->camera.zoom = 1.0f;
+    app->camera.near = -1.0f;
+    app->camera.far  = 1.0f;
+
+    app->camera.left   = 0;
+    app->camera.right  = orthoWidth;
+    app->camera.top    = 0;
+    app->camera.bottom = orthoHeight;
+  }
+
+  DK_VULKAN_FUNC void DK_vkOrthoCameraUpdate( DK_vkApplication *app, float width, float height )
+  {
+    float aspectRatio = width / height;
+    float orthoWidth  = width;
+    float orthoHeight = orthoWidth / aspectRatio;
+
+    app->camera.left   = 0;
+    app->camera.right  = orthoWidth;
+    app->camera.top    = 0;
+    app->camera.bottom = orthoHeight;
+  }
+
+  DK_VULKAN_FUNC void DK_vkZoomCamera( DK_vkApplication *app, float factor )
+  {
+    app->camera.zoom *= factor;
+    if ( app->camera.zoom < 0.1f )
+    {
+      app->camera.zoom = 0.1f;
+    }
+    if ( app->camera.zoom > 10.0f )
+    {
+      app->camera.zoom = 10.0f;
+    }
+
+    int32_t width, height;
+    glfwGetFramebufferSize( app->window, &width, &height );
+    DK_vkOrthoCameraUpdate( app, (float)width, (float)height );
+  }
+
+  DK_VULKAN_FUNC void DK_vkCreateDummyTexture( DK_vkApplication *app )
+  {
+    if ( app->textureCount > 0 )
+    {
+      return;
+    }
+
+    if ( app->textures == NULL )
+    {
+      app->maxTextures     = DK_vkGetTextureCapacity( app );
+      app->textureCount    = 0;
+      app->freeTextureSlot = 0;
+      app->textures        = (DK_vkTexture *)malloc( sizeof( DK_vkTexture ) * app->maxTextures );
+      if ( app->textures == NULL )
+      {
+        fprintf( stderr, "Failed to allocate memory for textures array\n" );
+        exit( 1 );
+      }
+    }
+
+    uint8_t      whitePixel[4] = { 255, 255, 255, 255 };
+    VkDeviceSize imageSize     = 4; // 1x1 RGBA
+
+    DK_vkStagingAllocation staging = DK_vkStageData( app, whitePixel, imageSize );
+
+    DK_vkTexture dummyTexture = { 0 };
+    dummyTexture.width        = 1;
+    dummyTexture.height       = 1;
+    dummyTexture.channels     = 4;
+
+    DK_vkCreateImage( app,
+                      1,
+                      1,
+                      1,
+                      VK_FORMAT_R8G8B8A8_SRGB,
+                      VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &dummyTexture.image,
+                      &dummyTexture.memory );
+
+    DK_vkTransitionImageLayout( app,
+                                dummyTexture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+
+    DK_vkCopyBufferToImageRegion( app, staging.buffer, staging.offset, dummyTexture.image, 0, 0, 1, 1 );
+
+    DK_vkTransitionImageLayout( app,
+                                dummyTexture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+    DK_vkCreateTextureImageView( app, dummyTexture.image, &dummyTexture.view );
+
+    DK_vkCreateTextureSampler( app, &dummyTexture.sampler );
+
+    app->textures[0]                  = dummyTexture;
+    app->textureCount                 = 1;
+    app->currentTexture               = &app->textures[0];
+    app->batchRenderer.currentTexture = app->currentTexture;
+
+    DK_vkUpdateDescriptorSetWithTexture( app, &app->textures[0] );
+  }
+
+  DK_VULKAN_FUNC void DK_vkInitTextureSystem( DK_vkApplication *app )
+  {
+    app->maxTextures        = DK_vkGetTextureCapacity( app );
+    app->textureCount       = 0;
+    app->activeTextureCount = 0;
+    app->freeTextureSlot    = 0;
+
+    if ( app->textures != NULL )
+    {
+      free( app->textures );
+    }
+
+    app->textures = (DK_vkTexture *)malloc( sizeof( DK_vkTexture ) * app->maxTextures );
+    if ( app->textures == NULL )
+    {
+      fprintf( stderr, "Failed to allocate memory for textures array\n" );
+      exit( 1 );
+    }
+
+    app->currentTexture = NULL;
+    DK_vkCreateDummyTexture( app );
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureCapacity( DK_vkApplication *app )
+  {
+    return app->bindlessTextures ? app->bindlessTextureCapacity : DK_VK_MAX_LOADED_TEXTURES;
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureSlotCount( DK_vkApplication *app )
+  {
+    return app->bindlessTextures ? app->bindlessTextureCapacity : DK_VK_MAX_TEXTURES;
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureTableCount( DK_vkApplication *app )
+  {
+    return app->bindlessTextures ? 1 : DK_VK_MAX_TEXTURE_TABLES;
+  }
+
+  // 0 when the table does not hold the texture, slot 0 is never handed out
+  DK_VULKAN_FUNC uint32_t DK_vkFindTextureSlot( DK_vkRenderer *renderer, uint32_t table, uint32_t index )
+  {
+    for ( uint32_t slot = 1; slot < renderer->textureSlotCounts[table]; slot++ )
+    {
+      if ( renderer->textureSlots[table][slot] == index )
+      {
+        return slot;
+      }
+    }
+
+    return 0;
+  }
+
+  /* Note: without bindless textures every distinct texture drawn in a batch takes a slot in one of the
+   * texture tables, each bound as its own descriptor set. A texture already in a table is drawn from
+   * that table, a new one goes into the last table and a new table is started once its
+   * DK_VK_MAX_TEXTURES slots are taken. Changing tables only closes the open segment, the whole frame
+   * stays in one render pass and is presented once */
+  DK_VULKAN_FUNC int32_t DK_vkAcquireTextureSlot( DK_vkApplication *app, uint32_t index )
+  {
+    if ( app->bindlessTextures || index == 0 )
+    {
+      return index;
+    }
+
+    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( renderer->textureTableCount == 0 )
+    {
+      renderer->textureSlotCounts[0] = 1;
+      renderer->textureTableCount    = 1;
+      renderer->textureTable         = 0;
+    }
+
+    uint32_t table = renderer->textureTable;
+    uint32_t slot  = DK_vkFindTextureSlot( renderer, table, index );
+    for ( uint32_t i = 0; i < renderer->textureTableCount && slot == 0; i++ )
+    {
+      table = i;
+      slot  = DK_vkFindTextureSlot( renderer, table, index );
+    }
+
+    if ( slot == 0 )
+    {
+      table = renderer->textureTableCount - 1;
+      if ( renderer->textureSlotCounts[table] >= DK_VK_MAX_TEXTURES )
+      {
+        table                              = renderer->textureTableCount++;
+        renderer->textureSlotCounts[table] = 1;
+      }
+
+      slot                                = renderer->textureSlotCounts[table]++;
+      renderer->textureSlots[table][slot] = index;
+    }
+
+    if ( table != renderer->textureTable )
+    {
+      DK_vkCloseBatchSegment( renderer );
+      renderer->textureTable = table;
+    }
+
+    return (int32_t)slot;
+  }
+
+  DK_VULKAN_FUNC void DK_vkMarkDescriptorsDirty( DK_vkApplication *app, uint32_t bindingMask )
+  {
+    for ( uint32_t i = 0; i < DK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++ )
+    {
+      for ( uint32_t table = 0; table < DK_VK_MAX_TEXTURE_TABLES; table++ )
+      {
+        app->descriptorDirtyMask[i][table] |= bindingMask;
+      }
+    }
+  }
+
+  /* Note: for a texture whose image, view or sampler changed in place. Bindless sets grow their dirty
+   * element range by the texture index, otherwise the sampler slots of every set holding the index are
+   * marked stale and rewritten the next time the set is updated */
+  DK_VULKAN_FUNC void DK_vkMarkTextureDirty( DK_vkApplication *app, uint32_t index )
+  {
+    for ( uint32_t i = 0; i < DK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++ )
+    {
+      if ( !app->bindlessTextures )
+      {
+        for ( uint32_t table = 0; table < DK_VK_MAX_TEXTURE_TABLES; table++ )
+        {
+          uint32_t *written = app->frameTextureSlots[i][table];
+          for ( uint32_t slot = 0; slot < DK_VK_MAX_TEXTURES; slot++ )
+          {
+            written[slot] = written[slot] == index ? DK_VK_TEXTURE_SLOT_STALE : written[slot];
+          }
+        }
+        continue;
+      }
+
+      if ( app->dirtyTextureEnd[i] <= app->dirtyTextureBegin[i] )
+      {
+        app->dirtyTextureBegin[i] = index;
+        app->dirtyTextureEnd[i]   = index + 1;
+        continue;
+      }
+
+      app->dirtyTextureBegin[i] = index < app->dirtyTextureBegin[i] ? index : app->dirtyTextureBegin[i];
+      app->dirtyTextureEnd[i]   = index + 1 > app->dirtyTextureEnd[i] ? index + 1 : app->dirtyTextureEnd[i];
+    }
+  }
+
+  // must only be called after the fence of the frame has signaled, updates the set of every table in use
+  DK_VULKAN_FUNC void DK_vkUpdateFrameDescriptorSet( DK_vkApplication *app, uint32_t frame )
+  {
+    uint32_t tableCount = app->batchRenderer.textureTableCount;
+    tableCount          = app->bindlessTextures || tableCount == 0 ? 1 : tableCount;
+    for ( uint32_t table = 0; table < tableCount; table++ )
+    {
+      DK_vkUpdateTextureTableSet( app, frame, table );
+    }
+  }
+
+  /* Note: a dirty texture binding rewrites every slot, otherwise only the slots whose texture differs
+   * from what the set already holds or that were marked stale are written, as one contiguous range */
+  DK_VULKAN_FUNC void DK_vkUpdateTextureTableSet( DK_vkApplication *app, uint32_t frame, uint32_t table )
+  {
+    DK_vkRenderer  *renderer  = &app->batchRenderer;
+    VkDescriptorSet set       = app->descriptorSets[frame][table];
+    uint32_t        dirty     = app->descriptorDirtyMask[frame][table];
+    uint32_t       *written   = app->frameTextureSlots[frame][table];
+    uint32_t        slotCount = renderer->textureTableCount > 0 ? renderer->textureSlotCounts[table] : 0;
+
+    if ( dirty & DK_VK_DESCRIPTOR_BINDING_UNIFORM )
+    {
+      VkDescriptorBufferInfo bufferInfo = { 0 };
+      bufferInfo.buffer                 = app->uniformBuffer;
+      bufferInfo.offset                 = 0;
+      bufferInfo.range                  = sizeof( DK_vkUniformBufferObject );
+
+      VkWriteDescriptorSet descriptorWrite = {};
+      descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptorWrite.dstSet               = set;
+      descriptorWrite.dstBinding           = 0;
+      descriptorWrite.dstArrayElement      = 0;
+      descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      descriptorWrite.descriptorCount      = 1;
+      descriptorWrite.pBufferInfo          = &bufferInfo;
+
+      vkUpdateDescriptorSets( app->device, 1, &descriptorWrite, 0, NULL );
+    }
+
+    app->descriptorDirtyMask[frame][table] = 0;
+
+    if ( app->bindlessTextures )
+    {
+      uint32_t begin = app->dirtyTextureBegin[frame];
+      uint32_t end   = app->dirtyTextureEnd[frame] < app->textureCount ? app->dirtyTextureEnd[frame]
+                                                                        : app->textureCount;
+      if ( dirty & DK_VK_DESCRIPTOR_BINDING_TEXTURES )
+      {
+        DK_vkWriteTextureDescriptors( app, set, 0, app->textureCount );
+      }
+      else if ( end > begin )
+      {
+        DK_vkWriteTextureDescriptors( app, set, begin, end - begin );
+      }
+
+      app->dirtyTextureBegin[frame] = 0;
+      app->dirtyTextureEnd[frame]   = 0;
+      return;
+    }
+
+    uint32_t first = DK_VK_MAX_TEXTURES;
+    uint32_t last  = 0;
+    for ( uint32_t slot = 0; slot < DK_VK_MAX_TEXTURES; slot++ )
+    {
+      // a stale slot may point to a released view, it is rewritten even when this batch does not use it
+      bool used  = slot > 0 && slot < slotCount;
+      bool stale = written[slot] == DK_VK_TEXTURE_SLOT_STALE;
+      if ( !used && !stale && !( dirty & DK_VK_DESCRIPTOR_BINDING_TEXTURES ) )
+      {
+        continue;
+      }
+
+      // slots not used by this batch fall back to texture 0
+      uint32_t textureId = used ? renderer->textureSlots[table][slot] : 0;
+      if ( written[slot] == textureId && !( dirty & DK_VK_DESCRIPTOR_BINDING_TEXTURES ) )
+      {
+        continue;
+      }
+
+      written[slot] = textureId;
+      first         = slot < first ? slot : first;
+      last          = slot;
+    }
+
+    if ( first > last )
+    {
+      return;
+    }
+
+    VkDescriptorImageInfo imageInfos[DK_VK_MAX_TEXTURES];
+    for ( uint32_t slot = first; slot <= last; slot++ )
+    {
+      DK_vkTexture *texture                = DK_vkGetResidentTexture( app, written[slot] );
+      imageInfos[slot - first].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      imageInfos[slot - first].imageView   = texture->view;
+      imageInfos[slot - first].sampler     = texture->sampler;
+    }
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet               = set;
+    descriptorWrite.dstBinding           = 1;
+    descriptorWrite.dstArrayElement      = first;
+    descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount      = last - first + 1;
+    descriptorWrite.pImageInfo           = imageInfos;
+
+    vkUpdateDescriptorSets( app->device, 1, &descriptorWrite, 0, NULL );
+  }
+
+  DK_VULKAN_FUNC bool DK_vkHasDeviceExtension( VkPhysicalDevice device, const char *name )
+  {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties( device, NULL, &extensionCount, NULL );
+
+    VkExtensionProperties *availableExtensions =
+        (VkExtensionProperties *)malloc( extensionCount * sizeof( VkExtensionProperties ) );
+    vkEnumerateDeviceExtensionProperties( device, NULL, &extensionCount, availableExtensions );
+
+    bool found = false;
+    for ( uint32_t i = 0; i < extensionCount && !found; i++ )
+    {
+      found = strcmp( name, availableExtensions[i].extensionName ) == 0;
+    }
+
+    free( availableExtensions );
+    return found;
+  }
+
+  DK_VULKAN_FUNC void DK_vkQueryMipmapSupport( DK_vkApplication *app )
+  {
+    app->textureMipmaps = false;
+
+    if ( !enableTextureMipmaps )
+    {
+      return;
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties( app->physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties );
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ( ( formatProperties.optimalTilingFeatures & required ) != required )
+    {
+      fprintf( stderr, "Linear blits not supported for textures, mipmaps disabled\n" );
+      return;
+    }
+
+    app->textureMipmaps = true;
+  }
+
+  DK_VULKAN_FUNC void DK_vkQueryBindlessSupport( DK_vkApplication *app )
+  {
+    app->bindlessTextures        = false;
+    app->bindlessTextureCapacity = 0;
+
+    if ( !enableBindlessTextures )
+    {
+      return;
+    }
+
+    PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 =
+        (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr( app->instance,
+                                                                    "vkGetPhysicalDeviceFeatures2KHR" );
+    PFN_vkGetPhysicalDeviceProperties2KHR getProperties2 =
+        (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr( app->instance,
+                                                                      "vkGetPhysicalDeviceProperties2KHR" );
+
+    if ( getFeatures2 == NULL || getProperties2 == NULL ||
+         !DK_vkHasDeviceExtension( app->physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME ) ||
+         !DK_vkHasDeviceExtension( app->physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME ) )
+    {
+      fprintf( stderr, "Descriptor indexing not available, using %d texture slots\n", DK_VK_MAX_TEXTURES );
+      return;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = { 0 };
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2 features = { 0 };
+    features.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext                     = &indexingFeatures;
+    getFeatures2( app->physicalDevice, &features );
+
+    if ( !indexingFeatures.shaderSampledImageArrayNonUniformIndexing ||
+         !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind ||
+         !indexingFeatures.descriptorBindingPartiallyBound || !indexingFeatures.runtimeDescriptorArray )
+    {
+      fprintf( stderr, "Descriptor indexing features missing, using %d texture slots\n", DK_VK_MAX_TEXTURES );
+      return;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = { 0 };
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2 properties = { 0 };
+    properties.sType                       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext                       = &indexingProperties;
+    getProperties2( app->physicalDevice, &properties );
+
+    uint32_t capacity = DK_VK_MAX_BINDLESS_TEXTURES;
+    if ( indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers < capacity )
+    {
+      capacity = indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers;
+    }
+    if ( indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages < capacity )
+    {
+      capacity = indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages;
+    }
+
+    app->bindlessTextures        = true;
+    app->bindlessTextureCapacity = capacity;
+  }
+
+  // bindless only, writes the given texture slots and leaves the rest of the array untouched
+  DK_VULKAN_FUNC void DK_vkWriteTextureDescriptors( DK_vkApplication *app,
+                                                    VkDescriptorSet   set,
+                                                    uint32_t          first,
+                                                    uint32_t          count )
+  {
+    if ( count == 0 )
+    {
+      return;
+    }
+
+    VkDescriptorImageInfo *imageInfos = malloc( count * sizeof( VkDescriptorImageInfo ) );
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+      DK_vkTexture *texture     = DK_vkGetResidentTexture( app, first + i );
+      imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      imageInfos[i].imageView   = texture->view;
+      imageInfos[i].sampler     = texture->sampler;
+    }
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet               = set;
+    descriptorWrite.dstBinding           = 1;
+    descriptorWrite.dstArrayElement      = first;
+    descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount      = count;
+    descriptorWrite.pImageInfo           = imageInfos;
+
+    vkUpdateDescriptorSets( app->device, 1, &descriptorWrite, 0, NULL );
+
+    free( imageInfos );
+  }
+
+  /* Note: sampler slots are assigned per batch, the active flag no longer selects what is bound and
+   * only forces the texture binding of every frame to be rewritten */
+  DK_VULKAN_FUNC void DK_vkUpdateDescriptorSetsWithActiveTextures( DK_vkApplication *app )
+  {
+    DK_vkMarkDescriptorsDirty( app, DK_VK_DESCRIPTOR_BINDING_TEXTURES );
+  }
+
+  /* Note: a file that is already loaded is returned without decoding it again, a different file with the
+   * same pixels is decoded once to find the match. Either way the existing texture is shared and its
+   * refCount goes up, sampling set with DK_vkSetTextureSampling applies to every holder */
+  DK_VULKAN_FUNC uint32_t DK_vkAddTexture( DK_vkApplication *app, const char *filename )
+  {
+    uint32_t textureId = DK_vkFindTextureBySource( app, filename );
+    if ( textureId != 0 )
+    {
+      return DK_vkRetainTexture( app, textureId );
+    }
+
+    DK_vkImageData image;
+    if ( !DK_vkLoadImage( app->textureCacheDirectory, filename, &image ) )
+    {
+      fprintf( stderr, "Failed to load texture image: %s\n", filename );
+      exit( 1 );
+    }
+
+    textureId = DK_vkAddTextureFromImage( app, &image, filename );
+    DK_vkFreeImage( &image );
+
+    return textureId;
+  }
+
+  // shares a texture with the same content hash or uploads the image as a new one
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureFromImage( DK_vkApplication     *app,
+                                                    const DK_vkImageData *image,
+                                                    const char           *filename )
+  {
+    uint64_t digest;
+    uint64_t hash      = DK_vkHashImage( image, &digest );
+    uint32_t textureId = DK_vkFindTextureByHash( app, hash, digest, image->width, image->height );
+    if ( textureId != 0 )
+    {
+      if ( filename != NULL && DK_vkFindTextureBySource( app, filename ) != textureId )
+      {
+        DK_vkAddTextureAlias( app, textureId, filename );
+      }
+      return DK_vkRetainTexture( app, textureId );
+    }
+
+    if ( !DK_vkHasFreeTextureSlot( app ) )
+    {
+      fprintf( stderr, "Maximum texture count reached\n" );
+      return 0;
+    }
+
+    DK_vkTexture texture = { 0 };
+    DK_vkCreateTextureFromImage( app, image, &texture );
+    texture.pixelHash   = hash;
+    texture.pixelDigest = digest;
+
+    textureId                                = DK_vkRegisterTexture( app, texture );
+    DK_vkGetTexture( app, textureId )->source = DK_vkCopyString( filename );
+
+    return textureId;
+  }
+
+  DK_VULKAN_FUNC void *DK_vkDecodeWorker( void *userData )
+  {
+    DK_vkDecodeBatch *batch = (DK_vkDecodeBatch *)userData;
+
+    pthread_mutex_lock( &batch->mutex );
+    while ( batch->next < batch->count )
+    {
+      // decoded images wait in memory until they are uploaded, keep only a few of them ahead
+      if ( batch->next >= batch->consumed + batch->lookahead )
+      {
+        pthread_cond_wait( &batch->space, &batch->mutex );
+        continue;
+      }
+
+      uint32_t index       = batch->next++;
+      batch->states[index] = DK_VK_TEXTURE_JOB_DECODING;
+      pthread_mutex_unlock( &batch->mutex );
+
+      bool loaded = DK_vkLoadImage( batch->cacheDirectory, batch->paths[index], &batch->images[index] );
+
+      pthread_mutex_lock( &batch->mutex );
+      batch->states[index] = loaded ? DK_VK_TEXTURE_JOB_DECODED : DK_VK_TEXTURE_JOB_FAILED;
+      pthread_cond_broadcast( &batch->decoded );
+    }
+    pthread_mutex_unlock( &batch->mutex );
+
+    return NULL;
+  }
+
+  /* Note: decodes on one thread per core while the calling thread uploads the images in order as they
+   * become ready, the copies are submitted every DK_VK_STAGING_CHUNK_SIZE bytes of staging. Files that are
+   * already loaded are not decoded and duplicates share one texture like with DK_vkAddTexture. outIds[i]
+   * is 0 for an image that failed to load, the number of non zero ids is returned */
+  DK_VULKAN_FUNC uint32_t
+  DK_vkAddTextures( DK_vkApplication *app, const char **paths, uint32_t count, uint32_t *outIds )
+  {
+    uint32_t     added       = 0;
+    uint32_t     decodeCount = 0;
+    uint32_t    *indices     = (uint32_t *)malloc( count * sizeof( uint32_t ) );
+    const char **decodePaths = (const char **)malloc( count * sizeof( const char * ) );
+
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+      uint32_t index = DK_vkFindTextureBySource( app, paths[i] );
+      outIds[i]      = index != 0 ? DK_vkRetainTexture( app, index ) : 0;
+      if ( outIds[i] != 0 )
+      {
+        added++;
+        continue;
+      }
+
+      indices[decodeCount]       = i;
+      decodePaths[decodeCount++] = paths[i];
+    }
+
+    if ( decodeCount == 0 )
+    {
+      free( decodePaths );
+      free( indices );
+      return added;
+    }
+
+    DK_vkDecodeBatch batch = { 0 };
+    batch.cacheDirectory   = app->textureCacheDirectory;
+    batch.paths            = decodePaths;
+    batch.count            = decodeCount;
+    batch.images           = (DK_vkImageData *)calloc( decodeCount, sizeof( DK_vkImageData ) );
+    batch.states           = (DK_vkTextureJobState *)calloc( decodeCount, sizeof( DK_vkTextureJobState ) );
+    pthread_mutex_init( &batch.mutex, NULL );
+    pthread_cond_init( &batch.decoded, NULL );
+    pthread_cond_init( &batch.space, NULL );
+
+    long     cores       = sysconf( _SC_NPROCESSORS_ONLN );
+    uint32_t threadCount = cores > 0 ? (uint32_t)cores : 1;
+    threadCount          = threadCount < DK_VK_MAX_DECODE_THREADS ? threadCount : DK_VK_MAX_DECODE_THREADS;
+    threadCount          = threadCount < decodeCount ? threadCount : decodeCount;
+    batch.lookahead      = threadCount * 2;
+
+    pthread_t threads[DK_VK_MAX_DECODE_THREADS];
+    for ( uint32_t i = 0; i < threadCount; i++ )
+    {
+      if ( pthread_create( &threads[i], NULL, DK_vkDecodeWorker, &batch ) != 0 )
+      {
+        fprintf( stderr, "Failed to create texture decode thread\n" );
+        exit( 1 );
+      }
+    }
+
+    DK_vkBeginUploads( app );
+
+    VkDeviceSize staged = 0;
+    for ( uint32_t j = 0; j < decodeCount; j++ )
+    {
+      pthread_mutex_lock( &batch.mutex );
+      while ( batch.states[j] == DK_VK_TEXTURE_JOB_QUEUED || batch.states[j] == DK_VK_TEXTURE_JOB_DECODING )
+      {
+        pthread_cond_wait( &batch.decoded, &batch.mutex );
+      }
+      DK_vkTextureJobState state = batch.states[j];
+      batch.consumed             = j + 1;
+      pthread_cond_broadcast( &batch.space );
+      pthread_mutex_unlock( &batch.mutex );
+
+      // submit once a chunk worth of staging is used so the belt can hand it out again
+      if ( staged >= DK_VK_STAGING_CHUNK_SIZE )
+      {
+        DK_vkEndUploads( app, true );
+        DK_vkBeginUploads( app );
+        staged = 0;
+      }
+
+      if ( state == DK_VK_TEXTURE_JOB_FAILED )
+      {
+        fprintf( stderr, "Failed to load texture image: %s\n", decodePaths[j] );
+        continue;
+      }
+
+      // a path listed twice is found by source once its first copy is registered
+      uint32_t i     = indices[j];
+      uint32_t index = DK_vkFindTextureBySource( app, decodePaths[j] );
+      if ( index != 0 )
+      {
+        outIds[i] = DK_vkRetainTexture( app, index );
+      }
+      else
+      {
+        outIds[i] = DK_vkAddTextureFromImage( app, &batch.images[j], decodePaths[j] );
+        staged   += (VkDeviceSize)batch.images[j].width * batch.images[j].height * 4;
+      }
+      DK_vkFreeImage( &batch.images[j] );
+
+      added += outIds[i] != 0;
+    }
+
+    DK_vkEndUploads( app, true );
+
+    for ( uint32_t i = 0; i < threadCount; i++ )
+    {
+      pthread_join( threads[i], NULL );
+    }
+
+    pthread_cond_destroy( &batch.space );
+    pthread_cond_destroy( &batch.decoded );
+    pthread_mutex_destroy( &batch.mutex );
+    free( batch.states );
+    free( batch.images );
+    free( decodePaths );
+    free( indices );
+
+    return added;
+  }
+
+  /* Note: every image becomes one layer of a single array texture, so a sprite set of equally sized
+   * frames takes one sampler slot and the layer is picked per vertex ( DK_vkDrawTextureLayer ). All images
+   * must have the size of the first one. The texture has no source file, the residency manager may drop
+   * its mip levels but never evicts it */
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureArray( DK_vkApplication *app, const char **paths, uint32_t count )
+  {
+    if ( !DK_vkHasFreeTextureSlot( app ) )
+    {
+      fprintf( stderr, "Maximum texture count reached\n" );
+      return 0;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( app->physicalDevice, &properties );
+
+    if ( count == 0 || count > DK_VK_MAX_TEXTURE_LAYERS || count > properties.limits.maxImageArrayLayers )
+    {
+      fprintf( stderr, "Unsupported texture array layer count: %u\n", count );
+      return 0;
+    }
+
+    DK_vkImageData *images = (DK_vkImageData *)calloc( count, sizeof( DK_vkImageData ) );
+    uint32_t        loaded = 0;
+    for ( ; loaded < count; loaded++ )
+    {
+      if ( !DK_vkLoadImage( app->textureCacheDirectory, paths[loaded], &images[loaded] ) )
+      {
+        fprintf( stderr, "Failed to load texture image: %s\n", paths[loaded] );
+        break;
+      }
+
+      if ( images[loaded].width != images[0].width || images[loaded].height != images[0].height )
+      {
+        fprintf( stderr, "Texture array layer has a different size: %s\n", paths[loaded] );
+        DK_vkFreeImage( &images[loaded] );
+        break;
+      }
+    }
+
+    if ( loaded < count )
+    {
+      for ( uint32_t i = 0; i < loaded; i++ )
+      {
+        DK_vkFreeImage( &images[i] );
+      }
+      free( images );
+      return 0;
+    }
+
+    uint32_t     width     = (uint32_t)images[0].width;
+    uint32_t     height    = (uint32_t)images[0].height;
+    uint32_t     mipLevels = DK_vkGetMipLevelCount( app, width, height );
+    VkDeviceSize layerSize = (VkDeviceSize)width * height * 4;
+
+    DK_vkTexture texture = { 0 };
+
+    DK_vkBeginUploads( app );
+
+    DK_vkCreateImageEx( app,
+                        width,
+                        height,
+                        mipLevels,
+                        count,
+                        VK_FORMAT_R8G8B8A8_SRGB,
+                        VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                            VK_IMAGE_USAGE_SAMPLED_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        &texture.image,
+                        &texture.memory );
+
+    DK_vkTransitionImageLayout( app,
+                                texture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+      DK_vkStagingAllocation staging = DK_vkStageData( app, images[i].pixels, layerSize );
+      DK_vkCopyBufferToImageLayer( app, staging.buffer, staging.offset, texture.image, i, width, height );
+    }
+
+    if ( mipLevels > 1 )
+    {
+      DK_vkGenerateMipmaps( app, texture.image, width, height, mipLevels, count );
+    }
+    else
+    {
+      DK_vkTransitionImageLayout( app,
+                                  texture.image,
+                                  VK_FORMAT_R8G8B8A8_SRGB,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+    }
+
+    DK_vkEndUploads( app, true );
+
+    DK_vkCreateTextureImageView( app, texture.image, &texture.view );
+    DK_vkCreateTextureSampler( app, &texture.sampler );
+
+    texture.width      = (int32_t)width;
+    texture.height     = (int32_t)height;
+    texture.channels   = images[0].channels;
+    texture.format     = VK_FORMAT_R8G8B8A8_SRGB;
+    texture.mipLevels  = mipLevels;
+    texture.layerCount = count;
+    texture.residency  = DK_VK_TEXTURE_RESIDENT;
+
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+      DK_vkFreeImage( &images[i] );
+    }
+    free( images );
+
+    return DK_vkRegisterTexture( app, texture );
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureKTX2( DK_vkApplication *app, const char *filename )
+  {
+    if ( !DK_vkHasFreeTextureSlot( app ) )
+    {
+      fprintf( stderr, "Maximum texture count reached\n" );
+      return 0;
+    }
+
+    DK_vkTexture texture = { 0 };
+    if ( !DK_vkLoadTextureKTX2( app, filename, &texture ) )
+    {
+      return 0;
+    }
+
+    return DK_vkRegisterTexture( app, texture );
+  }
+
+  /* Note: the levels are uploaded as stored, no decode and no mip generation. Supercompressed ( basis,
+   * zstd ), array, cube map and 3d containers are rejected, as are formats the device cannot sample */
+  DK_VULKAN_FUNC bool
+  DK_vkLoadTextureKTX2( DK_vkApplication *app, const char *filename, DK_vkTexture *texture )
+  {
+    static const uint8_t identifier[12] = {
+      0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n',
+    };
+
+    size_t         fileSize;
+    unsigned char *file = DK_vkTryReadFile( filename, &fileSize );
+    if ( file == NULL )
+    {
+      return false;
+    }
+
+    DK_vkKTX2Header header = { 0 };
+    if ( fileSize >= sizeof( DK_vkKTX2Header ) )
+    {
+      memcpy( &header, file, sizeof( DK_vkKTX2Header ) );
+    }
+
+    if ( memcmp( header.identifier, identifier, sizeof( identifier ) ) != 0 )
+    {
+      fprintf( stderr, "Not a KTX2 file: %s\n", filename );
+      free( file );
+      return false;
+    }
+
+    // a full mip chain has floor( log2( max( width, height ) ) ) + 1 levels
+    uint32_t maxLevels = 1;
+    uint32_t extent    = header.pixelWidth > header.pixelHeight ? header.pixelWidth : header.pixelHeight;
+    for ( ; extent > 1; extent >>= 1 )
+    {
+      maxLevels++;
+    }
+
+    uint32_t levelCount = header.levelCount > 0 ? header.levelCount : 1;
+    if ( header.supercompressionScheme != 0 || header.pixelWidth == 0 || header.pixelHeight == 0 ||
+         header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || levelCount > maxLevels ||
+         sizeof( DK_vkKTX2Header ) + levelCount * sizeof( DK_vkKTX2Level ) > fileSize )
+    {
+      fprintf( stderr, "Unsupported KTX2 layout: %s\n", filename );
+      free( file );
+      return false;
+    }
+
+    VkFormat format = (VkFormat)header.vkFormat;
+    if ( !DK_vkIsTextureFormatSupported( app, format ) )
+    {
+      fprintf( stderr, "Texture format %u not supported by the device: %s\n", header.vkFormat, filename );
+      free( file );
+      return false;
+    }
+
+    uint32_t blockWidth, blockHeight, blockBytes;
+    if ( !DK_vkGetFormatBlockSize( format, &blockWidth, &blockHeight, &blockBytes ) )
+    {
+      fprintf( stderr, "Unsupported KTX2 texture format %u: %s\n", header.vkFormat, filename );
+      free( file );
+      return false;
+    }
+
+    // levels are stored smallest first, stage the whole span at once and keep their relative offsets
+    DK_vkKTX2Level *levels = (DK_vkKTX2Level *)malloc( levelCount * sizeof( DK_vkKTX2Level ) );
+    memcpy( levels, file + sizeof( DK_vkKTX2Header ), levelCount * sizeof( DK_vkKTX2Level ) );
+
+    uint64_t spanStart = UINT64_MAX;
+    uint64_t spanEnd   = 0;
+    for ( uint32_t i = 0; i < levelCount; i++ )
+    {
+      // the copy of a level reads every block of its extent, a shorter level would read past the span
+      uint64_t levelWidth  = ( header.pixelWidth >> i ) > 0 ? header.pixelWidth >> i : 1;
+      uint64_t levelHeight = ( header.pixelHeight >> i ) > 0 ? header.pixelHeight >> i : 1;
+      uint64_t levelSize   = ( ( levelWidth + blockWidth - 1 ) / blockWidth ) *
+                           ( ( levelHeight + blockHeight - 1 ) / blockHeight ) * blockBytes;
+
+      uint64_t end = levels[i].byteOffset + levels[i].byteLength;
+      if ( levels[i].byteLength < levelSize || end < levels[i].byteOffset || end > fileSize )
+      {
+        fprintf( stderr, "Corrupt KTX2 level index: %s\n", filename );
+        free( levels );
+        free( file );
+        return false;
+      }
+
+      spanStart = levels[i].byteOffset < spanStart ? levels[i].byteOffset : spanStart;
+      spanEnd   = end > spanEnd ? end : spanEnd;
+    }
+
+    DK_vkStagingAllocation staging = DK_vkStageData( app, file + spanStart, spanEnd - spanStart );
+    free( file );
+
+    DK_vkCreateImage( app,
+                      header.pixelWidth,
+                      header.pixelHeight,
+                      levelCount,
+                      format,
+                      VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                          VK_IMAGE_USAGE_SAMPLED_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &texture->image,
+                      &texture->memory );
+
+    DK_vkTransitionImageLayout(
+        app, texture->image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+
+    VkBufferImageCopy *regions = (VkBufferImageCopy *)calloc( levelCount, sizeof( VkBufferImageCopy ) );
+    for ( uint32_t i = 0; i < levelCount; i++ )
+    {
+      uint32_t levelWidth  = header.pixelWidth >> i;
+      uint32_t levelHeight = header.pixelHeight >> i;
+
+      regions[i].bufferOffset                    = staging.offset + ( levels[i].byteOffset - spanStart );
+      regions[i].imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      regions[i].imageSubresource.mipLevel       = i;
+      regions[i].imageSubresource.baseArrayLayer = 0;
+      regions[i].imageSubresource.layerCount     = 1;
+      regions[i].imageExtent.width               = levelWidth > 0 ? levelWidth : 1;
+      regions[i].imageExtent.height              = levelHeight > 0 ? levelHeight : 1;
+      regions[i].imageExtent.depth               = 1;
+    }
+
+    VkCommandBuffer commandBuffer = DK_vkBeginSingleTimeCommands( app );
+    vkCmdCopyBufferToImage( commandBuffer,
+                            staging.buffer,
+                            texture->image,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            levelCount,
+                            regions );
+    DK_vkEndSingleTimeCommands( app, commandBuffer );
+
+    free( regions );
+    free( levels );
+
+    DK_vkTransitionImageLayout( app,
+                                texture->image,
+                                format,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+    DK_vkCreateTextureImageViewEx( app, texture->image, format, &texture->view );
+    DK_vkCreateTextureSampler( app, &texture->sampler );
+
+    texture->width     = (int32_t)header.pixelWidth;
+    texture->height    = (int32_t)header.pixelHeight;
+    texture->channels  = 4;
+    texture->format    = format;
+    texture->mipLevels = levelCount;
+
+    return true;
+  }
+
+  // block compressed formats are only usable when their family feature was enabled on the device
+  DK_VULKAN_FUNC uint32_t DK_vkGetFormatCompression( VkFormat format )
+  {
+    if ( format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK )
+    {
+      return DK_VK_TEXTURE_COMPRESSION_BC;
+    }
+    if ( format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK )
+    {
+      return DK_VK_TEXTURE_COMPRESSION_ETC2;
+    }
+    if ( format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK )
+    {
+      return DK_VK_TEXTURE_COMPRESSION_ASTC;
+    }
+
+    return 0;
+  }
+
+  // texel block extent and size of the formats KTX2 textures are accepted in, false for any other format
+  DK_VULKAN_FUNC bool DK_vkGetFormatBlockSize( VkFormat  format,
+                                               uint32_t *blockWidth,
+                                               uint32_t *blockHeight,
+                                               uint32_t *blockBytes )
+  {
+    *blockWidth  = 4;
+    *blockHeight = 4;
+
+    switch ( format )
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+      *blockWidth  = 1;
+      *blockHeight = 1;
+      *blockBytes  = 1;
+      return true;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+      *blockWidth  = 1;
+      *blockHeight = 1;
+      *blockBytes  = 2;
+      return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      *blockWidth  = 1;
+      *blockHeight = 1;
+      *blockBytes  = 4;
+      return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+      *blockWidth  = 1;
+      *blockHeight = 1;
+      *blockBytes  = 8;
+      return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      *blockWidth  = 1;
+      *blockHeight = 1;
+      *blockBytes  = 16;
+      return true;
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+      *blockBytes = 8;
+      return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+      *blockBytes = 16;
+      return true;
+    default:
+      break;
+    }
+
+    // every ASTC block is 16 bytes, only its extent differs
+    static const struct
+    {
+      VkFormat unorm;
+      VkFormat srgb;
+      uint32_t width;
+      uint32_t height;
+    } astc[] = {
+      { VK_FORMAT_ASTC_5x4_UNORM_BLOCK, VK_FORMAT_ASTC_5x4_SRGB_BLOCK, 5, 4 },
+      { VK_FORMAT_ASTC_5x5_UNORM_BLOCK, VK_FORMAT_ASTC_5x5_SRGB_BLOCK, 5, 5 },
+      { VK_FORMAT_ASTC_6x5_UNORM_BLOCK, VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 6, 5 },
+      { VK_FORMAT_ASTC_6x6_UNORM_BLOCK, VK_FORMAT_ASTC_6x6_SRGB_BLOCK, 6, 6 },
+      { VK_FORMAT_ASTC_8x5_UNORM_BLOCK, VK_FORMAT_ASTC_8x5_SRGB_BLOCK, 8, 5 },
+      { VK_FORMAT_ASTC_8x6_UNORM_BLOCK, VK_FORMAT_ASTC_8x6_SRGB_BLOCK, 8, 6 },
+      { VK_FORMAT_ASTC_8x8_UNORM_BLOCK, VK_FORMAT_ASTC_8x8_SRGB_BLOCK, 8, 8 },
+      { VK_FORMAT_ASTC_10x5_UNORM_BLOCK, VK_FORMAT_ASTC_10x5_SRGB_BLOCK, 10, 5 },
+      { VK_FORMAT_ASTC_10x6_UNORM_BLOCK, VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 10, 6 },
+      { VK_FORMAT_ASTC_10x8_UNORM_BLOCK, VK_FORMAT_ASTC_10x8_SRGB_BLOCK, 10, 8 },
+      { VK_FORMAT_ASTC_10x10_UNORM_BLOCK, VK_FORMAT_ASTC_10x10_SRGB_BLOCK, 10, 10 },
+      { VK_FORMAT_ASTC_12x10_UNORM_BLOCK, VK_FORMAT_ASTC_12x10_SRGB_BLOCK, 12, 10 },
+      { VK_FORMAT_ASTC_12x12_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 12, 12 },
+    };
+
+    for ( uint32_t i = 0; i < sizeof( astc ) / sizeof( astc[0] ); i++ )
+    {
+      if ( format == astc[i].unorm || format == astc[i].srgb )
+      {
+        *blockWidth  = astc[i].width;
+        *blockHeight = astc[i].height;
+        *blockBytes  = 16;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkIsTextureFormatSupported( DK_vkApplication *app, VkFormat format )
+  {
+    uint32_t compression = DK_vkGetFormatCompression( format );
+    if ( compression != 0 && ( app->textureCompression & compression ) == 0 )
+    {
+      return false;
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties( app->physicalDevice, format, &formatProperties );
+
+    return ( formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) != 0;
+  }
+
+  /* Note: takes the most recently freed slot before appending one. The generation of the slot is bumped
+   * so handles to the texture that used the slot before stay invalid, it skips 0 so no handle is 0 */
+  DK_VULKAN_FUNC uint32_t DK_vkRegisterTexture( DK_vkApplication *app, DK_vkTexture texture )
+  {
+    if ( !DK_vkHasFreeTextureSlot( app ) )
+    {
+      fprintf( stderr, "Maximum texture count reached\n" );
+      return 0;
+    }
+
+    uint32_t index      = app->freeTextureSlot;
+    uint32_t generation = 0;
+    bool     reused     = index != 0;
+    if ( reused )
+    {
+      generation           = app->textures[index].generation;
+      app->freeTextureSlot = app->textures[index].nextFree;
+    }
+    else
+    {
+      index = app->textureCount++;
+    }
+
+    generation = ( generation + 1 ) & DK_VK_TEXTURE_GENERATION_MASK;
+    generation = generation != 0 ? generation : 1;
+
+    texture.generation    = generation;
+    texture.nextFree      = 0;
+    texture.samplerId     = DK_vkMakeTextureHandle( index, generation );
+    texture.lastUsedFrame = app->residency.frame;
+    texture.refCount      = 1;
+    app->textures[index]  = texture;
+
+    // fonts, atlas pages and streaming placeholders arrive with isActive already set
+    if ( texture.isActive )
+    {
+      app->activeTextureCount++;
+    }
+
+    // the frame sets cache sampler slots by index, a reused index has to be written again
+    if ( app->bindlessTextures || reused )
+    {
+      DK_vkMarkTextureDirty( app, index );
+    }
+
+    return texture.samplerId;
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkMakeTextureHandle( uint32_t index, uint32_t generation )
+  {
+    return generation << DK_VK_TEXTURE_INDEX_BITS | index;
+  }
+
+  /* Note: returns the slot of a live texture, 0 for handle 0 and for handles whose texture was removed.
+   * Slot 0 holds the dummy texture, so a stale handle draws untextured instead of reading another image */
+  DK_VULKAN_FUNC uint32_t DK_vkGetTextureIndex( DK_vkApplication *app, uint32_t textureId )
+  {
+    uint32_t index = textureId & DK_VK_TEXTURE_INDEX_MASK;
+    if ( index == 0 || index >= app->textureCount )
+    {
+      return 0;
+    }
+
+    DK_vkTexture *texture = &app->textures[index];
+    return texture->refCount > 0 && texture->generation == textureId >> DK_VK_TEXTURE_INDEX_BITS ? index : 0;
+  }
+
+  DK_VULKAN_FUNC DK_vkTexture *DK_vkGetTexture( DK_vkApplication *app, uint32_t textureId )
+  {
+    uint32_t index = DK_vkGetTextureIndex( app, textureId );
+    return index != 0 ? &app->textures[index] : NULL;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkHasFreeTextureSlot( DK_vkApplication *app )
+  {
+    return app->freeTextureSlot != 0 || app->textureCount < app->maxTextures;
+  }
+
+  /* Note: drops one reference, the last one frees the slot for the next texture. Frames in flight may
+   * still sample the image, it is destroyed by DK_vkBeginBatch once the queue is idle. Draws of the
+   * texture already recorded in the open batch fall back to texture 0 unless the slot is reused before
+   * the batch is flushed, so remove textures between batches */
+  DK_VULKAN_FUNC void DK_vkRemoveTexture( DK_vkApplication *app, uint32_t textureId )
+  {
+    uint32_t index = DK_vkGetTextureIndex( app, textureId );
+    if ( index == 0 )
+    {
+      fprintf( stderr, "Invalid texture id %u\n", textureId );
+      return;
+    }
+
+    DK_vkTexture *texture = &app->textures[index];
+    if ( --texture->refCount > 0 )
+    {
+      return;
+    }
+
+    // the slot is marked dirty below, leaving the active flag needs no descriptor rewrite of its own
+    if ( texture->isActive && app->activeTextureCount > 0 )
+    {
+      app->activeTextureCount--;
+    }
+
+    if ( texture->image != VK_NULL_HANDLE )
+    {
+      if ( app->retiredTextureCount == app->retiredTextureCapacity )
+      {
+        app->retiredTextureCapacity = app->retiredTextureCapacity ? app->retiredTextureCapacity * 2 : 16;
+        app->retiredTextures        = (DK_vkRetiredTexture *)realloc(
+            app->retiredTextures, app->retiredTextureCapacity * sizeof( DK_vkRetiredTexture ) );
+      }
+
+      DK_vkRetiredTexture *retired = &app->retiredTextures[app->retiredTextureCount++];
+      retired->image               = texture->image;
+      retired->view                = texture->view;
+      retired->memory              = texture->memory;
+    }
+
+    // queued region updates would otherwise land in whatever texture reuses the slot
+    DK_vkTextureUpdateRing *ring = &app->textureUpdates;
+    uint32_t                kept = 0;
+    for ( uint32_t i = 0; i < ring->updateCount; i++ )
+    {
+      if ( ring->updates[i].textureId != index )
+      {
+        ring->updates[kept++] = ring->updates[i];
+      }
+    }
+    ring->updateCount = kept;
+
+    // a streaming job still in flight finds the handle stale and drops its image
+    free( texture->source );
+    DK_vkRemoveTextureAliases( app, index );
+
+    uint32_t generation  = texture->generation;
+    *texture             = (DK_vkTexture){ 0 };
+    texture->generation  = generation;
+    texture->nextFree    = app->freeTextureSlot;
+    app->freeTextureSlot = index;
+
+    if ( app->currentTexture == texture )
+    {
+      app->currentTexture = &app->textures[0];
+    }
+    if ( app->batchRenderer.currentTexture == texture )
+    {
+      app->batchRenderer.currentTexture = &app->textures[0];
+    }
+
+    DK_vkMarkTextureDirty( app, index );
+  }
+
+  // the queue must be idle, copies deferred into an open upload batch may still target a retired image
+  DK_VULKAN_FUNC void DK_vkReleaseRetiredTextures( DK_vkApplication *app )
+  {
+    if ( app->uploads.depth > 0 )
+    {
+      return;
+    }
+
+    for ( uint32_t i = 0; i < app->retiredTextureCount; i++ )
+    {
+      DK_vkRetiredTexture *retired = &app->retiredTextures[i];
+      vkDestroyImageView( app->device, retired->view, NULL );
+      vkDestroyImage( app->device, retired->image, NULL );
+      DK_vkFreeMemory( app, &retired->memory );
+    }
+
+    app->retiredTextureCount = 0;
+  }
+
+  // width and height are part of the hash so identical bytes in a different shape never match
+  DK_VULKAN_FUNC uint64_t DK_vkHashImage( const DK_vkImageData *image, uint64_t *digest )
+  {
+    size_t   size = (size_t)image->width * image->height * 4;
+    uint64_t hash = DK_vkHashBytes( &image->width, sizeof( image->width ), DK_VK_HASH_SEED );
+    hash          = DK_vkHashBytes( &image->height, sizeof( image->height ), hash );
+    *digest       = DK_vkHashWords( image->pixels, size, DK_VK_HASH_SEED );
+    return DK_vkHashBytes( image->pixels, size, hash );
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkFindTextureBySource( DK_vkApplication *app, const char *filename )
+  {
+    for ( uint32_t i = 1; i < app->textureCount; i++ )
+    {
+      DK_vkTexture *texture = &app->textures[i];
+      if ( texture->refCount > 0 && texture->source != NULL && strcmp( texture->source, filename ) == 0 )
+      {
+        return i;
+      }
+    }
+
+    for ( uint32_t i = 0; i < app->textureAliasCount; i++ )
+    {
+      if ( strcmp( app->textureAliases[i].path, filename ) == 0 )
+      {
+        return app->textureAliases[i].index;
+      }
+    }
+
+    return 0;
+  }
+
+  DK_VULKAN_FUNC void DK_vkAddTextureAlias( DK_vkApplication *app, uint32_t index, const char *filename )
+  {
+    if ( app->textureAliasCount == app->textureAliasCapacity )
+    {
+      app->textureAliasCapacity = app->textureAliasCapacity ? app->textureAliasCapacity * 2 : 16;
+      app->textureAliases       = (DK_vkTextureAlias *)realloc(
+          app->textureAliases, app->textureAliasCapacity * sizeof( DK_vkTextureAlias ) );
+    }
+
+    DK_vkTextureAlias *alias = &app->textureAliases[app->textureAliasCount++];
+    alias->path              = DK_vkCopyString( filename );
+    alias->index             = index;
+  }
+
+  // the slot is about to be reused, its aliases must not resolve to the next texture
+  DK_VULKAN_FUNC void DK_vkRemoveTextureAliases( DK_vkApplication *app, uint32_t index )
+  {
+    uint32_t kept = 0;
+    for ( uint32_t i = 0; i < app->textureAliasCount; i++ )
+    {
+      if ( app->textureAliases[i].index == index )
+      {
+        free( app->textureAliases[i].path );
+        continue;
+      }
+      app->textureAliases[kept++] = app->textureAliases[i];
+    }
+    app->textureAliasCount = kept;
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkFindTextureByHash(
+      DK_vkApplication *app, uint64_t hash, uint64_t digest, int32_t width, int32_t height )
+  {
+    for ( uint32_t i = 1; i < app->textureCount; i++ )
+    {
+      DK_vkTexture *texture = &app->textures[i];
+      if ( texture->refCount > 0 && texture->pixelHash == hash && texture->pixelDigest == digest &&
+           texture->width == width && texture->height == height )
+      {
+        return i;
+      }
+    }
+
+    return 0;
+  }
+
+  // takes the index returned by DK_vkFindTextureBySource or DK_vkFindTextureByHash, returns the handle
+  DK_VULKAN_FUNC uint32_t DK_vkRetainTexture( DK_vkApplication *app, uint32_t index )
+  {
+    app->textures[index].refCount++;
+    return app->textures[index].samplerId;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkIsTextureResident( DK_vkApplication *app, uint32_t textureId )
+  {
+    DK_vkTexture *texture = DK_vkGetTexture( app, textureId );
+    return texture != NULL && texture->view != VK_NULL_HANDLE;
+  }
+
+  /* Note: takes a slot index as stored in the sampler slots, not a handle. Textures that are still
+   * streaming in and removed slots are drawn with texture 0 */
+  DK_VULKAN_FUNC DK_vkTexture *DK_vkGetResidentTexture( DK_vkApplication *app, uint32_t index )
+  {
+    bool resident = index < app->textureCount && app->textures[index].view != VK_NULL_HANDLE;
+    return resident ? &app->textures[index] : &app->textures[0];
+  }
+
+  DK_VULKAN_FUNC void *DK_vkTextureWorker( void *userData )
+  {
+    DK_vkApplication     *app      = (DK_vkApplication *)userData;
+    DK_vkTextureStreamer *streamer = &app->textureStreamer;
+
+    pthread_mutex_lock( &streamer->mutex );
+    while ( streamer->running )
+    {
+      DK_vkTextureJob *job = NULL;
+      for ( uint32_t i = 0; i < streamer->jobCount && !job; i++ )
+      {
+        if ( streamer->jobs[i].state == DK_VK_TEXTURE_JOB_QUEUED )
+        {
+          job = &streamer->jobs[i];
+        }
+      }
+
+      if ( !job )
+      {
+        pthread_cond_wait( &streamer->wake, &streamer->mutex );
+        continue;
+      }
+
+      job->state         = DK_VK_TEXTURE_JOB_DECODING;
+      uint32_t textureId = job->textureId;
+      char    *filename  = job->filename;
+      pthread_mutex_unlock( &streamer->mutex );
+
+      DK_vkImageData image  = { 0 };
+      bool           loaded = DK_vkLoadImage( app->textureCacheDirectory, filename, &image );
+
+      pthread_mutex_lock( &streamer->mutex );
+      for ( uint32_t i = 0; i < streamer->jobCount; i++ )
+      {
+        if ( streamer->jobs[i].textureId == textureId )
+        {
+          streamer->jobs[i].image = image;
+          streamer->jobs[i].state = loaded ? DK_VK_TEXTURE_JOB_DECODED : DK_VK_TEXTURE_JOB_FAILED;
+          break;
+        }
+      }
+    }
+    pthread_mutex_unlock( &streamer->mutex );
+
+    return NULL;
+  }
+
+  DK_VULKAN_FUNC void DK_vkStartTextureStreaming( DK_vkApplication *app )
+  {
+    DK_vkTextureStreamer *streamer = &app->textureStreamer;
+    if ( streamer->running )
+    {
+      return;
+    }
+
+    pthread_mutex_init( &streamer->mutex, NULL );
+    pthread_cond_init( &streamer->wake, NULL );
+    streamer->running = true;
+
+    for ( uint32_t i = 0; i < DK_VK_TEXTURE_WORKER_COUNT; i++ )
+    {
+      if ( pthread_create( &streamer->workers[i], NULL, DK_vkTextureWorker, app ) != 0 )
+      {
+        fprintf( stderr, "Failed to create texture worker thread\n" );
+        exit( 1 );
+      }
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkStopTextureStreaming( DK_vkApplication *app )
+  {
+    DK_vkTextureStreamer *streamer = &app->textureStreamer;
+    if ( !streamer->running )
+    {
+      return;
+    }
+
+    pthread_mutex_lock( &streamer->mutex );
+    streamer->running = false;
+    pthread_cond_broadcast( &streamer->wake );
+    pthread_mutex_unlock( &streamer->mutex );
+
+    for ( uint32_t i = 0; i < DK_VK_TEXTURE_WORKER_COUNT; i++ )
+    {
+      pthread_join( streamer->workers[i], NULL );
+    }
+
+    for ( uint32_t i = 0; i < streamer->jobCount; i++ )
+    {
+      DK_vkFreeImage( &streamer->jobs[i].image );
+      free( streamer->jobs[i].filename );
+    }
+
+    free( streamer->jobs );
+    streamer->jobs        = NULL;
+    streamer->jobCount    = 0;
+    streamer->jobCapacity = 0;
+
+    pthread_cond_destroy( &streamer->wake );
+    pthread_mutex_destroy( &streamer->mutex );
+  }
+
+  /* Note: the id is valid right away, the size comes from the image header so layouts do not jump
+   * once the real image is resident */
+  DK_VULKAN_FUNC uint32_t DK_vkAddTextureAsync( DK_vkApplication *app, const char *filename )
+  {
+    uint32_t loadedId = DK_vkFindTextureBySource( app, filename );
+    if ( loadedId != 0 )
+    {
+      return DK_vkRetainTexture( app, loadedId );
+    }
+
+    int32_t width, height, channels;
+    if ( !DK_vkReadImageInfo( filename, &width, &height, &channels ) )
+    {
+      fprintf( stderr, "Failed to load texture image: %s\n", filename );
+      return 0;
+    }
+
+    DK_vkTexture placeholder = { 0 };
+    placeholder.width        = width;
+    placeholder.height       = height;
+    placeholder.channels     = channels;
+    placeholder.isActive     = true;
+    placeholder.residency    = DK_VK_TEXTURE_STREAMING;
+
+    uint32_t textureId = DK_vkRegisterTexture( app, placeholder );
+    if ( textureId == 0 )
+    {
+      return 0;
+    }
+
+    DK_vkGetTexture( app, textureId )->source = DK_vkCopyString( filename );
+    DK_vkQueueTextureJob( app, textureId, filename );
+
+    return textureId;
+  }
+
+  DK_VULKAN_FUNC void DK_vkQueueTextureJob( DK_vkApplication *app, uint32_t textureId, const char *filename )
+  {
+    DK_vkStartTextureStreaming( app );
+
+    DK_vkTextureStreamer *streamer = &app->textureStreamer;
+    pthread_mutex_lock( &streamer->mutex );
+
+    if ( streamer->jobCount == streamer->jobCapacity )
+    {
+      streamer->jobCapacity = streamer->jobCapacity ? streamer->jobCapacity * 2 : 16;
+      streamer->jobs =
+          (DK_vkTextureJob *)realloc( streamer->jobs, streamer->jobCapacity * sizeof( DK_vkTextureJob ) );
+    }
+
+    DK_vkTextureJob *job = &streamer->jobs[streamer->jobCount++];
+    *job                 = (DK_vkTextureJob){ 0 };
+    job->filename        = DK_vkCopyString( filename );
+    job->textureId       = textureId;
+    job->state           = DK_VK_TEXTURE_JOB_QUEUED;
+
+    pthread_cond_signal( &streamer->wake );
+    pthread_mutex_unlock( &streamer->mutex );
+  }
+
+  /* Note: called from DK_vkBeginBatch once the queue is idle, uploads at most
+   * DK_VK_TEXTURE_UPLOADS_PER_POLL decoded images so a burst of loads is spread over frames */
+  DK_VULKAN_FUNC void DK_vkPollTextureStreaming( DK_vkApplication *app )
+  {
+    DK_vkTextureStreamer *streamer = &app->textureStreamer;
+    if ( !streamer->running )
+    {
+      return;
+    }
+
+    DK_vkTextureJob finished[DK_VK_TEXTURE_UPLOADS_PER_POLL];
+    uint32_t        finishedCount = 0;
+
+    pthread_mutex_lock( &streamer->mutex );
+    for ( uint32_t i = 0; i < streamer->jobCount && finishedCount < DK_VK_TEXTURE_UPLOADS_PER_POLL; )
+    {
+      DK_vkTextureJobState state = streamer->jobs[i].state;
+      if ( state != DK_VK_TEXTURE_JOB_DECODED && state != DK_VK_TEXTURE_JOB_FAILED )
+      {
+        i++;
+        continue;
+      }
+
+      finished[finishedCount++] = streamer->jobs[i];
+      memmove( &streamer->jobs[i],
+               &streamer->jobs[i + 1],
+               ( streamer->jobCount - i - 1 ) * sizeof( DK_vkTextureJob ) );
+      streamer->jobCount--;
+    }
+    pthread_mutex_unlock( &streamer->mutex );
+
+    DK_vkBeginUploads( app );
+
+    for ( uint32_t i = 0; i < finishedCount; i++ )
+    {
+      DK_vkTextureJob *job     = &finished[i];
+      DK_vkTexture    *texture = DK_vkGetTexture( app, job->textureId );
+
+      // the texture was removed while its image was decoding
+      if ( texture == NULL )
+      {
+        DK_vkFreeImage( &job->image );
+        free( job->filename );
+        continue;
+      }
+
+      if ( job->state == DK_VK_TEXTURE_JOB_FAILED )
+      {
+        // the file is gone, do not queue it again every time the texture is drawn
+        fprintf( stderr, "Failed to load texture image: %s\n", job->filename );
+        free( job->filename );
+        free( texture->source );
+        texture->source    = NULL;
+        texture->residency = DK_VK_TEXTURE_EVICTED;
+        continue;
+      }
+
+      // the id was handed out before decoding, only later loads can share this texture by content
+      if ( texture->pixelHash == 0 )
+      {
+        texture->pixelHash = DK_vkHashImage( &job->image, &texture->pixelDigest );
+      }
+
+      DK_vkCreateTextureFromImage( app, &job->image, texture );
+      DK_vkMarkTextureDirty( app, (uint32_t)( texture - app->textures ) );
+      DK_vkFreeImage( &job->image );
+      free( job->filename );
+    }
+
+    DK_vkEndUploads( app, false );
+  }
+
+  DK_VULKAN_FUNC void
+  DK_vkSetTextureSampling( DK_vkApplication *app, uint32_t textureId, const DK_vkSamplerState *state )
+  {
+    DK_vkTexture *texture = DK_vkGetTexture( app, textureId );
+    if ( texture == NULL )
+    {
+      fprintf( stderr, "Invalid texture id %u\n", textureId );
+      return;
+    }
+
+    VkSampler sampler = DK_vkGetSampler( app, state );
+    if ( texture->sampler != sampler )
+    {
+      texture->sampler = sampler;
+      DK_vkMarkTextureDirty( app, (uint32_t)( texture - app->textures ) );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkSetTextureActive( DK_vkApplication *app, uint32_t textureId, bool active )
+  {
+    DK_vkTexture *texture = DK_vkGetTexture( app, textureId );
+    if ( texture != NULL )
+    {
+      if ( active && !texture->isActive )
+      {
+        texture->isActive = true;
+        app->activeTextureCount++;
+      }
+      else if ( !active && texture->isActive )
+      {
+        texture->isActive = false;
+        if ( app->activeTextureCount > 0 )
+        {
+          app->activeTextureCount--;
+        }
+      }
+
+      DK_vkUpdateDescriptorSetsWithActiveTextures( app );
+    }
+  }
+
+  // handle 0 and removed textures select texture 0
+  DK_VULKAN_FUNC void DK_vkSetTexture( DK_vkApplication *app, uint32_t textureId )
+  {
+    if ( app->textureCount > 0 )
+    {
+      app->currentTexture               = &app->textures[DK_vkGetTextureIndex( app, textureId )];
+      app->batchRenderer.currentTexture = app->currentTexture;
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkUpdateDescriptorSetWithTexture( DK_vkApplication *app, DK_vkTexture *texture )
+  {
+    if ( !texture )
+    {
+      return;
+    }
+
+    // the frame sets are rewritten lazily in DK_vkFlushBatch, never while the GPU may read them
+    DK_vkMarkDescriptorsDirty( app, DK_VK_DESCRIPTOR_BINDING_UNIFORM | DK_VK_DESCRIPTOR_BINDING_TEXTURES );
+  }
+
+  DK_VULKAN_FUNC void DK_vkFlushBatch( DK_vkApplication *app )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+
+    if ( renderer->vertexCount == 0 && renderer->commandCount == 0 )
+    {
+      return;
+    }
+
+    if ( app->framebufferResized )
+    {
+      if ( renderer->hasBegun )
+      {
+        vkEndCommandBuffer( renderer->commandBuffer );
+        renderer->hasBegun = false;
+      }
+
+      vkDeviceWaitIdle( app->device );
+      app->framebufferResized = false;
+      DK_vkRecreateSwapChain( app );
+
+      if ( renderer->vertexCount > 0 )
+      {
+        DK_vkBeginBatch( app );
+      }
+      return;
+    }
+
+    if ( app->textureCount == 0 )
+    {
+      // if no texture is available, create a dummy texture
+      DK_vkCreateDummyTexture( app );
+      DK_vkUpdateDescriptorSetWithTexture( app, &app->textures[0] );
+    }
+
+    uint32_t imageIndex;
+    VkResult result = vkAcquireNextImageKHR( app->device,
+                                             app->swapChain,
+                                             UINT64_MAX,
+                                             app->imageAvailableSemaphores[app->currentFrame],
+                                             VK_NULL_HANDLE,
+                                             &imageIndex );
+
+    if ( result == VK_ERROR_OUT_OF_DATE_KHR )
+    {
+      app->framebufferResized = true;
+      return;
+    }
+    else if ( result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR )
+    {
+      fprintf( stderr, "Failed to acquire swap chain image\n" );
+      return;
+    }
+
+    vkWaitForFences( app->device, 1, &app->inFlightFences[app->currentFrame], VK_TRUE, UINT64_MAX );
+    vkResetFences( app->device, 1, &app->inFlightFences[app->currentFrame] );
+
+    DK_vkUpdateFrameDescriptorSet( app, app->currentFrame );
+
+    VkRenderPassBeginInfo renderPassInfo = { 0 };
+    renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass            = app->renderPass;
+    renderPassInfo.framebuffer           = app->swapChainFramebuffers[imageIndex];
+    renderPassInfo.renderArea.offset.x   = 0;
+    renderPassInfo.renderArea.offset.y   = 0;
+    renderPassInfo.renderArea.extent     = app->swapChainExtent;
+
+    VkClearValue clearValues[2]    = { 0 };
+    clearValues[0].color           = (VkClearColorValue){ { 0.0f, 0.0f, 0.0f, 1.0f } };
+    clearValues[1].depthStencil    = (VkClearDepthStencilValue){ 1.0f, 0 };
+    renderPassInfo.clearValueCount = enableStencilAttachment ? 2 : 1;
+    renderPassInfo.pClearValues    = clearValues;
+
+    DK_vkCloseBatchSegment( renderer );
+    DK_vkRecordTextureUpdates( app, renderer->commandBuffer );
+
+    vkCmdBeginRenderPass( renderer->commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+    vkCmdBindDescriptorSets( renderer->commandBuffer,
+                             VK_PIPELINE_BIND_POINT_GRAPHICS,
+                             renderer->pipelineLayout,
+                             0,
+                             1,
+                             &app->descriptorSets[app->currentFrame][0],
+                             0,
+                             NULL );
+
+    VkBuffer     vertexBuffers[] = { renderer->vertexBuffer };
+    VkDeviceSize offsets[]       = { 0 };
+    vkCmdBindVertexBuffers( renderer->commandBuffer, 0, 1, vertexBuffers, offsets );
+    vkCmdBindIndexBuffer( renderer->commandBuffer, renderer->indexBuffer, 0, VK_INDEX_TYPE_UINT32 );
+
+    VkPipeline            boundPipeline = VK_NULL_HANDLE;
+    DK_vkBatchCommandType boundBuffers  = DK_VK_BATCH_COMMAND_TRIANGLES;
+    uint32_t              boundTable    = 0;
+    for ( uint32_t i = 0; i < renderer->commandCount; i++ )
+    {
+      DK_vkBatchCommand *command  = &renderer->commands[i];
+      VkPipeline         pipeline = renderer->pipeline;
+
+      // every pipeline shares the layout, the set stays bound across pipeline changes
+      if ( command->textureTable != boundTable )
+      {
+        vkCmdBindDescriptorSets( renderer->commandBuffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 renderer->pipelineLayout,
+                                 0,
+                                 1,
+                                 &app->descriptorSets[app->currentFrame][command->textureTable],
+                                 0,
+                                 NULL );
+        boundTable = command->textureTable;
+      }
+
+      if ( command->type == DK_VK_BATCH_COMMAND_STENCIL_FILL )
+      {
+        pipeline = app->stencilFillPipeline;
+      }
+      else if ( command->type == DK_VK_BATCH_COMMAND_STENCIL_COVER )
+      {
+        pipeline = app->stencilCoverPipeline;
+      }
+      else if ( command->type == DK_VK_BATCH_COMMAND_SHAPE_INSTANCES )
+      {
+        pipeline = app->shapePipeline;
+      }
+      else if ( command->type == DK_VK_BATCH_COMMAND_SHADOW_INSTANCES )
+      {
+        pipeline = app->shadowPipeline;
+      }
+
+      if ( pipeline != boundPipeline )
+      {
+        vkCmdBindPipeline( renderer->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+        boundPipeline = pipeline;
+      }
+
+      // stencil commands draw from the batch buffers as well
+      DK_vkBatchCommandType buffers = command->type;
+      if ( buffers == DK_VK_BATCH_COMMAND_STENCIL_FILL || buffers == DK_VK_BATCH_COMMAND_STENCIL_COVER )
+      {
+        buffers = DK_VK_BATCH_COMMAND_TRIANGLES;
+      }
+
+      if ( buffers != boundBuffers )
+      {
+        if ( buffers == DK_VK_BATCH_COMMAND_SHAPE_INSTANCES )
+        {
+          VkBuffer     meshBuffers[] = { app->shapeCache.vertexBuffer, app->shapeCache.instanceBuffer };
+          VkDeviceSize meshOffsets[] = {
+            0, (VkDeviceSize)app->currentFrame * DK_VK_SHAPE_MAX_INSTANCES * sizeof( DK_vkShapeInstance )
+          };
+          vkCmdBindVertexBuffers( renderer->commandBuffer, 0, 2, meshBuffers, meshOffsets );
+          vkCmdBindIndexBuffer( renderer->commandBuffer, app->shapeCache.indexBuffer, 0, VK_INDEX_TYPE_UINT32 );
+        }
+        else if ( buffers == DK_VK_BATCH_COMMAND_SHADOW_INSTANCES )
+        {
+          VkBuffer     shadowBuffer = app->shadowBatch.instanceBuffer;
+          VkDeviceSize shadowOffset =
+              (VkDeviceSize)app->currentFrame * DK_VK_SHADOW_MAX_INSTANCES * sizeof( DK_vkShadowInstance );
+          vkCmdBindVertexBuffers( renderer->commandBuffer, 0, 1, &shadowBuffer, &shadowOffset );
+        }
+        else
+        {
+          vkCmdBindVertexBuffers( renderer->commandBuffer, 0, 1, vertexBuffers, offsets );
+          vkCmdBindIndexBuffer( renderer->commandBuffer, renderer->indexBuffer, 0, VK_INDEX_TYPE_UINT32 );
+        }
+
+        boundBuffers = buffers;
+      }
+
+      if ( command->type == DK_VK_BATCH_COMMAND_SHAPE_INSTANCES )
+      {
+        vkCmdDrawIndexed( renderer->commandBuffer,
+                          command->indexCount,
+                          command->instanceCount,
+                          command->firstIndex,
+                          command->vertexOffset,
+                          command->firstInstance );
+        continue;
+      }
+
+      // shadow quads are generated in the vertex shader, 6 vertices per instance
+      if ( command->type == DK_VK_BATCH_COMMAND_SHADOW_INSTANCES )
+      {
+        vkCmdDraw( renderer->commandBuffer, 6, command->instanceCount, 0, command->firstInstance );
+        continue;
+      }
+
+      if ( command->type == DK_VK_BATCH_COMMAND_STENCIL_COVER )
+      {
+        vkCmdSetStencilCompareMask( renderer->commandBuffer,
+                                    VK_STENCIL_FACE_FRONT_AND_BACK,
+                                    command->stencilCompareMask );
+      }
+
+      vkCmdDrawIndexed( renderer->commandBuffer, command->indexCount, 1, command->firstIndex, 0, 0 );
+    }
+
+    vkCmdEndRenderPass( renderer->commandBuffer );
+    vkEndCommandBuffer( renderer->commandBuffer );
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType        = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+    VkSemaphore          waitSemaphores[] = { app->imageAvailableSemaphores[app->currentFrame] };
+    VkPipelineStageFlags waitStages[]     = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    submitInfo.waitSemaphoreCount         = 1;
+    submitInfo.pWaitSemaphores            = waitSemaphores;
+    submitInfo.pWaitDstStageMask          = waitStages;
+
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &renderer->commandBuffer;
+
+    VkSemaphore signalSemaphores[]  = { app->renderFinishedSemaphores[app->currentFrame] };
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = signalSemaphores;
+
+    if ( vkQueueSubmit( app->graphicsQueue, 1, &submitInfo, app->inFlightFences[app->currentFrame] ) !=
+         VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to submit batch draw command buffer\n" );
+      exit( 1 );
+    }
+
+    VkPresentInfoKHR presentInfo   = {};
+    presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores    = signalSemaphores;
+
+    VkSwapchainKHR swapChains[] = { app->swapChain };
+    presentInfo.swapchainCount  = 1;
+    presentInfo.pSwapchains     = swapChains;
+    presentInfo.pImageIndices   = &imageIndex;
+
+    result = vkQueuePresentKHR( app->presentQueue, &presentInfo );
+
+    if ( result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || app->framebufferResized )
+    {
+      app->framebufferResized = false;
+      DK_vkRecreateSwapChain( app );
+    }
+    else if ( result != VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to present swap chain image\n" );
+    }
+
+    app->currentFrame      = ( app->currentFrame + 1 ) % DK_VULKAN_MAX_FRAMES_IN_FLIGHT;
+    renderer->vertexCount  = 0;
+    renderer->indexCount   = 0;
+    renderer->commandCount = 0;
+    renderer->segmentStart = 0;
+
+    renderer->textureSlotCounts[0] = 1;
+    renderer->textureTableCount    = 1;
+    renderer->textureTable         = 0;
+    app->shapeCache.instanceCount  = 0;
+    app->shadowBatch.instanceCount = 0;
+  }
+
+  DK_VULKAN_FUNC void DK_vkCleanupTextureSystem( DK_vkApplication *app )
+  {
+
+    vkDeviceWaitIdle( app->device );
+    DK_vkCleanupSwapChain( app );
+
+    if ( app->batchRenderer.vertexBuffer != VK_NULL_HANDLE )
+    {
+      DK_vkDestroyBatchRenderer( app );
+    }
+
+    if ( app->textures != NULL )
+    {
+      DK_vkCleanupTextureSystem( app );
+    }
+
+    app->currentTexture               = NULL;
+    app->batchRenderer.currentTexture = NULL;
+
+    for ( uint32_t i = 0; i < app->textureCount; i++ )
+    {
+      app->textures[i].sampler = VK_NULL_HANDLE;
+
+      if ( app->textures[i].view != VK_NULL_HANDLE )
+      {
+        vkDestroyImageView( app->device, app->textures[i].view, NULL );
+        app->textures[i].view = VK_NULL_HANDLE;
+      }
+
+      if ( app->textures[i].image != VK_NULL_HANDLE )
+      {
+        vkDestroyImage( app->device, app->textures[i].image, NULL );
+        app->textures[i].image = VK_NULL_HANDLE;
+      }
+
+      DK_vkFreeMemory( app, &app->textures[i].memory );
+      free( app->textures[i].source );
+    }
+
+    free( app->textures );
+    app->textures        = NULL;
+    app->textureCount    = 0;
+    app->maxTextures     = 0;
+    app->freeTextureSlot = 0;
+  }
+
+  DK_VULKAN_FUNC void
+  DK_vkDrawTriangle( DK_vkApplication *app, DK_vkVec2 p1, DK_vkVec2 p2, DK_vkVec2 p3, DK_vkColor tint )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( !renderer->hasBegun )
+    {
+      DK_vkBeginBatch( app );
+    }
+
+    if ( renderer->vertexCount + 3 > MAX_BATCH_VERTICES || renderer->indexCount + 3 > MAX_BATCH_INDICES )
+    {
+      DK_vkFlushBatch( app );
+      DK_vkBeginBatch( app );
+    }
+
+    uint32_t baseIndex = renderer->vertexCount;
+
+    DK_vkAddVertex( renderer, p1[0], p1[1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, p2[0], p2[1], tint[0], tint[1], tint[2], tint[3], 1.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, p3[0], p3[1], tint[0], tint[1], tint[2], tint[3], 0.5f, 1.0f, -1 );
+
+    if ( renderer->indexCount + 3 <= MAX_BATCH_INDICES )
+    {
+      DK_vkAddIndex( renderer, baseIndex );
+      DK_vkAddIndex( renderer, baseIndex + 1 );
+      DK_vkAddIndex( renderer, baseIndex + 2 );
+    }
+    else
+    {
+      printf( "Warning: Index buffer overflow in DK_vkDrawTriangle!\n" );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawQuad( DK_vkApplication *app,
+                                     DK_vkVec2         p1,
+                                     DK_vkVec2         p2,
+                                     DK_vkVec2         p3,
+                                     DK_vkVec2         p4,
+                                     DK_vkColor        tint )
+  {
+
+    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( !renderer->hasBegun )
+    {
+      DK_vkBeginBatch( app );
+    }
+
+    if ( renderer->vertexCount + 4 > MAX_BATCH_VERTICES || renderer->indexCount + 6 > MAX_BATCH_INDICES )
+    {
+      DK_vkFlushBatch( app );
+      DK_vkBeginBatch( app );
+    }
+
+    uint32_t baseIndex = renderer->vertexCount;
+    DK_vkAddVertex( renderer, p1[0], p1[1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, p2[0], p2[1], tint[0], tint[1], tint[2], tint[3], 1.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, p3[0], p3[1], tint[0], tint[1], tint[2], tint[3], 1.0f, 1.0f, -1 );
+    DK_vkAddVertex( renderer, p4[0], p4[1], tint[0], tint[1], tint[2], tint[3], 0.0f, 1.0f, -1 );
+
+    if ( renderer->indexCount + 6 <= MAX_BATCH_INDICES )
+    {
+      DK_vkAddIndex( renderer, baseIndex );
+      DK_vkAddIndex( renderer, baseIndex + 1 );
+      DK_vkAddIndex( renderer, baseIndex + 2 );
+
+      DK_vkAddIndex( renderer, baseIndex );
+      DK_vkAddIndex( renderer, baseIndex + 2 );
+      DK_vkAddIndex( renderer, baseIndex + 3 );
+    }
+    else
+    {
+      printf( "Warning: Index buffer overflow in DK_vkDrawQuad!\n" );
+    }
+  }
+
+  DK_VULKAN_FUNC void
+  DK_vkDrawRectangle( DK_vkApplication *app, DK_vkVec2 position, DK_vkSize size, DK_vkColor tint )
+  {
+
+    DK_vkVec2 p1 = { position[0], position[1] };
+    DK_vkVec2 p2 = { position[0] + size[0], position[1] };
+    DK_vkVec2 p3 = { position[0] + size[0], position[1] + size[1] };
+    DK_vkVec2 p4 = { position[0], position[1] + size[1] };
+    DK_vkDrawQuad( app, p1, p2, p3, p4, tint );
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawRoundedRectangle( DK_vkApplication *app,
+                                                 DK_vkVec2         position,
+                                                 DK_vkSize         size,
+                                                 float             radius,
+                                                 DK_vkColor        tint,
+                                                 int32_t           segments )
+  {
+    if ( segments < 4 )
+    {
+      segments = 4;
+    }
+
+    if ( DK_vkDrawCachedShape( app, DK_VK_SHAPE_ROUNDED_RECTANGLE, position, size, radius, tint, segments ) )
+    {
+      return;
+    }
+
+    float x = position[0];
+    float y = position[1];
 
     float width  = size[0];
     float height = size[1];
 
-    float max_radius = fminf( width, height ) * 0.5f;
-    radius           = fminf( radius, max_radius );
+    float max_radius = fminf( width, height ) * 0.5f;
+    radius           = fminf( radius, max_radius );
+
+    DK_vkDrawRectangle( app, (DK_vkVec2){ x + radius, y }, (DK_vkSize){ width - 2 * radius, height }, tint );
+
+    // l and r rectangles
+    DK_vkDrawRectangle( app, (DK_vkVec2){ x, y + radius }, (DK_vkSize){ radius, height - 2 * radius }, tint );
+    DK_vkDrawRectangle( app,
+                        (DK_vkVec2){ x + width - radius, y + radius },
+                        (DK_vkSize){ radius, height - 2 * radius },
+                        tint );
+
+    // arch
+    int32_t segmentsPerCorner = segments / 4;
+    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    {
+      float startAngle = M_PI + ( i * M_PI / 2 ) / segmentsPerCorner;
+      float endAngle   = M_PI + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+
+      float startX = x + radius + radius * cosf( startAngle );
+      float startY = y + radius + radius * sinf( startAngle );
+      float endX   = x + radius + radius * cosf( endAngle );
+      float endY   = y + radius + radius * sinf( endAngle );
+
+      DK_vkVec2 p1 = { x + radius, y + radius };
+      DK_vkVec2 p2 = { startX, startY };
+      DK_vkVec2 p3 = { endX, endY };
+      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    }
+
+    // tr corner
+    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    {
+      float startAngle = M_PI * 1.5f + ( i * M_PI / 2 ) / segmentsPerCorner;
+      float endAngle   = M_PI * 1.5f + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+
+      float startX = x + width - radius + radius * cosf( startAngle );
+      float startY = y + radius + radius * sinf( startAngle );
+      float endX   = x + width - radius + radius * cosf( endAngle );
+      float endY   = y + radius + radius * sinf( endAngle );
+
+      DK_vkVec2 p1 = { x + width - radius, y + radius };
+      DK_vkVec2 p2 = { startX, startY };
+      DK_vkVec2 p3 = { endX, endY };
+
+      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    }
+
+    // br corner
+    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    {
+      float startAngle = 0.0f + ( i * M_PI / 2 ) / segmentsPerCorner;
+      float endAngle   = 0.0f + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+
+      float startX = x + width - radius + radius * cosf( startAngle );
+      float startY = y + height - radius + radius * sinf( startAngle );
+      float endX   = x + width - radius + radius * cosf( endAngle );
+      float endY   = y + height - radius + radius * sinf( endAngle );
+
+      DK_vkVec2 p1 = { x + width - radius, y + height - radius };
+      DK_vkVec2 p2 = { startX, startY };
+      DK_vkVec2 p3 = { endX, endY };
+
+      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    }
+
+    // bl corner
+    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    {
+      float startAngle = M_PI / 2 + ( i * M_PI / 2 ) / segmentsPerCorner;
+      float endAngle   = M_PI / 2 + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+
+      float startX = x + radius + radius * cosf( startAngle );
+      float startY = y + height - radius + radius * sinf( startAngle );
+      float endX   = x + radius + radius * cosf( endAngle );
+      float endY   = y + height - radius + radius * sinf( endAngle );
+
+      DK_vkVec2 p1 = { x + radius, y + height - radius };
+      DK_vkVec2 p2 = { startX, startY };
+      DK_vkVec2 p3 = { endX, endY };
+
+      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawGradientRectangle( DK_vkApplication *app,
+                                                  DK_vkVec2         position,
+                                                  DK_vkSize         size,
+                                                  DK_vkColor        tint_bl,
+                                                  DK_vkColor        tint_br,
+                                                  DK_vkColor        tint_tr,
+                                                  DK_vkColor        tint_tl )
+  {
+
+    DK_vkRenderer *renderer = &app->batchRenderer;
+
+    if ( !renderer->hasBegun )
+    {
+      DK_vkBeginBatch( app );
+    }
+
+    if ( renderer->vertexCount + 4 > MAX_BATCH_VERTICES || renderer->indexCount + 6 > MAX_BATCH_INDICES )
+    {
+      DK_vkFlushBatch( app );
+      DK_vkBeginBatch( app );
+    }
+
+    DK_vkVec2 p1 = { position[0], position[1] };
+    DK_vkVec2 p2 = { position[0] + size[0], position[1] };
+    DK_vkVec2 p3 = { position[0] + size[0], position[1] + size[1] };
+    DK_vkVec2 p4 = { position[0], position[1] + size[1] };
+
+    uint32_t baseIndex = renderer->vertexCount;
+
+    // bl
+    uint32_t   idx1 = renderer->vertexCount;
+    DK_Vertex *v1   = &renderer->vertexBufferMapped[renderer->vertexCount++];
+    v1->pos[0]      = p1[0];
+    v1->pos[1]      = p1[1];
+    memcpy( v1->color, tint_bl, sizeof( float ) * 4 );
+    v1->texCoord[0] = 0.0f;
+    v1->texCoord[1] = 0.0f;
+
+    // br
+    uint32_t   idx2 = renderer->vertexCount;
+    DK_Vertex *v2   = &renderer->vertexBufferMapped[renderer->vertexCount++];
+    v2->pos[0]      = p2[0];
+    v2->pos[1]      = p2[1];
+    memcpy( v2->color, tint_br, sizeof( float ) * 4 );
+    v2->texCoord[0] = 1.0f;
+    v2->texCoord[1] = 0.0f;
+
+    // tr
+    uint32_t   idx3 = renderer->vertexCount;
+    DK_Vertex *v3   = &renderer->vertexBufferMapped[renderer->vertexCount++];
+    v3->pos[0]      = p3[0];
+    v3->pos[1]      = p3[1];
+    memcpy( v1->color, tint_tr, sizeof( float ) * 4 );
+    v3->texCoord[0] = 1.0f;
+    v3->texCoord[1] = 1.0f;
+
+    // tl
+    uint32_t   idx4 = renderer->vertexCount;
+    DK_Vertex *v4   = &renderer->vertexBufferMapped[renderer->vertexCount++];
+    v4->pos[0]      = p4[0];
+    v4->pos[1]      = p4[1];
+    memcpy( v1->color, tint_tl, sizeof( float ) * 4 );
+    v4->texCoord[0] = 0.0f;
+    v4->texCoord[1] = 1.0f;
+
+    if ( renderer->indexCount + 6 <= MAX_BATCH_INDICES )
+    {
+      DK_vkAddIndex( renderer, idx1 );
+      DK_vkAddIndex( renderer, idx2 );
+      DK_vkAddIndex( renderer, idx3 );
+
+      DK_vkAddIndex( renderer, idx1 );
+      DK_vkAddIndex( renderer, idx3 );
+      DK_vkAddIndex( renderer, idx4 );
+    }
+    else
+    {
+      printf( "Warning: Index buffer overflow in DK_vkDrawGradientRectangle!\n" );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawCircle( DK_vkApplication *app,
+                                       DK_vkVec2         position,
+                                       float             radius,
+                                       DK_vkColor        tint,
+                                       int32_t           segments )
+  {
+    if ( segments < 3 )
+    {
+      segments = 3;
+    }
+
+    if ( DK_vkDrawCachedShape( app, DK_VK_SHAPE_CIRCLE, position, (DK_vkSize){ radius, radius }, radius, tint, segments ) )
+    {
+      return;
+    }
+
+    float vertices[segments * 2];
+
+    for ( int32_t i = 0; i < segments; i++ )
+    {
+      float angle         = i * ( 2.0f * M_PI / segments );
+      vertices[i * 2]     = position[0] + radius * cosf( angle );
+      vertices[i * 2 + 1] = position[1] + radius * sinf( angle );
+    }
+
+    for ( int32_t i = 0; i < segments; i++ )
+    {
+      int32_t nextI = ( i + 1 ) % segments;
+
+      DK_vkColor p1 = { position[0], position[1] };
+      DK_vkColor p2 = { vertices[i * 2], vertices[i * 2 + 1] };
+      DK_vkColor p3 = { vertices[nextI * 2], vertices[nextI * 2 + 1] };
+
+      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    }
+  }
+
+  DK_VULKAN_FUNC void
+  DK_vkDrawLine( DK_vkApplication *app, DK_vkVec2 begin, DK_vkVec2 end, float thickness, DK_vkColor tint )
+  {
+    float dx     = end[0] - begin[0];
+    float dy     = end[1] - begin[1];
+    float length = sqrtf( dx * dx + dy * dy );
+
+    if ( length < 0.001f )
+    {
+      DK_vkDrawRectangle( app,
+                          (DK_vkVec2){ begin[0] - thickness / 2, begin[1] - thickness / 2 },
+                          (DK_vkSize){ thickness, thickness },
+                          tint );
+      return;
+    }
+
+    float nx = dx / length;
+    float ny = dy / length;
+
+    // perpendicular vector (rotated 90 degrees)
+    float px = -ny;
+    float py = nx;
+    float ht = thickness * 0.5f;
+
+    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( !renderer->hasBegun )
+    {
+      DK_vkBeginBatch( app );
+    }
+
+    if ( renderer->vertexCount + 4 > MAX_BATCH_VERTICES || renderer->indexCount + 6 > MAX_BATCH_INDICES )
+    {
+      DK_vkFlushBatch( app );
+      DK_vkBeginBatch( app );
+    }
+
+    uint32_t baseIndex = renderer->vertexCount;
+
+    // bl
+    DK_vkAddVertex( renderer,
+                    begin[0] - px * ht,
+                    begin[1] - py * ht,
+                    tint[0],
+                    tint[1],
+                    tint[2],
+                    tint[3],
+                    0.0f,
+                    0.0f,
+                    -1 );
+
+    // br
+    DK_vkAddVertex( renderer,
+                    end[0] - px * ht,
+                    end[1] - py * ht,
+                    tint[0],
+                    tint[1],
+                    tint[2],
+                    tint[3],
+                    1.0f,
+                    0.0f,
+                    -1 );
+
+    // tr
+    DK_vkAddVertex( renderer,
+                    end[0] + px * ht,
+                    end[1] + py * ht,
+                    tint[0],
+                    tint[1],
+                    tint[2],
+                    tint[3],
+                    1.0f,
+                    1.0f,
+                    -1 );
+
+    // tl
+    DK_vkAddVertex( renderer,
+                    begin[0] + px * ht,
+                    begin[1] + py * ht,
+                    tint[0],
+                    tint[1],
+                    tint[2],
+                    tint[3],
+                    0.0f,
+                    1.0f,
+                    -1 );
+
+    DK_vkAddIndex( renderer, baseIndex );
+    DK_vkAddIndex( renderer, baseIndex + 1 );
+    DK_vkAddIndex( renderer, baseIndex + 2 );
+
+    DK_vkAddIndex( renderer, baseIndex );
+    DK_vkAddIndex( renderer, baseIndex + 2 );
+    DK_vkAddIndex( renderer, baseIndex + 3 );
+  }
+
+  // ========================================================================================
+  // POLYGON FILLING
+  // ========================================================================================
+
+  DK_VULKAN_FUNC bool DK_vkReserveBatch( DK_vkApplication *app, uint32_t vertexCount, uint32_t indexCount )
+  {
+    DK_vkRenderer *renderer = &app->batchRenderer;
+
+    if ( vertexCount > MAX_BATCH_VERTICES || indexCount > MAX_BATCH_INDICES )
+    {
+      fprintf( stderr,
+               "Batch reservation of %u vertices and %u indices exceeds the batch capacity\n",
+               vertexCount,
+               indexCount );
+      return false;
+    }
+
+    if ( !renderer->hasBegun )
+    {
+      DK_vkBeginBatch( app );
+    }
+
+    if ( renderer->vertexCount + vertexCount > MAX_BATCH_VERTICES ||
+         renderer->indexCount + indexCount > MAX_BATCH_INDICES )
+    {
+      DK_vkFlushBatch( app );
+      DK_vkBeginBatch( app );
+    }
+
+    return true;
+  }
+
+  DK_VULKAN_FUNC uint64_t DK_vkHashBytes( const void *data, size_t size, uint64_t hash )
+  {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for ( size_t i = 0; i < size; i++ )
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL; // FNV-1a prime
+    }
+
+    return hash;
+  }
+
+  // MurmurHash64A, unrelated to FNV-1a so a collision in one is not a collision in the other
+  DK_VULKAN_FUNC uint64_t DK_vkHashWords( const void *data, size_t size, uint64_t seed )
+  {
+    const uint64_t       m     = 0xC6A4A7935BD1E995ULL;
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t             hash  = seed ^ ( size * m );
+
+    size_t words = size / 8;
+    for ( size_t i = 0; i < words; i++ )
+    {
+      uint64_t k;
+      memcpy( &k, bytes + i * 8, sizeof( k ) );
+      k *= m;
+      k ^= k >> 47;
+      k *= m;
+      hash ^= k;
+      hash *= m;
+    }
+
+    size_t tail = size & 7;
+    if ( tail > 0 )
+    {
+      uint64_t k = 0;
+      memcpy( &k, bytes + words * 8, tail );
+      hash ^= k;
+      hash *= m;
+    }
+
+    hash ^= hash >> 47;
+    hash *= m;
+    hash ^= hash >> 47;
+    return hash;
+  }
+
+  DK_VULKAN_FUNC float DK_vkCross2( const float *a, const float *b, const float *c )
+  {
+    return ( b[0] - a[0] ) * ( c[1] - a[1] ) - ( b[1] - a[1] ) * ( c[0] - a[0] );
+  }
+
+  // positive area means clockwise on screen (y down), which is the front face of the pipeline
+  DK_VULKAN_FUNC float DK_vkPolygonSignedArea( const DK_vkVec2 *points, uint32_t begin, uint32_t end )
+  {
+    float area = 0.0f;
+    for ( uint32_t i = begin, j = end - 1; i < end; j = i++ )
+    {
+      area += points[j][0] * points[i][1] - points[i][0] * points[j][1];
+    }
+
+    return area * 0.5f;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkIsPolygonConvex( const DK_vkVec2 *points, uint32_t pointCount )
+  {
+    float   turnSign    = 0.0f;
+    int32_t firstDxSign = 0;
+    int32_t prevDxSign  = 0;
+    int32_t dxFlips     = 0;
+
+    for ( uint32_t i = 0; i < pointCount; i++ )
+    {
+      const float *a = points[i];
+      const float *b = points[( i + 1 ) % pointCount];
+      const float *c = points[( i + 2 ) % pointCount];
+
+      float cross = DK_vkCross2( a, b, c );
+      if ( fabsf( cross ) > 1e-6f )
+      {
+        if ( turnSign == 0.0f )
+        {
+          turnSign = cross;
+        }
+        else if ( turnSign * cross < 0.0f )
+        {
+          return false;
+        }
+      }
+
+      // a simple convex outline changes horizontal direction exactly twice, a star winds more often
+      float   dx     = b[0] - a[0];
+      int32_t dxSign = dx > 0.0f ? 1 : ( dx < 0.0f ? -1 : 0 );
+      if ( dxSign == 0 )
+      {
+        continue;
+      }
+
+      if ( firstDxSign == 0 )
+      {
+        firstDxSign = dxSign;
+      }
+      else if ( dxSign != prevDxSign )
+      {
+        dxFlips++;
+      }
+
+      prevDxSign = dxSign;
+    }
+
+    if ( prevDxSign != firstDxSign )
+    {
+      dxFlips++;
+    }
+
+    return dxFlips <= 2;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkPointInTriangle( const float *p, const float *a, const float *b, const float *c )
+  {
+    return DK_vkCross2( a, b, p ) >= 0.0f && DK_vkCross2( b, c, p ) >= 0.0f && DK_vkCross2( c, a, p ) >= 0.0f;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkPointEquals( const float *a, const float *b )
+  {
+    return a[0] == b[0] && a[1] == b[1];
+  }
+
+  // splices a hole into the ring through a bridge edge from its rightmost vertex to a visible ring vertex
+  DK_VULKAN_FUNC uint32_t DK_vkBridgeHole( const DK_vkVec2 *points,
+                                           uint32_t        *ring,
+                                           uint32_t         ringCount,
+                                           uint32_t         holeBegin,
+                                           uint32_t         holeEnd )
+  {
+    uint32_t holeCount = holeEnd - holeBegin;
+    uint32_t m         = holeBegin;
+    for ( uint32_t i = holeBegin + 1; i < holeEnd; i++ )
+    {
+      if ( points[i][0] > points[m][0] )
+      {
+        m = i;
+      }
+    }
+
+    float mx = points[m][0];
+    float my = points[m][1];
+
+    // cast a ray towards +x and take the closest edge it hits
+    int64_t bridge = -1;
+    float   hitX   = INFINITY;
+    for ( uint32_t k = 0; k < ringCount; k++ )
+    {
+      const float *a = points[ring[k]];
+      const float *b = points[ring[( k + 1 ) % ringCount]];
+
+      if ( a[1] == b[1] || ( my < a[1] && my < b[1] ) || ( my > a[1] && my > b[1] ) )
+      {
+        continue;
+      }
+
+      float x = a[0] + ( my - a[1] ) * ( b[0] - a[0] ) / ( b[1] - a[1] );
+      if ( x >= mx && x < hitX )
+      {
+        hitX   = x;
+        bridge = a[0] > b[0] ? k : ( k + 1 ) % ringCount;
+      }
+    }
+
+    if ( bridge < 0 )
+    {
+      float bestDistance = INFINITY;
+      for ( uint32_t k = 0; k < ringCount; k++ )
+      {
+        float dx = points[ring[k]][0] - mx;
+        float dy = points[ring[k]][1] - my;
+        if ( dx * dx + dy * dy < bestDistance )
+        {
+          bestDistance = dx * dx + dy * dy;
+          bridge       = k;
+        }
+      }
+    }
+    else
+    {
+      // a ring vertex inside ( M, hit, P ) would block the bridge, pick the one closest to the ray instead
+      float        hit[2]  = { hitX, my };
+      const float *p       = points[ring[bridge]];
+      float        bestTan = INFINITY;
+      for ( uint32_t k = 0; k < ringCount; k++ )
+      {
+        const float *v = points[ring[k]];
+        if ( k == (uint32_t)bridge || v[0] <= mx )
+        {
+          continue;
+        }
+
+        bool inside =
+            DK_vkPointInTriangle( v, points[m], hit, p ) || DK_vkPointInTriangle( v, points[m], p, hit );
+        if ( !inside )
+        {
+          continue;
+        }
+
+        float tangent = fabsf( v[1] - my ) / ( v[0] - mx );
+        if ( tangent < bestTan )
+        {
+          bestTan = tangent;
+          bridge  = k;
+        }
+      }
+    }
+
+    // holes wind opposite to the outline
+    bool     reverse    = DK_vkPolygonSignedArea( points, holeBegin, holeEnd ) > 0.0f;
+    uint32_t insertSize = holeCount + 2;
+    uint32_t insertAt   = (uint32_t)bridge + 1;
+
+    memmove( &ring[insertAt + insertSize], &ring[insertAt], ( ringCount - insertAt ) * sizeof( uint32_t ) );
+
+    for ( uint32_t i = 0; i <= holeCount; i++ )
+    {
+      uint32_t offset    = reverse ? ( holeCount - i % holeCount ) % holeCount : i % holeCount;
+      ring[insertAt + i] = holeBegin + ( m - holeBegin + offset ) % holeCount;
+    }
+    ring[insertAt + holeCount + 1] = ring[bridge];
+
+    return ringCount + insertSize;
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkTriangulatePolygon( const DK_vkVec2 *points,
+                                                   uint32_t         pointCount,
+                                                   const uint32_t  *holeStarts,
+                                                   uint32_t         holeCount,
+                                                   uint32_t       **outIndices )
+  {
+    uint32_t outerEnd  = holeCount > 0 ? holeStarts[0] : pointCount;
+    uint32_t ringCount = 0;
+    uint32_t *ring     = (uint32_t *)malloc( ( pointCount + 2 * holeCount ) * sizeof( uint32_t ) );
+
+    bool reverse = DK_vkPolygonSignedArea( points, 0, outerEnd ) < 0.0f;
+    for ( uint32_t i = 0; i < outerEnd; i++ )
+    {
+      ring[ringCount++] = reverse ? outerEnd - 1 - i : i;
+    }
+
+    // bridge holes right to left so later bridges never cross earlier ones
+    uint32_t *order = (uint32_t *)malloc( ( holeCount + 1 ) * sizeof( uint32_t ) );
+    float    *maxX  = (float *)malloc( ( holeCount + 1 ) * sizeof( float ) );
+    for ( uint32_t h = 0; h < holeCount; h++ )
+    {
+      uint32_t begin = holeStarts[h];
+      uint32_t end   = h + 1 < holeCount ? holeStarts[h + 1] : pointCount;
+
+      order[h] = h;
+      maxX[h]  = -INFINITY;
+      for ( uint32_t i = begin; i < end; i++ )
+      {
+        maxX[h] = fmaxf( maxX[h], points[i][0] );
+      }
+
+      for ( uint32_t j = h; j > 0 && maxX[order[j - 1]] < maxX[order[j]]; j-- )
+      {
+        uint32_t tmp = order[j];
+        order[j]     = order[j - 1];
+        order[j - 1] = tmp;
+      }
+    }
+
+    for ( uint32_t i = 0; i < holeCount; i++ )
+    {
+      uint32_t h     = order[i];
+      uint32_t begin = holeStarts[h];
+      uint32_t end   = h + 1 < holeCount ? holeStarts[h + 1] : pointCount;
+      if ( end - begin >= 3 )
+      {
+        ringCount = DK_vkBridgeHole( points, ring, ringCount, begin, end );
+      }
+    }
+
+    free( order );
+    free( maxX );
+
+    // ear clipping over a linked ring
+    uint32_t *prev       = (uint32_t *)malloc( ringCount * sizeof( uint32_t ) );
+    uint32_t *next       = (uint32_t *)malloc( ringCount * sizeof( uint32_t ) );
+    uint32_t *indices    = (uint32_t *)malloc( ( ringCount > 2 ? ringCount - 2 : 1 ) * 3 * sizeof( uint32_t ) );
+    uint32_t  indexCount = 0;
+
+    for ( uint32_t i = 0; i < ringCount; i++ )
+    {
+      prev[i] = ( i + ringCount - 1 ) % ringCount;
+      next[i] = ( i + 1 ) % ringCount;
+    }
+
+    uint32_t remaining = ringCount;
+    uint32_t current   = 0;
+    uint32_t stalled   = 0;
+
+    while ( remaining > 3 )
+    {
+      uint32_t     p = prev[current];
+      uint32_t     n = next[current];
+      const float *a = points[ring[p]];
+      const float *b = points[ring[current]];
+      const float *c = points[ring[n]];
+
+      bool isEar = DK_vkCross2( a, b, c ) > 0.0f;
+      for ( uint32_t k = next[n]; isEar && k != p; k = next[k] )
+      {
+        const float *v = points[ring[k]];
+        if ( DK_vkPointEquals( v, a ) || DK_vkPointEquals( v, b ) || DK_vkPointEquals( v, c ) )
+        {
+          continue;
+        }
+
+        isEar = !DK_vkPointInTriangle( v, a, b, c );
+      }
+
+      // no ear left means the outline is degenerate, clip anyway so we always terminate
+      if ( isEar || stalled >= remaining )
+      {
+        if ( DK_vkCross2( a, b, c ) > 0.0f )
+        {
+          indices[indexCount++] = ring[p];
+          indices[indexCount++] = ring[current];
+          indices[indexCount++] = ring[n];
+        }
+
+        next[p] = n;
+        prev[n] = p;
+        remaining--;
+        current = p;
+        stalled = 0;
+      }
+      else
+      {
+        current = n;
+        stalled++;
+      }
+    }
+
+    if ( remaining == 3 && DK_vkCross2( points[ring[prev[current]]], points[ring[current]], points[ring[next[current]]] ) > 0.0f )
+    {
+      indices[indexCount++] = ring[prev[current]];
+      indices[indexCount++] = ring[current];
+      indices[indexCount++] = ring[next[current]];
+    }
+
+    free( prev );
+    free( next );
+    free( ring );
+
+    *outIndices = indices;
+    return indexCount;
+  }
+
+  DK_VULKAN_FUNC DK_vkPolygonCacheEntry *DK_vkLookupPolygon( DK_vkApplication *app,
+                                                             const DK_vkVec2  *points,
+                                                             uint32_t          pointCount,
+                                                             const uint32_t   *holeStarts,
+                                                             uint32_t          holeCount )
+  {
+    DK_vkPolygonCache *cache = &app->polygonCache;
+
+    uint64_t hash = DK_vkHashBytes( points, pointCount * sizeof( DK_vkVec2 ), DK_VK_HASH_SEED );
+    hash          = DK_vkHashBytes( holeStarts, holeCount * sizeof( uint32_t ), hash );
+
+    DK_vkPolygonCacheEntry *bucket = cache->entries[hash % DK_VK_POLYGON_CACHE_BUCKETS];
+    DK_vkPolygonCacheEntry *victim = &bucket[0];
+
+    for ( uint32_t i = 0; i < DK_VK_POLYGON_CACHE_WAYS; i++ )
+    {
+      DK_vkPolygonCacheEntry *entry = &bucket[i];
+      if ( entry->points == NULL )
+      {
+        victim = entry;
+        continue;
+      }
+
+      if ( entry->hash == hash && entry->pointCount == pointCount && entry->holeCount == holeCount &&
+           memcmp( entry->points, points, pointCount * sizeof( DK_vkVec2 ) ) == 0 &&
+           ( holeCount == 0 || memcmp( entry->holeStarts, holeStarts, holeCount * sizeof( uint32_t ) ) == 0 ) )
+      {
+        entry->lastUsed = ++cache->clock;
+        return entry;
+      }
+
+      if ( victim->points != NULL && entry->lastUsed < victim->lastUsed )
+      {
+        victim = entry;
+      }
+    }
+
+    free( victim->points );
+    free( victim->holeStarts );
+    free( victim->indices );
+
+    victim->hash       = hash;
+    victim->lastUsed   = ++cache->clock;
+    victim->pointCount = pointCount;
+    victim->holeCount  = holeCount;
+    victim->points     = (DK_vkVec2 *)malloc( pointCount * sizeof( DK_vkVec2 ) );
+    victim->holeStarts = holeCount > 0 ? (uint32_t *)malloc( holeCount * sizeof( uint32_t ) ) : NULL;
+
+    memcpy( victim->points, points, pointCount * sizeof( DK_vkVec2 ) );
+    if ( holeCount > 0 )
+    {
+      memcpy( victim->holeStarts, holeStarts, holeCount * sizeof( uint32_t ) );
+    }
+
+    victim->indexCount = DK_vkTriangulatePolygon( points, pointCount, holeStarts, holeCount, &victim->indices );
+
+    return victim;
+  }
+
+  // contour start tables must be strictly increasing and inside the point list
+  DK_VULKAN_FUNC bool
+  DK_vkValidateContourStarts( const uint32_t *starts, uint32_t count, uint32_t pointCount )
+  {
+    uint32_t previous = 0;
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+      if ( starts[i] <= previous || starts[i] >= pointCount )
+      {
+        return false;
+      }
+      previous = starts[i];
+    }
+
+    return true;
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawPolygonWithHoles( DK_vkApplication *app,
+                                                 const DK_vkVec2  *points,
+                                                 uint32_t          pointCount,
+                                                 const uint32_t   *holeStarts,
+                                                 uint32_t          holeCount,
+                                                 DK_vkColor        tint )
+  {
+    if ( pointCount < 3 || ( holeCount > 0 && holeStarts[0] < 3 ) )
+    {
+      return;
+    }
+
+    if ( !DK_vkValidateContourStarts( holeStarts, holeCount, pointCount ) )
+    {
+      fprintf( stderr, "Invalid polygon hole starts\n" );
+      return;
+    }
+
+    DK_vkPolygonCacheEntry *entry = DK_vkLookupPolygon( app, points, pointCount, holeStarts, holeCount );
+    if ( entry->indexCount == 0 || !DK_vkReserveBatch( app, pointCount, entry->indexCount ) )
+    {
+      return;
+    }
+
+    DK_vkRenderer *renderer  = &app->batchRenderer;
+    uint32_t       baseIndex = renderer->vertexCount;
+
+    for ( uint32_t i = 0; i < pointCount; i++ )
+    {
+      DK_vkAddVertex( renderer, points[i][0], points[i][1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    }
+
+    for ( uint32_t i = 0; i < entry->indexCount; i++ )
+    {
+      DK_vkAddIndex( renderer, baseIndex + entry->indices[i] );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawPolygon( DK_vkApplication *app,
+                                        const DK_vkVec2  *points,
+                                        uint32_t          pointCount,
+                                        DK_vkColor        tint )
+  {
+    if ( pointCount < 3 )
+    {
+      return;
+    }
+
+    if ( !DK_vkIsPolygonConvex( points, pointCount ) )
+    {
+      DK_vkDrawPolygonWithHoles( app, points, pointCount, NULL, 0, tint );
+      return;
+    }
+
+    // convex outlines are emitted as a fan, nothing worth caching
+    if ( !DK_vkReserveBatch( app, pointCount, ( pointCount - 2 ) * 3 ) )
+    {
+      return;
+    }
+
+    DK_vkRenderer *renderer  = &app->batchRenderer;
+    uint32_t       baseIndex = renderer->vertexCount;
+    bool           clockwise = DK_vkPolygonSignedArea( points, 0, pointCount ) > 0.0f;
+
+    for ( uint32_t i = 0; i < pointCount; i++ )
+    {
+      DK_vkAddVertex( renderer, points[i][0], points[i][1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    }
+
+    for ( uint32_t i = 1; i + 1 < pointCount; i++ )
+    {
+      DK_vkAddIndex( renderer, baseIndex );
+      DK_vkAddIndex( renderer, baseIndex + ( clockwise ? i : i + 1 ) );
+      DK_vkAddIndex( renderer, baseIndex + ( clockwise ? i + 1 : i ) );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyPolygonCache( DK_vkApplication *app )
+  {
+    DK_vkPolygonCache *cache = &app->polygonCache;
+    for ( uint32_t i = 0; i < DK_VK_POLYGON_CACHE_BUCKETS; i++ )
+    {
+      for ( uint32_t j = 0; j < DK_VK_POLYGON_CACHE_WAYS; j++ )
+      {
+        DK_vkPolygonCacheEntry *entry = &cache->entries[i][j];
+        free( entry->points );
+        free( entry->holeStarts );
+        free( entry->indices );
+        memset( entry, 0, sizeof( *entry ) );
+      }
+    }
+
+    cache->clock = 0;
+  }
+
+  // ========================================================================================
+  // STENCIL PATH FILLING
+  // ========================================================================================
+
+  DK_VULKAN_FUNC void DK_vkCreateStencilResources( DK_vkApplication *app )
+  {
+    if ( !enableStencilAttachment )
+    {
+      return;
+    }
+
+    DK_vkCreateImage( app,
+                      app->swapChainExtent.width,
+                      app->swapChainExtent.height,
+                      1,
+                      app->stencilFormat,
+                      VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &app->stencilImage,
+                      &app->stencilImageMemory );
+
+    VkImageViewCreateInfo viewInfo           = {};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = app->stencilImage;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = app->stencilFormat;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_STENCIL_BIT;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = 1;
+
+    // combined formats have to expose both aspects when used as an attachment
+    if ( app->stencilFormat != VK_FORMAT_S8_UINT )
+    {
+      viewInfo.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+
+    if ( vkCreateImageView( app->device, &viewInfo, NULL, &app->stencilImageView ) != VK_SUCCESS )
+    {
+      fprintf( stderr, "Failed to create stencil image view\n" );
+      exit( 1 );
+    }
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyStencilResources( DK_vkApplication *app )
+  {
+    if ( !enableStencilAttachment )
+    {
+      return;
+    }
+
+    vkDestroyPipeline( app->device, app->stencilFillPipeline, NULL );
+    vkDestroyPipeline( app->device, app->stencilCoverPipeline, NULL );
+    vkDestroyImageView( app->device, app->stencilImageView, NULL );
+    vkDestroyImage( app->device, app->stencilImage, NULL );
+    DK_vkFreeMemory( app, &app->stencilImageMemory );
+
+    app->stencilFillPipeline  = VK_NULL_HANDLE;
+    app->stencilCoverPipeline = VK_NULL_HANDLE;
+    app->stencilImageView     = VK_NULL_HANDLE;
+    app->stencilImage         = VK_NULL_HANDLE;
+  }
+
+  DK_VULKAN_FUNC DK_vkBatchCommand *DK_vkPushBatchCommand( DK_vkRenderer        *renderer,
+                                                           DK_vkBatchCommandType type,
+                                                           uint32_t              firstIndex,
+                                                           uint32_t              indexCount,
+                                                           uint32_t              stencilCompareMask )
+  {
+    if ( indexCount == 0 )
+    {
+      return NULL;
+    }
+
+    if ( renderer->commandCount == renderer->commandCapacity )
+    {
+      uint32_t           capacity = renderer->commandCapacity ? renderer->commandCapacity * 2 : 16;
+      DK_vkBatchCommand *commands =
+          (DK_vkBatchCommand *)realloc( renderer->commands, capacity * sizeof( DK_vkBatchCommand ) );
+      if ( commands == NULL )
+      {
+        fprintf( stderr, "Failed to grow batch command list\n" );
+        exit( 1 );
+      }
+
+      renderer->commands        = commands;
+      renderer->commandCapacity = capacity;
+    }
+
+    DK_vkBatchCommand *command  = &renderer->commands[renderer->commandCount++];
+    command->type               = type;
+    command->firstIndex         = firstIndex;
+    command->indexCount         = indexCount;
+    command->stencilCompareMask = stencilCompareMask;
+    command->textureTable       = renderer->textureTable;
+    command->vertexOffset       = 0;
+    command->firstInstance      = 0;
+    command->instanceCount      = 1;
+
+    return command;
+  }
+
+  DK_VULKAN_FUNC void DK_vkCloseBatchSegment( DK_vkRenderer *renderer )
+  {
+    DK_vkPushBatchCommand( renderer,
+                           DK_VK_BATCH_COMMAND_TRIANGLES,
+                           renderer->segmentStart,
+                           renderer->indexCount - renderer->segmentStart,
+                           0 );
+    renderer->segmentStart = renderer->indexCount;
+  }
 
-    DK_vkDrawRectangle( app, (DK_vkVec2){ x + radius, y }, (DK_vkSize){ width - 2 * radius, height }, tint );
+  /* Note: contourStarts lists where the second and later contours begin. Without a stencil attachment
+   * the path is triangulated on the cpu, which always treats the extra contours as holes, so nested
+   * contours with the same winding are cut out under DK_VK_FILL_RULE_NONZERO as well */
+  DK_VULKAN_FUNC void DK_vkDrawPath( DK_vkApplication *app,
+                                     const DK_vkVec2  *points,
+                                     uint32_t          pointCount,
+                                     const uint32_t   *contourStarts,
+                                     uint32_t          contourCount,
+                                     DK_vkFillRule     fillRule,
+                                     DK_vkColor        tint )
+  {
+    if ( pointCount < 3 )
+    {
+      return;
+    }
 
-    // l and r rectangles
-    DK_vkDrawRectangle( app, (DK_vkVec2){ x, y + radius }, (DK_vkSize){ radius, height - 2 * radius }, tint );
-    DK_vkDrawRectangle( app,
-                        (DK_vkVec2){ x + width - radius, y + radius },
-                        (DK_vkSize){ radius, height - 2 * radius },
-                        tint );
+    // the fan indices below address the vertices of this path only
+    if ( !DK_vkValidateContourStarts( contourStarts, contourCount, pointCount ) )
+    {
+      fprintf( stderr, "Invalid path contour starts\n" );
+      return;
+    }
 
-    // arch
-    int32_t segmentsPerCorner = segments / 4;
-    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    if ( !enableStencilAttachment )
     {
-      float startAngle = M_PI + ( i * M_PI / 2 ) / segmentsPerCorner;
-      float endAngle   = M_PI + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+      static bool warnedNonZero = false;
+      if ( fillRule == DK_VK_FILL_RULE_NONZERO && contourCount > 0 && !warnedNonZero )
+      {
+        fprintf( stderr, "Nonzero fill needs the stencil attachment, extra contours are drawn as holes\n" );
+        warnedNonZero = true;
+      }
 
-      float startX = x + radius + radius * cosf( startAngle );
-      float startY = y + radius + radius * sinf( startAngle );
-      float endX   = x + radius + radius * cosf( endAngle );
-      float endY   = y + radius + radius * sinf( endAngle );
+      DK_vkDrawPolygonWithHoles( app, points, pointCount, contourStarts, contourCount, tint );
+      return;
+    }
 
-      DK_vkVec2 p1 = { x + radius, y + radius };
-      DK_vkVec2 p2 = { startX, startY };
-      DK_vkVec2 p3 = { endX, endY };
-      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    // one fan triangle per edge around a shared anchor plus the cover quad
+    if ( !DK_vkReserveBatch( app, pointCount + 5, pointCount * 3 + 6 ) )
+    {
+      return;
     }
 
-    // tr corner
-    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    DK_vkRenderer *renderer = &app->batchRenderer;
+    DK_vkCloseBatchSegment( renderer );
+
+    uint32_t baseIndex = renderer->vertexCount;
+    float    minX = points[0][0], minY = points[0][1];
+    float    maxX = points[0][0], maxY = points[0][1];
+
+    DK_vkAddVertex( renderer, points[0][0], points[0][1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    for ( uint32_t i = 0; i < pointCount; i++ )
     {
-      float startAngle = M_PI * 1.5f + ( i * M_PI / 2 ) / segmentsPerCorner;
-      float endAngle   = M_PI * 1.5f + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+      DK_vkAddVertex( renderer, points[i][0], points[i][1], tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
 
-      float startX = x + width - radius + radius * cosf( startAngle );
-      float startY = y + radius + radius * sinf( startAngle );
-      float endX   = x + width - radius + radius * cosf( endAngle );
-      float endY   = y + radius + radius * sinf( endAngle );
+      minX = fminf( minX, points[i][0] );
+      minY = fminf( minY, points[i][1] );
+      maxX = fmaxf( maxX, points[i][0] );
+      maxY = fmaxf( maxY, points[i][1] );
+    }
 
-      DK_vkVec2 p1 = { x + width - radius, y + radius };
-      DK_vkVec2 p2 = { startX, startY };
-      DK_vkVec2 p3 = { endX, endY };
+    uint32_t firstIndex = renderer->indexCount;
+    for ( uint32_t contour = 0; contour <= contourCount; contour++ )
+    {
+      uint32_t begin = contour == 0 ? 0 : contourStarts[contour - 1];
+      uint32_t end   = contour == contourCount ? pointCount : contourStarts[contour];
 
-      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+      for ( uint32_t i = begin; i < end; i++ )
+      {
+        uint32_t next = i + 1 < end ? i + 1 : begin;
+        DK_vkAddIndex( renderer, baseIndex );
+        DK_vkAddIndex( renderer, baseIndex + 1 + i );
+        DK_vkAddIndex( renderer, baseIndex + 1 + next );
+      }
     }
 
-    // br corner
-    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    DK_vkPushBatchCommand( renderer,
+                           DK_VK_BATCH_COMMAND_STENCIL_FILL,
+                           firstIndex,
+                           renderer->indexCount - firstIndex,
+                           0 );
+
+    baseIndex  = renderer->vertexCount;
+    firstIndex = renderer->indexCount;
+
+    DK_vkAddVertex( renderer, minX, minY, tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, maxX, minY, tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, maxX, maxY, tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+    DK_vkAddVertex( renderer, minX, maxY, tint[0], tint[1], tint[2], tint[3], 0.0f, 0.0f, -1 );
+
+    DK_vkAddIndex( renderer, baseIndex );
+    DK_vkAddIndex( renderer, baseIndex + 1 );
+    DK_vkAddIndex( renderer, baseIndex + 2 );
+    DK_vkAddIndex( renderer, baseIndex + 2 );
+    DK_vkAddIndex( renderer, baseIndex + 3 );
+    DK_vkAddIndex( renderer, baseIndex );
+
+    // even-odd only looks at the lowest bit of the winding count
+    DK_vkPushBatchCommand( renderer,
+                           DK_VK_BATCH_COMMAND_STENCIL_COVER,
+                           firstIndex,
+                           6,
+                           fillRule == DK_VK_FILL_RULE_EVEN_ODD ? 0x01 : 0xFF );
+
+    renderer->segmentStart = renderer->indexCount;
+  }
+
+  // ========================================================================================
+  // SHAPE MESH CACHE
+  // ========================================================================================
+
+  DK_VULKAN_FUNC void DK_vkCreateShapeCache( DK_vkApplication *app )
+  {
+    DK_vkShapeCache *cache = &app->shapeCache;
+
+    DK_vkCreateBufferEx( app,
+                         sizeof( float ) * 2 * DK_VK_SHAPE_MESH_MAX_VERTICES,
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &cache->vertexBuffer,
+                         &cache->vertexBufferMemory );
+
+    DK_vkCreateBufferEx( app,
+                         sizeof( uint32_t ) * DK_VK_SHAPE_MESH_MAX_INDICES,
+                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &cache->indexBuffer,
+                         &cache->indexBufferMemory );
+
+    VkDeviceSize instanceBufferSize =
+        sizeof( DK_vkShapeInstance ) * DK_VK_SHAPE_MAX_INSTANCES * DK_VULKAN_MAX_FRAMES_IN_FLIGHT;
+    DK_vkCreateBufferEx( app,
+                         instanceBufferSize,
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &cache->instanceBuffer,
+                         &cache->instanceBufferMemory );
+    cache->instanceBufferMapped = (DK_vkShapeInstance *)cache->instanceBufferMemory.mapped;
+
+    cache->vertexCount   = 0;
+    cache->indexCount    = 0;
+    cache->instanceCount = 0;
+    cache->clock         = 0;
+    cache->batchClock    = 0;
+    memset( cache->meshes, 0, sizeof( cache->meshes ) );
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyShapeCache( DK_vkApplication *app )
+  {
+    DK_vkShapeCache *cache = &app->shapeCache;
+
+    vkDestroyBuffer( app->device, cache->vertexBuffer, NULL );
+    DK_vkFreeMemory( app, &cache->vertexBufferMemory );
+    vkDestroyBuffer( app->device, cache->indexBuffer, NULL );
+    DK_vkFreeMemory( app, &cache->indexBufferMemory );
+    vkDestroyBuffer( app->device, cache->instanceBuffer, NULL );
+    DK_vkFreeMemory( app, &cache->instanceBufferMemory );
+
+    memset( cache, 0, sizeof( *cache ) );
+  }
+
+  // unit meshes: circles have radius 1 around the origin, rounded rectangles span [0, 1] with
+  // elliptical corners so that scaling by the rectangle size turns them back into circular arcs
+  DK_VULKAN_FUNC uint32_t DK_vkTessellateShape( DK_vkShapeType type,
+                                                float          rx,
+                                                float          ry,
+                                                int32_t        segments,
+                                                float         *vertices,
+                                                uint32_t      *indices )
+  {
+    uint32_t count = 1;
+
+    if ( type == DK_VK_SHAPE_CIRCLE )
     {
-      float startAngle = 0.0f + ( i * M_PI / 2 ) / segmentsPerCorner;
-      float endAngle   = 0.0f + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+      vertices[0] = 0.0f;
+      vertices[1] = 0.0f;
 
-      float startX = x + width - radius + radius * cosf( startAngle );
-      float startY = y + height - radius + radius * sinf( startAngle );
-      float endX   = x + width - radius + radius * cosf( endAngle );
-      float endY   = y + height - radius + radius * sinf( endAngle );
+      for ( int32_t i = 0; i < segments; i++ )
+      {
+        float angle             = i * ( 2.0f * M_PI / segments );
+        vertices[count * 2]     = cosf( angle );
+        vertices[count * 2 + 1] = sinf( angle );
+        count++;
+      }
+    }
+    else
+    {
+      vertices[0] = 0.5f;
+      vertices[1] = 0.5f;
 
-      DK_vkVec2 p1 = { x + width - radius, y + height - radius };
-      DK_vkVec2 p2 = { startX, startY };
-      DK_vkVec2 p3 = { endX, endY };
+      int32_t segmentsPerCorner = segments / 4;
+      float   centers[4][2]     = { { rx, ry }, { 1.0f - rx, ry }, { 1.0f - rx, 1.0f - ry }, { rx, 1.0f - ry } };
 
-      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+      // tl, tr, br, bl with increasing angle, which is clockwise on screen
+      for ( int32_t corner = 0; corner < 4; corner++ )
+      {
+        float startAngle = M_PI + corner * M_PI / 2;
+        for ( int32_t i = 0; i <= segmentsPerCorner; i++ )
+        {
+          float angle             = startAngle + ( i * M_PI / 2 ) / segmentsPerCorner;
+          vertices[count * 2]     = centers[corner][0] + rx * cosf( angle );
+          vertices[count * 2 + 1] = centers[corner][1] + ry * sinf( angle );
+          count++;
+        }
+      }
     }
 
-    // bl corner
-    for ( int32_t i = 0; i < segmentsPerCorner; i++ )
+    uint32_t outline = count - 1;
+    for ( uint32_t i = 0; i < outline; i++ )
     {
-      float startAngle = M_PI / 2 + ( i * M_PI / 2 ) / segmentsPerCorner;
-      float endAngle   = M_PI / 2 + ( ( i + 1 ) * M_PI / 2 ) / segmentsPerCorner;
+      indices[i * 3]     = 0;
+      indices[i * 3 + 1] = 1 + i;
+      indices[i * 3 + 2] = 1 + ( i + 1 ) % outline;
+    }
 
-      float startX = x + radius + radius * cosf( startAngle );
-      float startY = y + height - radius + radius * sinf( startAngle );
-      float endX   = x + radius + radius * cosf( endAngle );
-      float endY   = y + height - radius + radius * sinf( endAngle );
+    return outline;
+  }
 
-      DK_vkVec2 p1 = { x + radius, y + height - radius };
-      DK_vkVec2 p2 = { startX, startY };
-      DK_vkVec2 p3 = { endX, endY };
+  DK_VULKAN_FUNC DK_vkShapeMesh *
+  DK_vkFindShapeMesh( DK_vkApplication *app, DK_vkShapeType type, uint32_t rx, uint32_t ry, int32_t segments )
+  {
+    DK_vkShapeCache *cache = &app->shapeCache;
 
-      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    uint64_t key  = ( (uint64_t)type << 48 ) | ( (uint64_t)( segments & 0xFFFF ) << 32 ) | ( (uint64_t)rx << 16 ) | ry;
+    uint32_t slot = (uint32_t)( DK_vkHashBytes( &key, sizeof( key ), DK_VK_HASH_SEED ) % DK_VK_SHAPE_MESH_CACHE_SIZE );
+
+    uint32_t outline     = type == DK_VK_SHAPE_CIRCLE ? (uint32_t)segments : 4 * ( segments / 4 + 1 );
+    uint32_t vertexCount = outline + 1;
+    uint32_t indexCount  = outline * 3;
+
+    /* Note: entries are never emptied, so probing stops at the first free slot. A victim comes from the
+     * probed slots to stay reachable from this key, must have room for the mesh and must not have been
+     * drawn since the last batch began, the open or just submitted batch may still read its storage */
+    DK_vkShapeMesh *mesh   = NULL;
+    DK_vkShapeMesh *victim = NULL;
+    for ( uint32_t probe = 0; probe < DK_VK_SHAPE_MESH_CACHE_SIZE; probe++ )
+    {
+      DK_vkShapeMesh *candidate = &cache->meshes[( slot + probe ) % DK_VK_SHAPE_MESH_CACHE_SIZE];
+      if ( !candidate->used )
+      {
+        mesh = candidate;
+        break;
+      }
+
+      if ( candidate->key == key )
+      {
+        candidate->lastUsed = ++cache->clock;
+        return candidate;
+      }
+
+      bool replaceable = candidate->lastUsed <= cache->batchClock &&
+                         candidate->vertexCapacity >= vertexCount && candidate->indexCapacity >= indexCount;
+      if ( replaceable && ( victim == NULL || candidate->lastUsed < victim->lastUsed ) )
+      {
+        victim = candidate;
+      }
+    }
+
+    bool fits = cache->vertexCount + vertexCount <= DK_VK_SHAPE_MESH_MAX_VERTICES &&
+                cache->indexCount + indexCount <= DK_VK_SHAPE_MESH_MAX_INDICES;
+    if ( mesh != NULL && fits )
+    {
+      mesh->vertexOffset   = (int32_t)cache->vertexCount;
+      mesh->firstIndex     = cache->indexCount;
+      mesh->vertexCapacity = vertexCount;
+      mesh->indexCapacity  = indexCount;
+      cache->vertexCount += vertexCount;
+      cache->indexCount += indexCount;
     }
+    else if ( victim != NULL )
+    {
+      mesh = victim;
+    }
+    else
+    {
+      // nothing can be replaced, the caller falls back to cpu tessellation
+      return NULL;
+    }
+
+    VkDeviceSize vertexSize = sizeof( float ) * 2 * vertexCount;
+    VkDeviceSize indexSize  = sizeof( uint32_t ) * indexCount;
+
+    DK_vkStagingAllocation staging = DK_vkAllocateStaging( app, vertexSize + indexSize );
+
+    unsigned char *data = (unsigned char *)staging.data;
+    DK_vkTessellateShape( type,
+                          (float)rx / DK_VK_SHAPE_RATIO_STEPS,
+                          (float)ry / DK_VK_SHAPE_RATIO_STEPS,
+                          segments,
+                          (float *)data,
+                          (uint32_t *)( data + vertexSize ) );
+
+    DK_vkCopyBufferRegion( app,
+                           staging.buffer,
+                           cache->vertexBuffer,
+                           staging.offset,
+                           sizeof( float ) * 2 * (uint32_t)mesh->vertexOffset,
+                           vertexSize );
+    DK_vkCopyBufferRegion( app,
+                           staging.buffer,
+                           cache->indexBuffer,
+                           staging.offset + vertexSize,
+                           sizeof( uint32_t ) * mesh->firstIndex,
+                           indexSize );
+
+    mesh->key        = key;
+    mesh->lastUsed   = ++cache->clock;
+    mesh->used       = true;
+    mesh->indexCount = indexCount;
+
+    return mesh;
   }
 
-  DK_VULKAN_FUNC void DK_vkDrawGradientRectangle( DK_vkApplication *app,
-                                                  DK_vkVec2         position,
-                                                  DK_vkSize         size,
-                                                  DK_vkColor        tint_bl,
-                                                  DK_vkColor        tint_br,
-                                                  DK_vkColor        tint_tr,
-                                                  DK_vkColor        tint_tl )
+  // circles are centred on position, rounded rectangles span position and size
+  DK_VULKAN_FUNC bool DK_vkDrawCachedShape( DK_vkApplication *app,
+                                            DK_vkShapeType    type,
+                                            DK_vkVec2         position,
+                                            DK_vkSize         size,
+                                            float             radius,
+                                            DK_vkColor        tint,
+                                            int32_t           segments )
   {
+    uint32_t rx = 0, ry = 0;
+    float    scale[2];
 
-    DK_vkRenderer *renderer = &app->batchRenderer;
+    if ( type == DK_VK_SHAPE_CIRCLE )
+    {
+      scale[0] = radius;
+      scale[1] = radius;
+    }
+    else
+    {
+      if ( size[0] <= 0.0f || size[1] <= 0.0f )
+      {
+        return true;
+      }
+
+      radius   = fmaxf( 0.0f, fminf( radius, fminf( size[0], size[1] ) * 0.5f ) );
+      rx       = (uint32_t)( radius / size[0] * DK_VK_SHAPE_RATIO_STEPS + 0.5f );
+      ry       = (uint32_t)( radius / size[1] * DK_VK_SHAPE_RATIO_STEPS + 0.5f );
+      scale[0] = size[0];
+      scale[1] = size[1];
+    }
+
+    DK_vkShapeMesh *mesh = DK_vkFindShapeMesh( app, type, rx, ry, segments );
+    if ( mesh == NULL )
+    {
+      return false;
+    }
+
+    DK_vkRenderer   *renderer = &app->batchRenderer;
+    DK_vkShapeCache *cache    = &app->shapeCache;
 
     if ( !renderer->hasBegun )
     {
       DK_vkBeginBatch( app );
     }
 
-    if ( renderer->vertexCount + 4 > MAX_BATCH_VERTICES || renderer->indexCount + 6 > MAX_BATCH_INDICES )
+    if ( cache->instanceCount + 1 > DK_VK_SHAPE_MAX_INSTANCES )
     {
       DK_vkFlushBatch( app );
       DK_vkBeginBatch( app );
     }
 
-    DK_vkVec2 p1 = { position[0], position[1] };
-    DK_vkVec2 p2 = { position[0] + size[0], position[1] };
-    DK_vkVec2 p3 = { position[0] + size[0], position[1] + size[1] };
-    DK_vkVec2 p4 = { position[0], position[1] + size[1] };
+    DK_vkCloseBatchSegment( renderer );
 
-    uint32_t baseIndex = renderer->vertexCount;
+    uint32_t            frameStart    = app->currentFrame * DK_VK_SHAPE_MAX_INSTANCES;
+    uint32_t            instanceIndex = cache->instanceCount++;
+    DK_vkShapeInstance *instance      = &cache->instanceBufferMapped[frameStart + instanceIndex];
+    instance->offset[0]               = position[0];
+    instance->offset[1]               = position[1];
+    instance->scale[0]                = scale[0];
+    instance->scale[1]                = scale[1];
+    memcpy( instance->color, tint, sizeof( float ) * 4 );
 
-    // bl
-    uint32_t   idx1 = renderer->vertexCount;
-    DK_Vertex *v1   = &renderer->vertexBufferMapped[renderer->vertexCount++];
-    v1->pos[0]      = p1[0];
-    v1->pos[1]      = p1[1];
-    memcpy( v1->color, tint_bl, sizeof( float ) * 4 );
-    v1->texCoord[0] = 0.0f;
-    v1->texCoord[1] = 0.0f;
+    // back to back draws of the same mesh extend the previous instanced draw
+    DK_vkBatchCommand *last = renderer->commandCount > 0 ? &renderer->commands[renderer->commandCount - 1] : NULL;
+    if ( last != NULL && last->type == DK_VK_BATCH_COMMAND_SHAPE_INSTANCES &&
+         last->firstIndex == mesh->firstIndex && last->firstInstance + last->instanceCount == instanceIndex )
+    {
+      last->instanceCount++;
+      return true;
+    }
 
-    // br
-    uint32_t   idx2 = renderer->vertexCount;
-    DK_Vertex *v2   = &renderer->vertexBufferMapped[renderer->vertexCount++];
-    v2->pos[0]      = p2[0];
-    v2->pos[1]      = p2[1];
-    memcpy( v2->color, tint_br, sizeof( float ) * 4 );
-    v2->texCoord[0] = 1.0f;
-    v2->texCoord[1] = 0.0f;
+    DK_vkBatchCommand *command =
+        DK_vkPushBatchCommand( renderer, DK_VK_BATCH_COMMAND_SHAPE_INSTANCES, mesh->firstIndex, mesh->indexCount, 0 );
+    command->vertexOffset  = mesh->vertexOffset;
+    command->firstInstance = instanceIndex;
+    command->instanceCount = 1;
 
-    // tr
-    uint32_t   idx3 = renderer->vertexCount;
-    DK_Vertex *v3   = &renderer->vertexBufferMapped[renderer->vertexCount++];
-    v3->pos[0]      = p3[0];
-    v3->pos[1]      = p3[1];
-    memcpy( v1->color, tint_tr, sizeof( float ) * 4 );
-    v3->texCoord[0] = 1.0f;
-    v3->texCoord[1] = 1.0f;
+    return true;
+  }
+
+  // ========================================================================================
+  // TEXTURE ATLAS
+  // ========================================================================================
+
+  DK_VULKAN_FUNC DK_vkAtlas DK_vkCreateAtlas( DK_vkApplication *app, uint32_t pageSize )
+  {
+    DK_vkAtlas atlas = { 0 };
+    atlas.pageSize   = pageSize > 0 ? pageSize : DK_VK_ATLAS_PAGE_SIZE;
+    return atlas;
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyAtlas( DK_vkApplication *app, DK_vkAtlas *atlas )
+  {
+    for ( uint32_t i = 0; i < atlas->pageCount; i++ )
+    {
+      DK_vkRemoveTexture( app, atlas->pages[i].textureId );
+      free( atlas->pages[i].skyline );
+    }
+
+    free( atlas->pages );
+    free( atlas->regions );
+
+    atlas->pages          = NULL;
+    atlas->pageCount      = 0;
+    atlas->regions        = NULL;
+    atlas->regionCount    = 0;
+    atlas->regionCapacity = 0;
+  }
+
+  DK_VULKAN_FUNC bool DK_vkAddAtlasPage( DK_vkApplication *app, DK_vkAtlas *atlas )
+  {
+    // checked up front, the clear may be deferred into an open upload batch that still needs the image
+    if ( !DK_vkHasFreeTextureSlot( app ) )
+    {
+      fprintf( stderr, "Maximum texture count reached, cannot add atlas page\n" );
+      return false;
+    }
+
+    DK_vkTexture texture = { 0 };
+    texture.width        = atlas->pageSize;
+    texture.height       = atlas->pageSize;
+    texture.channels     = 4;
+    texture.isActive     = true;
+
+    DK_vkCreateImage( app,
+                      atlas->pageSize,
+                      atlas->pageSize,
+                      1,
+                      VK_FORMAT_R8G8B8A8_SRGB,
+                      VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &texture.image,
+                      &texture.memory );
+
+    DK_vkTransitionImageLayout( app,
+                                texture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+
+    // the padding between packed images has to stay transparent
+    VkCommandBuffer         commandBuffer = DK_vkBeginSingleTimeCommands( app );
+    VkClearColorValue       clearColor    = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+    VkImageSubresourceRange range         = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdClearColorImage(
+        commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range );
+    DK_vkEndSingleTimeCommands( app, commandBuffer );
+
+    DK_vkTransitionImageLayout( app,
+                                texture.image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+    DK_vkCreateTextureImageView( app, texture.image, &texture.view );
+    DK_vkCreatePackedTextureSampler( app, &texture.sampler );
+
+    DK_vkAtlasPage page = { 0 };
+    page.textureId      = DK_vkRegisterTexture( app, texture );
+
+    // every node is at least one texel wide, so a page never holds more than pageSize nodes
+    page.skyline      = (DK_vkSkylineNode *)malloc( atlas->pageSize * sizeof( DK_vkSkylineNode ) );
+    page.skyline[0]   = (DK_vkSkylineNode){ 0, 0, atlas->pageSize };
+    page.skylineCount = 1;
+
+    atlas->pages =
+        (DK_vkAtlasPage *)realloc( atlas->pages, ( atlas->pageCount + 1 ) * sizeof( DK_vkAtlasPage ) );
+    atlas->pages[atlas->pageCount++] = page;
+    return true;
+  }
+
+  // returns the y a rect placed at the given skyline node would rest on, or -1 if it does not fit
+  DK_VULKAN_FUNC int32_t DK_vkSkylineFit( DK_vkAtlasPage *page,
+                                          uint32_t        pageSize,
+                                          uint32_t        node,
+                                          uint32_t        width,
+                                          uint32_t        height )
+  {
+    if ( page->skyline[node].x + width > pageSize )
+    {
+      return -1;
+    }
+
+    uint32_t y         = 0;
+    int32_t  remaining = (int32_t)width;
+    for ( uint32_t i = node; remaining > 0; i++ )
+    {
+      if ( i >= page->skylineCount )
+      {
+        return -1;
+      }
+
+      y = page->skyline[i].y > y ? page->skyline[i].y : y;
+      if ( y + height > pageSize )
+      {
+        return -1;
+      }
+
+      remaining -= (int32_t)page->skyline[i].width;
+    }
+
+    return (int32_t)y;
+  }
+
+  /* Note: bottom-left skyline packing, the rect goes where its top edge ends up lowest and the
+   * skyline nodes it covers are replaced by a single node at its top */
+  DK_VULKAN_FUNC bool DK_vkSkylinePack( DK_vkAtlasPage *page,
+                                        uint32_t        pageSize,
+                                        uint32_t        width,
+                                        uint32_t        height,
+                                        uint32_t       *outX,
+                                        uint32_t       *outY )
+  {
+    int32_t  bestNode   = -1;
+    uint32_t bestBottom = UINT32_MAX;
+    uint32_t bestX      = 0;
+    uint32_t bestY      = 0;
+
+    for ( uint32_t i = 0; i < page->skylineCount; i++ )
+    {
+      int32_t y = DK_vkSkylineFit( page, pageSize, i, width, height );
+      if ( y >= 0 && (uint32_t)y + height < bestBottom )
+      {
+        bestNode   = (int32_t)i;
+        bestBottom = (uint32_t)y + height;
+        bestX      = page->skyline[i].x;
+        bestY      = (uint32_t)y;
+      }
+    }
+
+    if ( bestNode < 0 )
+    {
+      return false;
+    }
 
-    // tl
-    uint32_t   idx4 = renderer->vertexCount;
-    DK_Vertex *v4   = &renderer->vertexBufferMapped[renderer->vertexCount++];
-    v4->pos[0]      = p4[0];
-    v4->pos[1]      = p4[1];
-    memcpy( v1->color, tint_tl, sizeof( float ) * 4 );
-    v4->texCoord[0] = 0.0f;
-    v4->texCoord[1] = 1.0f;
+    DK_vkSkylineNode *skyline = page->skyline;
+    memmove( &skyline[bestNode + 1],
+             &skyline[bestNode],
+             ( page->skylineCount - bestNode ) * sizeof( DK_vkSkylineNode ) );
+    skyline[bestNode] = (DK_vkSkylineNode){ bestX, bestBottom, width };
+    page->skylineCount++;
 
-    if ( renderer->indexCount + 6 <= MAX_BATCH_INDICES )
+    // shrink or drop the nodes now hidden below the new one
+    for ( uint32_t i = bestNode + 1; i < page->skylineCount; i++ )
     {
-      DK_vkAddIndex( renderer, idx1 );
-      DK_vkAddIndex( renderer, idx2 );
-      DK_vkAddIndex( renderer, idx3 );
+      uint32_t previousEnd = skyline[i - 1].x + skyline[i - 1].width;
+      if ( skyline[i].x >= previousEnd )
+      {
+        break;
+      }
 
-      DK_vkAddIndex( renderer, idx1 );
-      DK_vkAddIndex( renderer, idx3 );
-      DK_vkAddIndex( renderer, idx4 );
+      uint32_t shrink = previousEnd - skyline[i].x;
+      if ( skyline[i].width > shrink )
+      {
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+        break;
+      }
+
+      memmove( &skyline[i], &skyline[i + 1], ( page->skylineCount - i - 1 ) * sizeof( DK_vkSkylineNode ) );
+      page->skylineCount--;
+      i--;
     }
-    else
+
+    // merge neighbours at the same height
+    for ( uint32_t i = 0; i + 1 < page->skylineCount; i++ )
     {
-      printf( "Warning: Index buffer overflow in DK_vkDrawGradientRectangle!\n" );
+      if ( skyline[i].y == skyline[i + 1].y )
+      {
+        skyline[i].width += skyline[i + 1].width;
+        memmove(
+            &skyline[i + 1], &skyline[i + 2], ( page->skylineCount - i - 2 ) * sizeof( DK_vkSkylineNode ) );
+        page->skylineCount--;
+        i--;
+      }
     }
+
+    *outX = bestX;
+    *outY = bestY;
+    return true;
   }
 
-  DK_VULKAN_FUNC void DK_vkDrawCircle( DK_vkApplication *app,
-                                       DK_vkVec2         position,
-                                       float             radius,
-                                       DK_vkColor        tint,
-                                       int32_t           segments )
+  DK_VULKAN_FUNC uint32_t DK_vkAtlasAddPixels( DK_vkApplication    *app,
+                                               DK_vkAtlas          *atlas,
+                                               const unsigned char *pixels,
+                                               uint32_t             width,
+                                               uint32_t             height )
   {
-    if ( segments < 3 )
+    uint32_t paddedWidth  = width + DK_VK_ATLAS_PADDING * 2;
+    uint32_t paddedHeight = height + DK_VK_ATLAS_PADDING * 2;
+
+    if ( width == 0 || height == 0 || paddedWidth > atlas->pageSize || paddedHeight > atlas->pageSize )
     {
-      segments = 3;
+      fprintf(
+          stderr, "Image of %ux%u does not fit in an atlas page of %u\n", width, height, atlas->pageSize );
+      return DK_VK_ATLAS_INVALID_REGION;
     }
 
-    float vertices[segments * 2];
+    // try the existing pages first, open a new page only when none of them has room
+    uint32_t page = 0;
+    uint32_t x    = 0;
+    uint32_t y    = 0;
+    while ( page < atlas->pageCount &&
+            !DK_vkSkylinePack( &atlas->pages[page], atlas->pageSize, paddedWidth, paddedHeight, &x, &y ) )
+    {
+      page++;
+    }
 
-    for ( int32_t i = 0; i < segments; i++ )
+    if ( page == atlas->pageCount )
     {
-      float angle         = i * ( 2.0f * M_PI / segments );
-      vertices[i * 2]     = position[0] + radius * cosf( angle );
-      vertices[i * 2 + 1] = position[1] + radius * sinf( angle );
+      if ( !DK_vkAddAtlasPage( app, atlas ) ||
+           !DK_vkSkylinePack( &atlas->pages[page], atlas->pageSize, paddedWidth, paddedHeight, &x, &y ) )
+      {
+        return DK_VK_ATLAS_INVALID_REGION;
+      }
     }
 
-    for ( int32_t i = 0; i < segments; i++ )
+    x += DK_VK_ATLAS_PADDING;
+    y += DK_VK_ATLAS_PADDING;
+
+    VkDeviceSize imageSize = (VkDeviceSize)width * height * 4;
+
+    DK_vkStagingAllocation staging = DK_vkStageData( app, pixels, imageSize );
+
+    VkImage image = DK_vkGetTexture( app, atlas->pages[page].textureId )->image;
+    DK_vkTransitionImageLayout( app,
+                                image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+
+    DK_vkCopyBufferToImageRegion(
+        app, staging.buffer, staging.offset, image, (int32_t)x, (int32_t)y, width, height );
+
+    DK_vkTransitionImageLayout( app,
+                                image,
+                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+    if ( atlas->regionCount == atlas->regionCapacity )
     {
-      int32_t nextI = ( i + 1 ) % segments;
+      atlas->regionCapacity = atlas->regionCapacity ? atlas->regionCapacity * 2 : 64;
+      atlas->regions =
+          (DK_vkAtlasRegion *)realloc( atlas->regions, atlas->regionCapacity * sizeof( DK_vkAtlasRegion ) );
+    }
 
-      DK_vkColor p1 = { position[0], position[1] };
-      DK_vkColor p2 = { vertices[i * 2], vertices[i * 2 + 1] };
-      DK_vkColor p3 = { vertices[nextI * 2], vertices[nextI * 2 + 1] };
+    float pageSize = (float)atlas->pageSize;
 
-      DK_vkDrawTriangle( app, p1, p2, p3, tint );
+    DK_vkAtlasRegion *region = &atlas->regions[atlas->regionCount];
+    region->textureId        = atlas->pages[page].textureId;
+    region->position[0]      = (float)x;
+    region->position[1]      = (float)y;
+    region->size[0]          = (float)width;
+    region->size[1]          = (float)height;
+    region->uv[0]            = x / pageSize;
+    region->uv[1]            = y / pageSize;
+    region->uv[2]            = ( x + width ) / pageSize;
+    region->uv[3]            = ( y + height ) / pageSize;
+
+    return atlas->regionCount++;
+  }
+
+  DK_VULKAN_FUNC uint32_t DK_vkAtlasAddImage( DK_vkApplication *app, DK_vkAtlas *atlas, const char *filename )
+  {
+    DK_vkImageData image = { 0 };
+    if ( !DK_vkDecodeImageFile( filename, &image ) )
+    {
+      fprintf( stderr, "Failed to load atlas image: %s\n", filename );
+      return DK_VK_ATLAS_INVALID_REGION;
     }
+
+    uint32_t region =
+        DK_vkAtlasAddPixels( app, atlas, image.pixels, (uint32_t)image.width, (uint32_t)image.height );
+    DK_vkFreeImage( &image );
+    return region;
   }
 
-  DK_VULKAN_FUNC void
-  DK_vkDrawLine( DK_vkApplication *app, DK_vkVec2 begin, DK_vkVec2 end, float thickness, DK_vkColor tint )
+  DK_VULKAN_FUNC DK_vkAtlasRegion *DK_vkGetAtlasRegion( DK_vkAtlas *atlas, uint32_t region )
   {
-    float dx     = end[0] - begin[0];
-    float dy     = end[1] - begin[1];
-    float length = sqrtf( dx * dx + dy * dy );
+    return region < atlas->regionCount ? &atlas->regions[region] : NULL;
+  }
 
-    if ( length < 0.001f )
+  DK_VULKAN_FUNC void DK_vkDrawAtlasRegion( DK_vkApplication *app,
+                                            DK_vkAtlas       *atlas,
+                                            uint32_t          region,
+                                            DK_vkVec2         position,
+                                            DK_vkSize         size,
+                                            DK_vkColor        tint )
+  {
+    DK_vkAtlasRegion *atlasRegion = DK_vkGetAtlasRegion( atlas, region );
+    if ( !atlasRegion )
     {
-      DK_vkDrawRectangle( app,
-                          (DK_vkVec2){ begin[0] - thickness / 2, begin[1] - thickness / 2 },
-                          (DK_vkSize){ thickness, thickness },
-                          tint );
+      fprintf( stderr, "Invalid atlas region\n" );
       return;
     }
 
-    float nx = dx / length;
-    float ny = dy / length;
+    DK_vkDrawTextureRegion(
+        app, position, size, atlasRegion->textureId, atlasRegion->position, atlasRegion->size, tint );
+  }
 
-    // perpendicular vector (rotated 90 degrees)
-    float px = -ny;
-    float py = nx;
-    float ht = thickness * 0.5f;
+  // ========================================================================================
+  // SHADOWS
+  // ========================================================================================
+
+  DK_VULKAN_FUNC void DK_vkCreateShadowBatch( DK_vkApplication *app )
+  {
+    DK_vkShadowBatch *batch = &app->shadowBatch;
+
+    VkDeviceSize instanceBufferSize =
+        sizeof( DK_vkShadowInstance ) * DK_VK_SHADOW_MAX_INSTANCES * DK_VULKAN_MAX_FRAMES_IN_FLIGHT;
+    DK_vkCreateBufferEx( app,
+                         instanceBufferSize,
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         DK_VK_MEMORY_POOL_LINEAR,
+                         &batch->instanceBuffer,
+                         &batch->instanceBufferMemory );
+    batch->instanceBufferMapped = (DK_vkShadowInstance *)batch->instanceBufferMemory.mapped;
+
+    batch->instanceCount = 0;
+  }
+
+  DK_VULKAN_FUNC void DK_vkDestroyShadowBatch( DK_vkApplication *app )
+  {
+    DK_vkShadowBatch *batch = &app->shadowBatch;
+
+    vkDestroyBuffer( app->device, batch->instanceBuffer, NULL );
+    DK_vkFreeMemory( app, &batch->instanceBufferMemory );
+
+    memset( batch, 0, sizeof( *batch ) );
+  }
+
+  /* Note: the shadow is the rectangle convolved with a gaussian of standard deviation blur, evaluated
+   * in closed form per fragment ( see shadow.frag ), the quad is grown by 3 sigma to hold the falloff */
+  DK_VULKAN_FUNC void DK_vkDrawShadowRoundedRect( DK_vkApplication *app,
+                                                  DK_vkVec2         position,
+                                                  DK_vkSize         size,
+                                                  float             radius,
+                                                  float             blur,
+                                                  DK_vkColor        color )
+  {
+    if ( size[0] <= 0.0f || size[1] <= 0.0f )
+    {
+      return;
+    }
+
+    DK_vkRenderer    *renderer = &app->batchRenderer;
+    DK_vkShadowBatch *batch    = &app->shadowBatch;
 
-    DK_vkRenderer *renderer = &app->batchRenderer;
     if ( !renderer->hasBegun )
     {
       DK_vkBeginBatch( app );
     }
 
-    if ( renderer->vertexCount + 4 > MAX_BATCH_VERTICES || renderer->indexCount + 6 > MAX_BATCH_INDICES )
+    if ( batch->instanceCount + 1 > DK_VK_SHADOW_MAX_INSTANCES )
     {
       DK_vkFlushBatch( app );
       DK_vkBeginBatch( app );
     }
 
-    uint32_t baseIndex = renderer->vertexCount;
-
-    // bl
-    DK_vkAddVertex( renderer,
-                    begin[0] - px * ht,
-                    begin[1] - py * ht,
-                    tint[0],
-                    tint[1],
-                    tint[2],
-                    tint[3],
-                    0.0f,
-                    0.0f,
-                    -1 );
-
-    // br
-    DK_vkAddVertex( renderer,
-                    end[0] - px * ht,
-                    end[1] - py * ht,
-                    tint[0],
-                    tint[1],
-                    tint[2],
-                    tint[3],
-                    1.0f,
-                    0.0f,
-                    -1 );
+    DK_vkCloseBatchSegment( renderer );
 
-    // tr
-    DK_vkAddVertex( renderer,
-                    end[0] + px * ht,
-                    end[1] + py * ht,
-                    tint[0],
-                    tint[1],
-                    tint[2],
-                    tint[3],
-                    1.0f,
-                    1.0f,
-                    -1 );
+    uint32_t             frameStart    = app->currentFrame * DK_VK_SHADOW_MAX_INSTANCES;
+    uint32_t             instanceIndex = batch->instanceCount++;
+    DK_vkShadowInstance *instance      = &batch->instanceBufferMapped[frameStart + instanceIndex];
+    instance->rect[0]                  = position[0];
+    instance->rect[1]                  = position[1];
+    instance->rect[2]                  = size[0];
+    instance->rect[3]                  = size[1];
+    instance->radius                   = fmaxf( 0.0f, fminf( radius, fminf( size[0], size[1] ) * 0.5f ) );
+    instance->sigma                    = fmaxf( blur, 0.01f );
+    memcpy( instance->color, color, sizeof( float ) * 4 );
 
-    // tl
-    DK_vkAddVertex( renderer,
-                    begin[0] + px * ht,
-                    begin[1] + py * ht,
-                    tint[0],
-                    tint[1],
-                    tint[2],
-                    tint[3],
-                    0.0f,
-                    1.0f,
-                    -1 );
+    DK_vkBatchCommand *last = renderer->commandCount > 0 ? &renderer->commands[renderer->commandCount - 1] : NULL;
+    if ( last != NULL && last->type == DK_VK_BATCH_COMMAND_SHADOW_INSTANCES &&
+         last->firstInstance + last->instanceCount == instanceIndex )
+    {
+      last->instanceCount++;
+      return;
+    }
 
-    DK_vkAddIndex( renderer, baseIndex );
-    DK_vkAddIndex( renderer, baseIndex + 1 );
-    DK_vkAddIndex( renderer, baseIndex + 2 );
+    // index count is unused for shadows but keeps the command from being dropped as empty
+    DK_vkBatchCommand *command = DK_vkPushBatchCommand( renderer, DK_VK_BATCH_COMMAND_SHADOW_INSTANCES, 0, 6, 0 );
+    command->firstInstance     = instanceIndex;
+    command->instanceCount     = 1;
+  }
 
-    DK_vkAddIndex( renderer, baseIndex );
-    DK_vkAddIndex( renderer, baseIndex + 2 );
-    DK_vkAddIndex( renderer, baseIndex + 3 );
+  DK_VULKAN_FUNC void DK_vkDrawShadowRect( DK_vkApplication *app,
+                                           DK_vkVec2         position,
+                                           DK_vkSize         size,
+                                           float             blur,
+                                           DK_vkColor        color )
+  {
+    DK_vkDrawShadowRoundedRect( app, position, size, 0.0f, blur, color );
   }
 
   DK_VULKAN_FUNC void DK_vkDrawTexturedQuad( DK_vkApplication *app,
@@ -3409,6 +9659,18 @@ extern "C"
                                              DK_vkVec2         uv2,
                                              DK_vkColor        tint,
                                              int32_t           samplerId )
+  {
+    DK_vkDrawTexturedQuadLayer( app, position, size, uv1, uv2, tint, (uint32_t)samplerId, 0 );
+  }
+
+  DK_VULKAN_FUNC void DK_vkDrawTexturedQuadLayer( DK_vkApplication *app,
+                                                  DK_vkVec2         position,
+                                                  DK_vkSize         size,
+                                                  DK_vkVec2         uv1,
+                                                  DK_vkVec2         uv2,
+                                                  DK_vkColor        tint,
+                                                  uint32_t          textureId,
+                                                  uint32_t          layer )
   {
     DK_vkRenderer *renderer = &app->batchRenderer;
     if ( !renderer->hasBegun )
@@ -3422,6 +9684,15 @@ extern "C"
       DK_vkBeginBatch( app );
     }
 
+    // callers pass the texture handle, the vertices carry the slot it was given in this batch and the layer
+    uint32_t index = DK_vkGetTextureIndex( app, textureId );
+    DK_vkTouchTexture( app, index );
+    int32_t samplerId = DK_vkAcquireTextureSlot( app, index );
+    if ( samplerId > 0 )
+    {
+      samplerId |= (int32_t)( layer << DK_VK_TEXTURE_LAYER_SHIFT );
+    }
+
     DK_vkVec2 p1 = { position[0], position[1] };
     DK_vkVec2 p2 = { position[0] + size[0], position[1] };
     DK_vkVec2 p3 = { position[0] + size[0], position[1] + size[1] };
@@ -3491,16 +9762,16 @@ extern "C"
                                         float             scale,
                                         DK_vkColor        tint )
   {
-    if ( textureId >= app->textureCount )
+    DK_vkTexture *texture = DK_vkGetTexture( app, textureId );
+    if ( texture == NULL )
     {
       fprintf( stderr, "Invalid texture ID\n" );
       return;
     }
 
     DK_vkSetTexture( app, textureId );
-    DK_vkTexture *texture = &app->textures[textureId];
-    float         width   = texture->width * scale;
-    float         height  = texture->height * scale;
+    float width  = texture->width * scale;
+    float height = texture->height * scale;
 
     DK_vkSize size = { width, height };
     DK_vkVec2 uv1  = { 0.0f, 0.0f };
@@ -3509,6 +9780,35 @@ extern "C"
     DK_vkDrawTexturedQuad( app, position, size, uv1, uv2, tint, textureId );
   }
 
+  DK_VULKAN_FUNC void DK_vkDrawTextureLayer( DK_vkApplication *app,
+                                             DK_vkVec2         position,
+                                             uint32_t          textureId,
+                                             uint32_t          layer,
+                                             float             scale,
+                                             DK_vkColor        tint )
+  {
+    DK_vkTexture *texture = DK_vkGetTexture( app, textureId );
+    if ( texture == NULL )
+    {
+      fprintf( stderr, "Invalid texture ID\n" );
+      return;
+    }
+
+    if ( layer > 0 && layer >= texture->layerCount )
+    {
+      fprintf( stderr, "Invalid texture layer %u\n", layer );
+      return;
+    }
+
+    DK_vkSetTexture( app, textureId );
+
+    DK_vkSize size = { texture->width * scale, texture->height * scale };
+    DK_vkVec2 uv1  = { 0.0f, 0.0f };
+    DK_vkVec2 uv2  = { 1.0f, 1.0f };
+
+    DK_vkDrawTexturedQuadLayer( app, position, size, uv1, uv2, tint, textureId, layer );
+  }
+
   DK_VULKAN_FUNC void DK_vkDrawTextureRegion( DK_vkApplication *app,
                                               DK_vkVec2         position,
                                               DK_vkSize         size,
@@ -3517,14 +9817,14 @@ extern "C"
                                               DK_vkSize         region_size,
                                               DK_vkColor        tint )
   {
-    if ( textureId >= app->textureCount )
+    DK_vkTexture *texture = DK_vkGetTexture( app, textureId );
+    if ( texture == NULL )
     {
       fprintf( stderr, "Invalid texture ID\n" );
       return;
     }
 
     DK_vkSetTexture( app, textureId );
-    DK_vkTexture *texture = &app->textures[textureId];
 
     DK_vkVec2 uv1 = { region_position[0] / texture->width, region_position[1] / texture->height };
     DK_vkVec2 uv2 = { uv1[0] + region_size[0] / texture->width, uv1[1] + region_size[1] / texture->height };
@@ -3532,10 +9832,96 @@ extern "C"
     DK_vkDrawTexturedQuad( app, position, size, uv1, uv2, tint, textureId );
   }
 
+  /* Note: borders are { left, top, right, bottom } in texels and rect is { x, y, width, height },
+   * the 9 quads share a 4x4 vertex grid and the corners are shrunk when the rect is too small */
+  DK_VULKAN_FUNC void DK_vkDrawNineSlice( DK_vkApplication *app,
+                                          uint32_t          textureId,
+                                          DK_vkVec4         borders,
+                                          DK_vkVec4         rect,
+                                          DK_vkColor        tint )
+  {
+    uint32_t index = DK_vkGetTextureIndex( app, textureId );
+    if ( index == 0 )
+    {
+      fprintf( stderr, "Invalid texture ID\n" );
+      return;
+    }
+
+    DK_vkTexture *texture = &app->textures[index];
+    if ( app->batchRenderer.currentTexture != texture )
+    {
+      DK_vkSetTexture( app, textureId );
+    }
+
+    if ( !DK_vkReserveBatch( app, 16, 54 ) )
+    {
+      return;
+    }
+
+    DK_vkTouchTexture( app, index );
+    int32_t samplerId = DK_vkAcquireTextureSlot( app, index );
+
+    float left   = borders[0];
+    float top    = borders[1];
+    float right  = borders[2];
+    float bottom = borders[3];
+
+    float horizontal = left + right > rect[2] && left + right > 0.0f ? rect[2] / ( left + right ) : 1.0f;
+    float vertical   = top + bottom > rect[3] && top + bottom > 0.0f ? rect[3] / ( top + bottom ) : 1.0f;
+
+    float xs[4] = { rect[0], rect[0] + left * horizontal, rect[0] + rect[2] - right * horizontal, rect[0] + rect[2] };
+    float ys[4] = { rect[1], rect[1] + top * vertical, rect[1] + rect[3] - bottom * vertical, rect[1] + rect[3] };
+    float us[4] = { 0.0f, left / texture->width, 1.0f - right / texture->width, 1.0f };
+    float vs[4] = { 0.0f, top / texture->height, 1.0f - bottom / texture->height, 1.0f };
+
+    DK_vkRenderer *renderer  = &app->batchRenderer;
+    uint32_t       baseIndex = renderer->vertexCount;
+
+    for ( uint32_t row = 0; row < 4; row++ )
+    {
+      for ( uint32_t column = 0; column < 4; column++ )
+      {
+        DK_vkAddVertex( renderer,
+                        xs[column],
+                        ys[row],
+                        tint[0],
+                        tint[1],
+                        tint[2],
+                        tint[3],
+                        us[column],
+                        vs[row],
+                        samplerId );
+      }
+    }
+
+    for ( uint32_t row = 0; row < 3; row++ )
+    {
+      for ( uint32_t column = 0; column < 3; column++ )
+      {
+        uint32_t topLeft = baseIndex + row * 4 + column;
+
+        DK_vkAddIndex( renderer, topLeft );
+        DK_vkAddIndex( renderer, topLeft + 1 );
+        DK_vkAddIndex( renderer, topLeft + 5 );
+
+        DK_vkAddIndex( renderer, topLeft );
+        DK_vkAddIndex( renderer, topLeft + 5 );
+        DK_vkAddIndex( renderer, topLeft + 4 );
+      }
+    }
+  }
+
   DK_VULKAN_FUNC DK_vkFont DK_vkLoadFont( DK_vkApplication *app, const char *filename, int32_t baseSize )
   {
     DK_vkFont font = { 0 };
 
+    // checked before the atlas image is created, its upload may be deferred into an open upload batch
+    if ( !DK_vkHasFreeTextureSlot( app ) )
+    {
+      fprintf( stderr, "Maximum texture count reached, cannot add font texture\n" );
+      return font;
+    }
+
     size_t         size;
     unsigned char *fontBuffer = DK_vkReadFile( filename, &size );
     if ( !fontBuffer )
@@ -3558,46 +9944,23 @@ extern "C"
     font.width  = DK_VULKAN_DEFAULT_FONT_ATLAS_SIZE;
     font.height = DK_VULKAN_DEFAULT_FONT_ATLAS_SIZE;
 
-    font.char_data        = (stbtt_packedchar *)calloc( 126, sizeof( stbtt_packedchar ) );
-    unsigned char *pixels = (unsigned char *)calloc( font.width * font.height, sizeof( char ) );
+    font.char_data = (stbtt_packedchar *)calloc( 126, sizeof( stbtt_packedchar ) );
+
+    // glyphs are packed straight into staging memory, stb_truetype expects a cleared bitmap
+    DK_vkStagingAllocation staging = DK_vkAllocateStaging( app, (VkDeviceSize)font.width * font.height );
+    memset( staging.data, 0, (size_t)font.width * font.height );
 
     stbtt_pack_context packContext;
-    stbtt_PackBegin( &packContext, pixels, font.width, font.height, font.width, 1, NULL );
+    stbtt_PackBegin(
+        &packContext, (unsigned char *)staging.data, font.width, font.height, font.width, 1, NULL );
     stbtt_PackFontRange( &packContext, fontBuffer, 0, baseSize, 0, 125, font.char_data );
     stbtt_PackEnd( &packContext );
 
-    unsigned char *pixelsRGBA = (unsigned char *)malloc( font.width * font.height * 4 );
-    for ( int i = 0; i < font.width * font.height; i++ )
-    {
-      pixelsRGBA[i * 4 + 0] = 255;
-      pixelsRGBA[i * 4 + 1] = 255;
-      pixelsRGBA[i * 4 + 2] = 255;
-      pixelsRGBA[i * 4 + 3] = pixels[i];
-    }
-
-    VkDeviceSize imageSize = font.width * font.height * 4;
-
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    DK_vkCreateBuffer( app,
-                       imageSize,
-                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &stagingBuffer,
-                       &stagingBufferMemory );
-
-    void *data;
-    vkMapMemory( app->device, stagingBufferMemory, 0, imageSize, 0, &data );
-    memcpy( data, pixelsRGBA, imageSize );
-    vkUnmapMemory( app->device, stagingBufferMemory );
-
-    free( pixelsRGBA );
-    free( pixels );
-
     DK_vkCreateImage( app,
                       font.width,
                       font.height,
-                      VK_FORMAT_R8G8B8A8_SRGB,
+                      1,
+                      VK_FORMAT_R8_UNORM,
                       VK_IMAGE_TILING_OPTIMAL,
                       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -3606,55 +9969,48 @@ extern "C"
 
     DK_vkTransitionImageLayout( app,
                                 font.image,
-                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_FORMAT_R8_UNORM,
                                 VK_IMAGE_LAYOUT_UNDEFINED,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
 
-    DK_vkCopyBufferToImage( app, stagingBuffer, font.image, font.width, font.height );
+    DK_vkCopyBufferToImageRegion(
+        app, staging.buffer, staging.offset, font.image, 0, 0, font.width, font.height );
 
     DK_vkTransitionImageLayout( app,
                                 font.image,
-                                VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_FORMAT_R8_UNORM,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
 
-    DK_vkCreateTextureImageView( app, font.image, &font.view );
-    DK_vkCreateTextureSampler( app, &font.sampler );
+    /* Note: the atlas only holds coverage, the view reads it as white with coverage in alpha so the
+     * fragment shader treats it like any other texture */
+    VkComponentMapping coverage = { 0 };
+    coverage.r                  = VK_COMPONENT_SWIZZLE_ONE;
+    coverage.g                  = VK_COMPONENT_SWIZZLE_ONE;
+    coverage.b                  = VK_COMPONENT_SWIZZLE_ONE;
+    coverage.a                  = VK_COMPONENT_SWIZZLE_R;
+    DK_vkCreateTextureImageViewSwizzled( app, font.image, VK_FORMAT_R8_UNORM, &coverage, &font.view );
+    DK_vkCreatePackedTextureSampler( app, &font.sampler );
 
-    font.channels = 4;
+    font.channels = 1;
 
     // register the font texture int the texture system
-    if ( app->textureCount >= app->maxTextures )
-    {
-      fprintf( stderr, "Maximum texture count reached, cannot add font texture\n" );
-      vkDestroyBuffer( app->device, stagingBuffer, NULL );
-      vkFreeMemory( app->device, stagingBufferMemory, NULL );
-      vkDestroySampler( app->device, font.sampler, NULL );
-      vkDestroyImageView( app->device, font.view, NULL );
-      vkDestroyImage( app->device, font.image, NULL );
-      vkFreeMemory( app->device, font.memory, NULL );
-      free( font.char_data );
-      free( fontBuffer );
-      return font;
-    }
-
-    uint32_t fontTextureId = app->textureCount++;
-    font.samplerId         = fontTextureId;
-
-    app->textures[fontTextureId].image     = font.image;
-    app->textures[fontTextureId].memory    = font.memory;
-    app->textures[fontTextureId].view      = font.view;
-    app->textures[fontTextureId].sampler   = font.sampler;
-    app->textures[fontTextureId].width     = font.width;
-    app->textures[fontTextureId].height    = font.height;
-    app->textures[fontTextureId].channels  = 4;
-    app->textures[fontTextureId].isActive  = true;
-    app->textures[fontTextureId].samplerId = fontTextureId;
-
-    DK_vkUpdateDescriptorSetWithTextures( app );
+    DK_vkTexture texture = { 0 };
+    texture.image        = font.image;
+    texture.memory       = font.memory;
+    texture.view         = font.view;
+    texture.sampler      = font.sampler;
+    texture.width        = font.width;
+    texture.height       = font.height;
+    texture.channels     = 1;
+    texture.isActive     = true;
+    texture.format       = VK_FORMAT_R8_UNORM;
+    texture.mipLevels    = 1;
+    texture.layerCount   = 1;
+    texture.residency    = DK_VK_TEXTURE_RESIDENT;
+
+    font.samplerId = DK_vkRegisterTexture( app, texture );
 
-    vkDestroyBuffer( app->device, stagingBuffer, NULL );
-    vkFreeMemory( app->device, stagingBufferMemory, NULL );
     free( fontBuffer );
 
     return font;
@@ -3668,11 +10024,17 @@ extern "C"
       font->char_data = NULL;
     }
 
-    // Note: (David) DK_vkDestroyTexture is called when cleaning up the application
-    font->image   = VK_NULL_HANDLE;
-    font->memory  = VK_NULL_HANDLE;
-    font->view    = VK_NULL_HANDLE;
-    font->sampler = VK_NULL_HANDLE;
+    // the atlas image belongs to the texture, it is released once no frame in flight samples it
+    if ( font->samplerId != 0 )
+    {
+      DK_vkRemoveTexture( app, font->samplerId );
+    }
+
+    font->image     = VK_NULL_HANDLE;
+    font->memory    = (DK_vkAllocation){ 0 };
+    font->view      = VK_NULL_HANDLE;
+    font->sampler   = VK_NULL_HANDLE;
+    font->samplerId = 0;
   }
   DK_VULKAN_FUNC float DK_vkMeasureTextWidth( DK_vkFont *font, const char *text, float fontSize )
   {
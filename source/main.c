@@ -17,9 +17,12 @@ int main()
   DK_vkInitApp( &app, windowWidth, windowHeight, "MoltenVK Renderer" );
   DK_vkInitTextureSystem( &app );
 
+  // record every texture upload into one submission
+  DK_vkBeginUploads( &app );
   uint32_t  texture0SamplerId = DK_vkAddTexture( &app, "res/textures/uv.jpg" );
   uint32_t  texture1SamplerId = DK_vkAddTexture( &app, "res/textures/Vulkan_logo.png" );
   DK_vkFont font              = DK_vkLoadFont( &app, "res/fonts/Alegreya-Regular.ttf", 120.0f );
+  DK_vkEndUploads( &app, true );
 
   double current = glfwGetTime();
   double prev    = current;
@@ -73,6 +76,11 @@ int main()
       DK_vkVec2  position  = { ( app.screenWidth - size[0] ) * 0.5, 100.0f };
       float      roundness = 20.0f;
       int32_t    segments  = 128;
+
+      DK_vkColor shadowTint     = { 0.0f, 0.0f, 0.0f, 0.6f };
+      DK_vkVec2  shadowPosition = { position[0] + 4.0f, position[1] + 8.0f };
+      DK_vkDrawShadowRoundedRect( &app, shadowPosition, size, roundness, 12.0f, shadowTint );
+
       DK_vkDrawRoundedRectangle( &app, position, size, roundness, tint, segments );
     }
 
@@ -90,25 +98,29 @@ int main()
     {
       float scale = 1.0f;
 
-      DK_vkTexture texture = app.textures[texture0SamplerId];
-
-      DK_vkColor tint     = { 1.0f, 1.0f, 1.0f, 1.0f };
-      DK_vkSize  size     = { texture.width * scale, texture.height * scale };
-      DK_vkVec2  position = { ( app.screenWidth - ( size[0] + 20.0f ) ),
-                              ( app.screenHeight - ( size[1] + 20.0f ) ) };
+      DK_vkTexture *texture = DK_vkGetTexture( &app, texture0SamplerId );
+      if ( texture != NULL )
+      {
+        DK_vkColor tint     = { 1.0f, 1.0f, 1.0f, 1.0f };
+        DK_vkSize  size     = { texture->width * scale, texture->height * scale };
+        DK_vkVec2  position = { ( app.screenWidth - ( size[0] + 20.0f ) ),
+                                ( app.screenHeight - ( size[1] + 20.0f ) ) };
 
-      DK_vkDrawTexture( &app, position, texture0SamplerId, scale, tint );
+        DK_vkDrawTexture( &app, position, texture0SamplerId, scale, tint );
+      }
     }
 
     {
-      float        scale   = 1.0f;
-      DK_vkTexture texture = app.textures[texture1SamplerId];
-
-      DK_vkColor tint     = { 1.0f, 1.0f, 1.0f, 1.0f };
-      DK_vkSize  size     = { texture.width * scale, texture.height * scale };
-      DK_vkVec2  position = { ( ( 20.0f ) ), ( app.screenHeight - ( size[1] + 20.0f ) ) };
+      float         scale   = 1.0f;
+      DK_vkTexture *texture = DK_vkGetTexture( &app, texture1SamplerId );
+      if ( texture != NULL )
+      {
+        DK_vkColor tint     = { 1.0f, 1.0f, 1.0f, 1.0f };
+        DK_vkSize  size     = { texture->width * scale, texture->height * scale };
+        DK_vkVec2  position = { ( ( 20.0f ) ), ( app.screenHeight - ( size[1] + 20.0f ) ) };
 
-      DK_vkDrawTexture( &app, position, texture1SamplerId, scale, tint );
+        DK_vkDrawTexture( &app, position, texture1SamplerId, scale, tint );
+      }
     }
 
     {
@@ -0,0 +1,200 @@
+/**
+ *  $File: png2qoi.c
+ *  $By: David Kviloria (dkvilo) & SKYSTAR GAMES Interactive david@skystargames.com
+ *
+ *  Offline converter from any image stb_image can read to QOI, the texture loader picks QOI files up by
+ *  their magic bytes so converted images can keep their place in the asset tree.
+ *
+ *  usage: png2qoi <input> [<input> ...]    writes <input without extension>.qoi next to every input
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+#define QOI_RUN_MAX 62
+
+static void WriteBigEndian32( uint8_t *bytes, uint32_t value )
+{
+  bytes[0] = (uint8_t)( value >> 24 );
+  bytes[1] = (uint8_t)( value >> 16 );
+  bytes[2] = (uint8_t)( value >> 8 );
+  bytes[3] = (uint8_t)value;
+}
+
+/* Note: pixels are RGBA, channels only goes into the header. The worst case is one RGBA op per pixel,
+ * the returned buffer is sized for it and *size is set to the bytes actually used */
+static uint8_t *
+EncodeQOI( const uint8_t *pixels, uint32_t width, uint32_t height, uint8_t channels, size_t *size )
+{
+  size_t   pixelCount = (size_t)width * height;
+  uint8_t *out        = (uint8_t *)malloc( 14 + pixelCount * 5 + 8 );
+  if ( out == NULL )
+  {
+    return NULL;
+  }
+
+  memcpy( out, "qoif", 4 );
+  WriteBigEndian32( out + 4, width );
+  WriteBigEndian32( out + 8, height );
+  out[12] = channels;
+  out[13] = 0; // sRGB with linear alpha
+
+  uint8_t index[64][4] = { { 0 } };
+  uint8_t prev[4]      = { 0, 0, 0, 255 };
+  uint8_t run          = 0;
+  size_t  p            = 14;
+
+  for ( size_t i = 0; i < pixelCount; i++ )
+  {
+    const uint8_t *px = pixels + i * 4;
+
+    if ( memcmp( px, prev, 4 ) == 0 )
+    {
+      run++;
+      if ( run == QOI_RUN_MAX || i == pixelCount - 1 )
+      {
+        out[p++] = QOI_OP_RUN | ( run - 1 );
+        run      = 0;
+      }
+      continue;
+    }
+
+    if ( run > 0 )
+    {
+      out[p++] = QOI_OP_RUN | ( run - 1 );
+      run      = 0;
+    }
+
+    uint32_t hash = ( px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11 ) % 64;
+    if ( memcmp( index[hash], px, 4 ) == 0 )
+    {
+      out[p++] = QOI_OP_INDEX | hash;
+    }
+    else
+    {
+      memcpy( index[hash], px, 4 );
+
+      if ( px[3] == prev[3] )
+      {
+        int8_t vr  = (int8_t)( px[0] - prev[0] );
+        int8_t vg  = (int8_t)( px[1] - prev[1] );
+        int8_t vb  = (int8_t)( px[2] - prev[2] );
+        int8_t vgr = (int8_t)( vr - vg );
+        int8_t vgb = (int8_t)( vb - vg );
+
+        if ( vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2 )
+        {
+          out[p++] = QOI_OP_DIFF | ( vr + 2 ) << 4 | ( vg + 2 ) << 2 | ( vb + 2 );
+        }
+        else if ( vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8 )
+        {
+          out[p++] = QOI_OP_LUMA | ( vg + 32 );
+          out[p++] = ( vgr + 8 ) << 4 | ( vgb + 8 );
+        }
+        else
+        {
+          out[p++] = QOI_OP_RGB;
+          out[p++] = px[0];
+          out[p++] = px[1];
+          out[p++] = px[2];
+        }
+      }
+      else
+      {
+        out[p++] = QOI_OP_RGBA;
+        out[p++] = px[0];
+        out[p++] = px[1];
+        out[p++] = px[2];
+        out[p++] = px[3];
+      }
+    }
+
+    memcpy( prev, px, 4 );
+  }
+
+  // end marker, 7 zero bytes and a 1
+  memset( out + p, 0, 7 );
+  out[p + 7] = 1;
+  *size      = p + 8;
+
+  return out;
+}
+
+static int ConvertImage( const char *input )
+{
+  int32_t  width, height, channels;
+  stbi_uc *pixels = stbi_load( input, &width, &height, &channels, STBI_rgb_alpha );
+  if ( pixels == NULL )
+  {
+    fprintf( stderr, "Failed to load image: %s (%s)\n", input, stbi_failure_reason() );
+    return 1;
+  }
+
+  // grey + alpha keeps its alpha, everything else without alpha is stored as RGB
+  uint8_t  qoiChannels = ( channels == 2 || channels == 4 ) ? 4 : 3;
+  size_t   size        = 0;
+  uint8_t *encoded     = EncodeQOI( pixels, (uint32_t)width, (uint32_t)height, qoiChannels, &size );
+  stbi_image_free( pixels );
+
+  if ( encoded == NULL )
+  {
+    fprintf( stderr, "Failed to encode image: %s\n", input );
+    return 1;
+  }
+
+  size_t      length    = strlen( input );
+  const char *extension = strrchr( input, '.' );
+  const char *slash     = strrchr( input, '/' );
+  if ( extension != NULL && ( slash == NULL || extension > slash ) )
+  {
+    length = (size_t)( extension - input );
+  }
+
+  char output[4096];
+  snprintf( output, sizeof( output ), "%.*s.qoi", (int)length, input );
+
+  FILE *file = fopen( output, "wb" );
+  if ( file == NULL || fwrite( encoded, 1, size, file ) != size )
+  {
+    fprintf( stderr, "Failed to write image: %s\n", output );
+    if ( file != NULL )
+    {
+      fclose( file );
+    }
+    free( encoded );
+    return 1;
+  }
+
+  fclose( file );
+  free( encoded );
+
+  printf( "%s -> %s (%dx%d, %zu bytes)\n", input, output, width, height, size );
+  return 0;
+}
+
+int main( int argc, char **argv )
+{
+  if ( argc < 2 )
+  {
+    fprintf( stderr, "usage: %s <input> [<input> ...]\n", argv[0] );
+    return 1;
+  }
+
+  int failed = 0;
+  for ( int i = 1; i < argc; i++ )
+  {
+    failed |= ConvertImage( argv[i] );
+  }
+
+  return failed;
+}